@@ -9,6 +9,21 @@ extern "C" {
 #endif
 
 void logic_build_state(uint32_t *epoch, otIp6Address *owner, uint32_t *rem_ms, bool *active);
+bool logic_build_zone_state(uint8_t zone_id, uint32_t *epoch, otIp6Address *owner, uint32_t *rem_ms, bool *active);
+uint8_t logic_get_zone_ids(uint8_t *out, uint8_t max);
+void logic_get_wakeup_stats(uint32_t *per_sec_x100, uint32_t *total);
+void logic_get_input_wakeup_stats(uint32_t *per_sec_x100, uint32_t *total);
+void logic_get_dedup_stats(uint32_t *lookups, uint32_t *hits, uint32_t *evictions);
+void logic_get_state_rsp_stats(uint32_t *requests, uint32_t *sent, uint32_t *suppressed);
+void coap_if_get_rx_stats(uint32_t *foreign, uint32_t *mc_group, uint32_t *mc_all);
+void netdata_if_get_stats(uint32_t *budget_skips, uint8_t *len, uint8_t *max_len);
+bool coap_if_set_mcast_hops(const char *type, uint8_t hops);
+void coap_if_cli_print_mcast(void);
+void coap_if_cli_print_outbox(void);
+void coap_if_cli_bench_tx(uint32_t n);
+void logic_cli_print_mailbox(void);
+void logic_cli_print_trace(uint32_t n);
+void logic_cli_print_latency(bool reset);
 
 #ifdef __cplusplus
 }
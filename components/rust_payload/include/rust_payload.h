@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -14,7 +15,7 @@ typedef struct {
     uint8_t has_clr;
     uint8_t has_z;
     uint8_t has_m;
-    uint8_t _reserved;
+    uint8_t has_owner;
     uint32_t epoch;
     uint32_t rem_ms;
     uint32_t active;
@@ -22,10 +23,39 @@ typedef struct {
     uint32_t clr;
     uint32_t z;
     uint32_t m;
+    uint8_t owner[16];    // o= (IPv6 owner из state_rsp), сетевой порядок
 } rust_parsed_t;
 
 uint32_t rust_parse_payload(const uint8_t *buf, uint32_t len, rust_parsed_t *out);
 
+// Потоковый разбор (тот же, что rust_parse_payload, и те же правила, что у host/coap_kv.h):
+// payload кусками любого размера — окна otMessageRead — без копии целиком. Состояние у
+// вызывающего, без аллокаций; перед feed/finish — rust_kv_init.
+#define RUST_KV_STATE_WORDS 28
+
+typedef struct {
+    uint32_t _priv[RUST_KV_STATE_WORDS];
+} rust_kv_t;
+
+void rust_kv_init(rust_kv_t *kv);
+void rust_kv_feed(rust_kv_t *kv, const uint8_t *data, uint32_t len);
+// закрыть последний токен: 1 — out заполнен, 0 — payload отвергнут
+uint32_t rust_kv_finish(rust_kv_t *kv, rust_parsed_t *out);
+
+// Текст "e=..;a=..;r=..;mode=..;m=..;clr=..;z=..;o=<IPv6>" из заданных полей (has_*),
+// то, что принимает rust_parse_payload. rem_ms без owner — "h=" (trigger прежних прошивок).
+// Без printf и без аллокаций.
+#define RUST_PAYLOAD_TEXT_MAX 128
+
+// в buf (cap байт, без '\0'); длина или 0 — не влезло / active > 1 / mode > 255
+uint32_t rust_encode_payload(const rust_parsed_t *in, uint8_t *buf, uint32_t cap);
+
+// sink получает вывод кусками до 32 байт; false из sink прерывает кодирование
+typedef bool (*rust_payload_sink_t)(void *ctx, const uint8_t *data, uint32_t len);
+
+// число отданных в sink байт или 0 (sink отказал / поля вне диапазона)
+uint32_t rust_encode_payload_sink(const rust_parsed_t *in, rust_payload_sink_t sink, void *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,48 @@
+#!/bin/sh
+# payload_parser по профилям opt-z (= release, так собирается прошивка), opt-s, opt-2, opt-3:
+# ns/payload и MB/s на хосте (benches/parse.rs, корпуса benches/corpus/) и размер .text
+# кода крейта под riscv32imac-unknown-none-elf (объект крейта из staticlib, без
+# compiler_builtins). Без установленного riscv-таргета размер — для хоста, с пометкой.
+#
+#   ./bench.sh [профиль...]        CARGO_TARGET_DIR, SIZE (llvm-size) — из окружения
+
+set -eu
+cd "$(dirname "$0")"
+
+PROFILES=${*:-opt-z opt-s opt-2 opt-3}
+TARGET=riscv32imac-unknown-none-elf
+SIZE=${SIZE:-llvm-size}
+TARGET_DIR=${CARGO_TARGET_DIR:-target}
+mkdir -p "$TARGET_DIR"
+TARGET_DIR=$(cd "$TARGET_DIR" && pwd)
+export CARGO_TARGET_DIR="$TARGET_DIR"
+
+if rustup target list --installed 2>/dev/null | grep -qx "$TARGET"; then
+    SIZE_TARGET=$TARGET
+    SIZE_NOTE=""
+else
+    SIZE_TARGET=$(rustc -vV | sed -n 's/^host: //p')
+    SIZE_NOTE=" (нет $TARGET: rustup target add $TARGET)"
+fi
+
+# .text* объекта крейта в staticlib
+text_size() {
+    tmp=$(mktemp -d)
+    (cd "$tmp" && ar x "$1")
+    "$SIZE" -A "$tmp"/payload_parser-*.o | awk '$1 ~ /^\.text/ { s += $2 } END { print s + 0 }'
+    rm -rf "$tmp"
+}
+
+SIZES=""
+for p in $PROFILES; do
+    echo "== $p"
+    cargo bench -q --features host --profile "$p" --bench parse
+    cargo build -q --lib --profile "$p" --target "$SIZE_TARGET"
+    SIZES="$SIZES$p $(text_size "$TARGET_DIR/$SIZE_TARGET/$p/libpayload_parser.a")
+"
+done
+
+echo "== .text, $SIZE_TARGET$SIZE_NOTE"
+printf '%s' "$SIZES" | while read -r p n; do
+    printf '%-6s %6s bytes\n' "$p" "$n"
+done
@@ -0,0 +1,71 @@
+// Бенчмарк rust_parse_payload на корпусах реальных payload (benches/corpus/*.txt, по одному
+// на строку, '#' — комментарий). Вызов — через FFI, как из coap_if.c.
+//
+//   cargo bench --features host [--profile opt-z|opt-s|opt-2|opt-3]
+//
+// На корпус: число payload, сколько принято, ns на payload и пропускная способность.
+// Сравнение opt-level и размер .text — bench.sh.
+
+use payload_parser::{rust_parse_payload, RustParsed};
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+const CORPORA: [(&str, &str); 4] = [
+    ("trigger", include_str!("corpus/trigger.txt")),
+    ("state_rsp", include_str!("corpus/state_rsp.txt")),
+    ("mode", include_str!("corpus/mode.txt")),
+    ("malformed", include_str!("corpus/malformed.txt")),
+];
+
+// на корпус не меньше этого времени замера (после прогрева)
+const MEASURE: Duration = Duration::from_millis(300);
+
+fn payloads(text: &str) -> Vec<&[u8]> {
+    text.lines()
+        .filter(|l| !l.is_empty() && !l.starts_with('#'))
+        .map(str::as_bytes)
+        .collect()
+}
+
+fn parse_all(corpus: &[&[u8]]) -> u32 {
+    let mut accepted = 0;
+    for p in corpus {
+        let mut out = RustParsed::default();
+        accepted += rust_parse_payload(black_box(p.as_ptr()), p.len() as u32, &mut out);
+        black_box(&out);
+    }
+    accepted
+}
+
+fn main() {
+    println!("{:<10} {:>8} {:>8} {:>12} {:>10}", "corpus", "payloads", "accepted", "ns/payload", "MB/s");
+    for (name, text) in CORPORA {
+        let corpus = payloads(text);
+        let bytes: usize = corpus.iter().map(|p| p.len()).sum();
+        let accepted = parse_all(&corpus);
+
+        let warm = Instant::now();
+        while warm.elapsed() < MEASURE / 4 {
+            parse_all(&corpus);
+        }
+        let mut rounds: u64 = 0;
+        let start = Instant::now();
+        while start.elapsed() < MEASURE {
+            for _ in 0..64 {
+                parse_all(&corpus);
+            }
+            rounds += 64;
+        }
+        let ns = start.elapsed().as_nanos() as f64;
+        let per_payload = ns / (rounds as f64 * corpus.len() as f64);
+        let mb_s = (rounds as f64 * bytes as f64) / ns * 1e3;
+        println!(
+            "{:<10} {:>8} {:>8} {:>12.1} {:>10.1}",
+            name,
+            corpus.len(),
+            accepted,
+            per_payload,
+            mb_s
+        );
+    }
+}
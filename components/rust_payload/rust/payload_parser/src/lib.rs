@@ -1,5 +1,11 @@
-#![no_std]
+// feature "host" — сборка под std для бенчмарка (benches/, bench.sh)
+#![cfg_attr(not(any(test, feature = "host")), no_std)]
 
+use core::ffi::c_void;
+
+mod stream;
+pub use stream::RustKv;
+#[cfg(not(any(test, feature = "host")))]
 use core::panic::PanicInfo;
 
 #[repr(C)]
@@ -12,7 +18,7 @@ pub struct RustParsed {
     pub has_clr: u8,
     pub has_z: u8,
     pub has_m: u8,
-    pub _reserved: u8,
+    pub has_owner: u8,
     pub epoch: u32,
     pub rem_ms: u32,
     pub active: u32,
@@ -20,6 +26,7 @@ pub struct RustParsed {
     pub clr: u32,
     pub z: u32,
     pub m: u32,
+    pub owner: [u8; 16],
 }
 
 impl Default for RustParsed {
@@ -32,7 +39,7 @@ impl Default for RustParsed {
             has_clr: 0,
             has_z: 0,
             has_m: 0,
-            _reserved: 0,
+            has_owner: 0,
             epoch: 0,
             rem_ms: 0,
             active: 0,
@@ -40,6 +47,7 @@ impl Default for RustParsed {
             clr: 0,
             z: 0,
             m: 0,
+            owner: [0; 16],
         }
     }
 }
@@ -63,154 +71,291 @@ pub extern "C" fn rust_parse_payload(buf: *const u8, len: u32, out: *mut RustPar
 }
 
 fn parse_payload(bytes: &[u8]) -> Result<RustParsed, ()> {
-    let mut out = RustParsed::default();
-    let mut idx = 0;
+    let mut kv = RustKv::new();
+    kv.feed(bytes);
+    kv.finish()
+}
 
-    while idx < bytes.len() {
-        skip_spaces(bytes, &mut idx);
-        if idx >= bytes.len() {
-            break;
-        }
-        if is_sep(bytes[idx]) {
-            idx += 1;
-            continue;
-        }
+// ---- потоковый разбор ----
+// rust_kv_t в C — непрозрачные KV_STATE_WORDS слов у вызывающего (обычно на стеке
+// обработчика), внутри — RustKv. До feed/finish — обязательно rust_kv_init.
 
-        let key_start = idx;
-        while idx < bytes.len() && bytes[idx] != b'=' && !is_sep(bytes[idx]) {
-            idx += 1;
-        }
-        let key_end = idx;
-        if idx >= bytes.len() || bytes[idx] != b'=' {
-            skip_until_sep(bytes, &mut idx);
-            continue;
-        }
-        idx += 1;
+pub const KV_STATE_WORDS: usize = 28;
+
+#[repr(C)]
+pub struct RustKvStorage([u32; KV_STATE_WORDS]);
+
+const _: () = assert!(
+    core::mem::size_of::<RustKv>() <= core::mem::size_of::<RustKvStorage>()
+        && core::mem::align_of::<RustKv>() <= core::mem::align_of::<RustKvStorage>()
+);
+
+#[no_mangle]
+pub extern "C" fn rust_kv_init(kv: *mut RustKvStorage) {
+    if kv.is_null() {
+        return;
+    }
+    unsafe { (kv as *mut RustKv).write(RustKv::new()) }
+}
+
+#[no_mangle]
+pub extern "C" fn rust_kv_feed(kv: *mut RustKvStorage, data: *const u8, len: u32) {
+    if kv.is_null() || data.is_null() || len == 0 {
+        return;
+    }
+    let kv = unsafe { &mut *(kv as *mut RustKv) };
+    kv.feed(unsafe { core::slice::from_raw_parts(data, len as usize) });
+}
 
-        skip_spaces(bytes, &mut idx);
-        let val_start = idx;
-        while idx < bytes.len() && !is_sep(bytes[idx]) {
-            idx += 1;
+#[no_mangle]
+pub extern "C" fn rust_kv_finish(kv: *mut RustKvStorage, out: *mut RustParsed) -> u32 {
+    if kv.is_null() || out.is_null() {
+        return 0;
+    }
+    let kv = unsafe { &mut *(kv as *mut RustKv) };
+    match kv.finish() {
+        Ok(parsed) => {
+            unsafe { *out = parsed };
+            1
         }
-        let val_end = idx;
+        Err(()) => 0,
+    }
+}
 
-        let key = trim_spaces(&bytes[key_start..key_end]);
-        let val = trim_spaces(&bytes[val_start..val_end]);
+// ---- кодирование ----
+// Обратное к parse_payload: заданные поля в порядке e, a, rem_ms, mode, m, clr, z, o через
+// ';', числа десятичные, owner — сжатый IPv6 (RFC 5952). Без аллокаций и без core::fmt.
+// rem_ms — "r" при owner (state_rsp "e=;a=;r=;o=") и "h" без него (trigger): так его читают
+// и прежние прошивки.
 
-        if !key.is_empty() && !val.is_empty() {
-            let value = parse_u32(val).ok_or(())?;
-            match key {
-                b"epoch" => {
-                    out.has_epoch = 1;
-                    out.epoch = value;
-                }
-                b"rem_ms" => {
-                    out.has_rem_ms = 1;
-                    out.rem_ms = value;
-                }
-                b"active" => {
-                    if value > 1 {
-                        return Err(());
-                    }
-                    out.has_active = 1;
-                    out.active = value;
-                }
-                b"mode" => {
-                    if value > u8::MAX as u32 {
-                        return Err(());
-                    }
-                    out.has_mode = 1;
-                    out.mode = value;
-                }
-                b"clr" => {
-                    out.has_clr = 1;
-                    out.clr = value;
-                }
-                b"z" => {
-                    out.has_z = 1;
-                    out.z = value;
-                }
-                b"m" => {
-                    out.has_m = 1;
-                    out.m = value;
-                }
-                b"e" => {
-                    out.has_epoch = 1;
-                    out.epoch = value;
-                }
-                b"h" => {
-                    out.has_rem_ms = 1;
-                    out.rem_ms = value;
-                }
-                b"a" => {
-                    if value > 1 {
-                        return Err(());
-                    }
-                    out.has_active = 1;
-                    out.active = value;
-                }
-                _ => {}
-            }
+/// Не длиннее этого: все поля с максимальными значениями плюс IPv6 из 39 символов.
+pub const ENCODE_MAX: usize = 128;
+
+pub type PayloadSink = extern "C" fn(ctx: *mut c_void, data: *const u8, len: u32) -> bool;
+
+trait Out {
+    fn put(&mut self, bytes: &[u8]) -> bool;
+}
+
+struct SliceOut<'a> {
+    buf: &'a mut [u8],
+    len: usize,
+}
+
+impl Out for SliceOut<'_> {
+    fn put(&mut self, bytes: &[u8]) -> bool {
+        let end = self.len + bytes.len();
+        if end > self.buf.len() {
+            return false;
         }
+        self.buf[self.len..end].copy_from_slice(bytes);
+        self.len = end;
+        true
     }
+}
+
+// копит вывод в небольшом буфере: sink вызывается раз на SINK_STAGE байт, а не на поле
+const SINK_STAGE: usize = 32;
 
-    Ok(out)
+struct SinkOut {
+    sink: PayloadSink,
+    ctx: *mut c_void,
+    stage: [u8; SINK_STAGE],
+    n: usize,
+    total: usize,
 }
 
-fn parse_u32(bytes: &[u8]) -> Option<u32> {
-    let mut value: u32 = 0;
-    let mut seen = false;
-    for &b in bytes {
-        if b < b'0' || b > b'9' {
-            return None;
+impl SinkOut {
+    fn flush(&mut self) -> bool {
+        if self.n == 0 {
+            return true;
         }
-        seen = true;
-        let digit = (b - b'0') as u32;
-        value = value.checked_mul(10)?;
-        value = value.checked_add(digit)?;
+        let ok = (self.sink)(self.ctx, self.stage.as_ptr(), self.n as u32);
+        self.total += self.n;
+        self.n = 0;
+        ok
     }
-    if seen { Some(value) } else { None }
 }
 
-fn is_sep(b: u8) -> bool {
-    b == b';' || b == b'&'
+impl Out for SinkOut {
+    fn put(&mut self, mut bytes: &[u8]) -> bool {
+        while !bytes.is_empty() {
+            if self.n == SINK_STAGE && !self.flush() {
+                return false;
+            }
+            let take = core::cmp::min(SINK_STAGE - self.n, bytes.len());
+            self.stage[self.n..self.n + take].copy_from_slice(&bytes[..take]);
+            self.n += take;
+            bytes = &bytes[take..];
+        }
+        true
+    }
 }
 
-fn skip_spaces(bytes: &[u8], idx: &mut usize) {
-    while *idx < bytes.len() && bytes[*idx].is_ascii_whitespace() {
-        *idx += 1;
+/// Кодирует `in` в `buf` (до `cap` байт, без завершающего нуля). Возвращает длину;
+/// 0 — не влезло или поля вне диапазона парсера (active > 1, mode > 255).
+#[no_mangle]
+pub extern "C" fn rust_encode_payload(input: *const RustParsed, buf: *mut u8, cap: u32) -> u32 {
+    if input.is_null() || buf.is_null() {
+        return 0;
     }
+    let p = unsafe { &*input };
+    let bytes = unsafe { core::slice::from_raw_parts_mut(buf, cap as usize) };
+    let mut out = SliceOut { buf: bytes, len: 0 };
+    if !encode_payload(p, &mut out) {
+        return 0;
+    }
+    out.len as u32
 }
 
-fn skip_until_sep(bytes: &[u8], idx: &mut usize) {
-    while *idx < bytes.len() && !is_sep(bytes[*idx]) {
-        *idx += 1;
+/// То же, но вывод кусками отдаётся в `sink` (например, otMessageAppend) — без буфера
+/// под весь payload у вызывающего. Возвращает число отданных байт; 0 — sink отказал или
+/// поля вне диапазона (тогда часть данных могла уже уйти в sink).
+#[no_mangle]
+pub extern "C" fn rust_encode_payload_sink(
+    input: *const RustParsed,
+    sink: Option<PayloadSink>,
+    ctx: *mut c_void,
+) -> u32 {
+    let sink = match sink {
+        Some(sink) if !input.is_null() => sink,
+        _ => return 0,
+    };
+    let p = unsafe { &*input };
+    let mut out = SinkOut {
+        sink,
+        ctx,
+        stage: [0; SINK_STAGE],
+        n: 0,
+        total: 0,
+    };
+    if !encode_payload(p, &mut out) || !out.flush() {
+        return 0;
     }
+    out.total as u32
 }
 
-fn trim_spaces(bytes: &[u8]) -> &[u8] {
-    let mut start = 0;
-    let mut end = bytes.len();
-    while start < end && bytes[start].is_ascii_whitespace() {
-        start += 1;
+fn encode_payload<O: Out>(p: &RustParsed, out: &mut O) -> bool {
+    if (p.has_active != 0 && p.active > 1) || (p.has_mode != 0 && p.mode > u8::MAX as u32) {
+        return false;
+    }
+    let fields: [(u8, &[u8], u32); 7] = [
+        (p.has_epoch, b"e=", p.epoch),
+        (p.has_active, b"a=", p.active),
+        (p.has_rem_ms, if p.has_owner != 0 { b"r=" } else { b"h=" }, p.rem_ms),
+        (p.has_mode, b"mode=", p.mode),
+        (p.has_m, b"m=", p.m),
+        (p.has_clr, b"clr=", p.clr),
+        (p.has_z, b"z=", p.z),
+    ];
+    let mut first = true;
+    for &(has, key, value) in fields.iter() {
+        if has == 0 {
+            continue;
+        }
+        if !(first || out.put(b";")) || !out.put(key) || !put_u32(out, value) {
+            return false;
+        }
+        first = false;
+    }
+    if p.has_owner != 0 {
+        if !(first || out.put(b";")) || !out.put(b"o=") || !put_ip6(out, &p.owner) {
+            return false;
+        }
     }
-    while end > start && bytes[end - 1].is_ascii_whitespace() {
-        end -= 1;
+    true
+}
+
+fn put_u32<O: Out>(out: &mut O, mut value: u32) -> bool {
+    let mut digits = [0u8; 10];
+    let mut at = digits.len();
+    loop {
+        at -= 1;
+        digits[at] = b'0' + (value % 10) as u8;
+        value /= 10;
+        if value == 0 {
+            break;
+        }
     }
-    &bytes[start..end]
+    out.put(&digits[at..])
 }
 
+fn put_ip6<O: Out>(out: &mut O, addr: &[u8; 16]) -> bool {
+    const HEX: &[u8; 16] = b"0123456789abcdef";
+    let mut groups = [0u16; 8];
+    for (i, g) in groups.iter_mut().enumerate() {
+        *g = u16::from_be_bytes([addr[2 * i], addr[2 * i + 1]]);
+    }
+
+    // самая длинная серия нулевых групп (не короче двух, при равенстве — первая) -> "::"
+    let (mut best_at, mut best_len) = (8usize, 0usize);
+    let mut i = 0;
+    while i < 8 {
+        if groups[i] != 0 {
+            i += 1;
+            continue;
+        }
+        let start = i;
+        while i < 8 && groups[i] == 0 {
+            i += 1;
+        }
+        if i - start > best_len {
+            best_at = start;
+            best_len = i - start;
+        }
+    }
+    if best_len < 2 {
+        best_at = 8;
+        best_len = 0;
+    }
+
+    let mut text = [0u8; 39];
+    let mut n = 0;
+    let mut i = 0;
+    while i < 8 {
+        if i == best_at {
+            text[n] = b':';
+            text[n + 1] = b':';
+            n += 2;
+            i += best_len;
+            continue;
+        }
+        if i > 0 && i != best_at + best_len {
+            text[n] = b':';
+            n += 1;
+        }
+        let g = groups[i];
+        let mut shift = 12;
+        while shift > 0 && (g >> shift) == 0 {
+            shift -= 4;
+        }
+        loop {
+            text[n] = HEX[((g >> shift) & 0xf) as usize];
+            n += 1;
+            if shift == 0 {
+                break;
+            }
+            shift -= 4;
+        }
+        i += 1;
+    }
+    out.put(&text[..n])
+}
+
+#[cfg(not(any(test, feature = "host")))]
 #[panic_handler]
 fn panic(_info: &PanicInfo) -> ! {
     loop {}
 }
 
-#[cfg(test)]
-extern crate std;
-
 #[cfg(test)]
 mod tests {
-    use super::{parse_payload, RustParsed};
+    use super::{
+        parse_payload, rust_encode_payload, rust_encode_payload_sink, rust_kv_feed,
+        rust_kv_finish, rust_kv_init, RustKvStorage, RustParsed, ENCODE_MAX, KV_STATE_WORDS,
+    };
+    use core::ffi::c_void;
+    use std::vec::Vec;
 
     #[test]
     fn parses_basic_fields() {
@@ -271,4 +416,277 @@ mod tests {
         assert_eq!(out.has_z, 1);
         assert_eq!(out.z, 3);
     }
+
+    #[test]
+    fn parses_state_rsp_with_owner() {
+        let out = parse_payload(b"e=1234;a=1;r=287500;o=fd11:2233:4455:0:1a2b:3c4d:5e6f:7081").unwrap();
+        assert_eq!(out.epoch, 1234);
+        assert_eq!(out.has_rem_ms, 1);
+        assert_eq!(out.rem_ms, 287500);
+        assert_eq!(out.active, 1);
+        assert_eq!(out.has_owner, 1);
+        assert_eq!(
+            out.owner,
+            [0xfd, 0x11, 0x22, 0x33, 0x44, 0x55, 0, 0, 0x1a, 0x2b, 0x3c, 0x4d, 0x5e, 0x6f, 0x70, 0x81]
+        );
+    }
+
+    #[test]
+    fn parses_compressed_owner() {
+        let mut want = [0u8; 16];
+        assert_eq!(parse_payload(b"o=::").unwrap().owner, want);
+        want[15] = 1;
+        assert_eq!(parse_payload(b"o=::1").unwrap().owner, want);
+        let out = parse_payload(b"o = FD00:0:0:1::ABCD ;e=1").unwrap();
+        assert_eq!(out.has_owner, 1);
+        assert_eq!(out.owner, [0xfd, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0xab, 0xcd]);
+        let out = parse_payload(b"o=1:2:3:4:5:6:7::").unwrap();
+        assert_eq!(out.owner, [0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0, 7, 0, 0]);
+    }
+
+    #[test]
+    fn bad_owner_is_skipped() {
+        for bad in [
+            &b"o=1:2:3:4:5:6:7:8:9"[..],
+            b"o=1:2:3:4:5:6:7",
+            b"o=1::2::3",
+            b"o=:1::",
+            b"o=1:::2",
+            b"o=1::2:",
+            b"o=12345::",
+            b"o=fe80::1%wpan0",
+            b"o=fe80:: 1",
+        ] {
+            let out = parse_payload(bad).unwrap();
+            assert_eq!(out.has_owner, 0);
+        }
+        let out = parse_payload(b"o=::1;o=zz;e=3").unwrap();
+        assert_eq!(out.has_owner, 1);
+        assert_eq!(out.owner[15], 1);
+        assert_eq!(out.epoch, 3);
+    }
+
+    #[test]
+    fn unknown_key_value_not_checked() {
+        let out = parse_payload(b"x=abc;e=2").unwrap();
+        assert_eq!(out.has_epoch, 1);
+        assert_eq!(out.epoch, 2);
+    }
+
+    fn encode(p: &RustParsed) -> Vec<u8> {
+        let mut buf = [0u8; ENCODE_MAX];
+        let n = rust_encode_payload(p, buf.as_mut_ptr(), buf.len() as u32) as usize;
+        buf[..n].to_vec()
+    }
+
+    fn owner(text: &[u8]) -> [u8; 16] {
+        let mut payload = b"o=".to_vec();
+        payload.extend_from_slice(text);
+        let out = parse_payload(&payload).unwrap();
+        assert_eq!(out.has_owner, 1);
+        out.owner
+    }
+
+    fn state_rsp() -> RustParsed {
+        let mut p = RustParsed::default();
+        p.has_epoch = 1;
+        p.epoch = 1234;
+        p.has_active = 1;
+        p.active = 1;
+        p.has_rem_ms = 1;
+        p.rem_ms = 287500;
+        p.has_owner = 1;
+        p.owner = owner(b"fd11:2233:4455:0:1a2b:3c4d:5e6f:7081");
+        p
+    }
+
+    #[test]
+    fn encodes_state_rsp() {
+        assert_eq!(
+            encode(&state_rsp()),
+            b"e=1234;a=1;r=287500;o=fd11:2233:4455:0:1a2b:3c4d:5e6f:7081".to_vec()
+        );
+    }
+
+    #[test]
+    fn encodes_trigger_off_and_mode() {
+        let mut p = RustParsed::default();
+        p.has_epoch = 1;
+        p.epoch = 4294967295;
+        assert_eq!(encode(&p), b"e=4294967295".to_vec());
+        p.has_rem_ms = 1;
+        p.rem_ms = 0;
+        assert_eq!(encode(&p), b"e=4294967295;h=0".to_vec());
+
+        let mut p = RustParsed::default();
+        p.has_m = 1;
+        p.m = 0;
+        p.has_z = 1;
+        p.z = 3;
+        assert_eq!(encode(&p), b"m=0;z=3".to_vec());
+        assert_eq!(encode(&RustParsed::default()), b"".to_vec());
+    }
+
+    #[test]
+    fn compresses_owner() {
+        let cases: [(&[u8], &[u8]); 7] = [
+            (b"::", b"::"),
+            (b"::1", b"::1"),
+            (b"fe80::", b"fe80::"),
+            (b"fd00:0:0:1::abcd", b"fd00:0:0:1::abcd"),
+            (b"1:0:0:2:0:0:0:3", b"1:0:0:2::3"),
+            (b"1:0:2:3:4:5:6:7", b"1:0:2:3:4:5:6:7"),
+            (b"FFFF:0:0:0:0:0:0:0", b"ffff::"),
+        ];
+        for (input, want) in cases.iter() {
+            let mut p = RustParsed::default();
+            p.has_owner = 1;
+            p.owner = owner(input);
+            let mut expect = b"o=".to_vec();
+            expect.extend_from_slice(want);
+            assert_eq!(encode(&p), expect);
+        }
+    }
+
+    #[test]
+    fn round_trips_through_parser() {
+        let mut p = state_rsp();
+        p.has_mode = 1;
+        p.mode = 255;
+        p.has_m = 1;
+        p.m = 2;
+        p.has_clr = 1;
+        p.clr = 4294967295;
+        p.has_z = 1;
+        p.z = 7;
+        p.rem_ms = 4294967295;
+        p.epoch = 4294967295;
+        p.owner = owner(b"ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
+        let text = encode(&p);
+        assert!(text.len() <= ENCODE_MAX);
+        let back = parse_payload(&text).unwrap();
+        assert_eq!(encode(&back), text);
+        assert_eq!(back.owner, p.owner);
+        assert_eq!(back.clr, p.clr);
+    }
+
+    #[test]
+    fn rejects_small_buffer_and_bad_fields() {
+        let p = state_rsp();
+        let full = encode(&p).len();
+        let mut buf = [0u8; ENCODE_MAX];
+        assert_eq!(rust_encode_payload(&p, buf.as_mut_ptr(), (full - 1) as u32), 0);
+        assert_eq!(rust_encode_payload(&p, buf.as_mut_ptr(), full as u32) as usize, full);
+
+        let mut bad = RustParsed::default();
+        bad.has_active = 1;
+        bad.active = 2;
+        assert_eq!(rust_encode_payload(&bad, buf.as_mut_ptr(), buf.len() as u32), 0);
+        bad = RustParsed::default();
+        bad.has_mode = 1;
+        bad.mode = 256;
+        assert_eq!(rust_encode_payload(&bad, buf.as_mut_ptr(), buf.len() as u32), 0);
+    }
+
+    extern "C" fn collect(ctx: *mut c_void, data: *const u8, len: u32) -> bool {
+        let out = unsafe { &mut *(ctx as *mut Vec<Vec<u8>>) };
+        let chunk = unsafe { std::slice::from_raw_parts(data, len as usize) };
+        out.push(chunk.to_vec());
+        true
+    }
+
+    extern "C" fn refuse(_ctx: *mut c_void, _data: *const u8, _len: u32) -> bool {
+        false
+    }
+
+    #[test]
+    fn sink_matches_buffer() {
+        let p = state_rsp();
+        let mut chunks: Vec<Vec<u8>> = Vec::new();
+        let n = rust_encode_payload_sink(&p, Some(collect), &mut chunks as *mut _ as *mut c_void);
+        let joined: Vec<u8> = chunks.concat();
+        assert_eq!(n as usize, joined.len());
+        assert_eq!(joined, encode(&p));
+        assert!(chunks.len() > 1 && chunks.iter().all(|c| c.len() <= 32));
+        assert_eq!(rust_encode_payload_sink(&p, Some(refuse), core::ptr::null_mut()), 0);
+        assert_eq!(rust_encode_payload_sink(&p, None, core::ptr::null_mut()), 0);
+    }
+
+    // через FFI, как из coap_if.c: куски [0, split) и [split, len) или по байту
+    fn parse_chunked(input: &[u8], split: Option<usize>) -> Option<RustParsed> {
+        let mut kv = RustKvStorage([0; KV_STATE_WORDS]);
+        rust_kv_init(&mut kv);
+        match split {
+            Some(at) => {
+                rust_kv_feed(&mut kv, input[..at].as_ptr(), at as u32);
+                rust_kv_feed(&mut kv, input[at..].as_ptr(), (input.len() - at) as u32);
+            }
+            None => {
+                for b in input {
+                    rust_kv_feed(&mut kv, b, 1);
+                }
+            }
+        }
+        let mut out = RustParsed::default();
+        if rust_kv_finish(&mut kv, &mut out) == 1 {
+            Some(out)
+        } else {
+            None
+        }
+    }
+
+    fn same(a: &Option<RustParsed>, b: &Option<RustParsed>) -> bool {
+        match (a, b) {
+            (None, None) => true,
+            (Some(x), Some(y)) => {
+                let fields = |p: &RustParsed| {
+                    (
+                        [p.has_epoch, p.has_rem_ms, p.has_active, p.has_mode],
+                        [p.has_clr, p.has_z, p.has_m, p.has_owner],
+                        [p.epoch, p.rem_ms, p.active, p.mode, p.clr, p.z, p.m],
+                        p.owner,
+                    )
+                };
+                fields(x) == fields(y)
+            }
+            _ => false,
+        }
+    }
+
+    #[test]
+    fn chunked_matches_whole() {
+        let vectors: [&[u8]; 12] = [
+            b"epoch=10;rem_ms=250;active=1;mode=2",
+            b" e = 7 & h = 42 ; a = 0 ",
+            b"e=1234;a=1;r=287500;o=fd11:2233:4455:0:1a2b:3c4d:5e6f:7081",
+            b"o = FD00:0:0:1::ABCD ;e=1",
+            b"o=::1;o=zz;e=3",
+            b"o=fe80:: 1;e=3",
+            b"epoch=999999999999",
+            b"e=1 2",
+            b"active=2",
+            b"epochs=5;e p=5;verylongkey=5;x=abc;m=1;clr=2;z=3",
+            b"hello;=5;e=;e=2",
+            b"",
+        ];
+        for v in vectors.iter() {
+            let whole = parse_payload(v).ok();
+            assert!(same(&whole, &parse_chunked(v, None)), "{:?}", v);
+            for at in 0..=v.len() {
+                assert!(same(&whole, &parse_chunked(v, Some(at))), "{:?} @{}", v, at);
+            }
+        }
+    }
+
+    #[test]
+    fn chunked_state_rsp_fields() {
+        let out = parse_chunked(b"e=1234;a=1;r=287500;o=fd11:2233:4455:0:1a2b:3c4d:5e6f:7081", Some(30))
+            .unwrap();
+        assert_eq!(out.epoch, 1234);
+        assert_eq!(out.rem_ms, 287500);
+        assert_eq!(out.has_owner, 1);
+        assert_eq!(out.owner[0], 0xfd);
+        assert_eq!(out.owner[15], 0x81);
+        assert!(parse_chunked(b"e=12x", Some(3)).is_none());
+    }
 }
@@ -0,0 +1,350 @@
+// Потоковый разбор "key=value;key=value": состояние в RustKv, данные — кусками любого
+// размера (окна otMessageRead), один проход без буфера под весь payload. Правила те же,
+// что у эталона на хосте (host/coap_kv.h); rust_parse_payload — init + один feed + finish.
+
+use crate::RustParsed;
+
+#[derive(Copy, Clone, PartialEq, Eq)]
+#[repr(u8)]
+enum St {
+    KeyPre,   // до ключа (пробелы, разделители)
+    Key,
+    KeyTrail, // пробелы после ключа, до '='
+    ValPre,   // после '='
+    Val,
+    ValTrail, // пробелы после значения
+    Skip,     // до разделителя (неизвестный ключ, пустой ключ)
+}
+
+#[derive(Copy, Clone, PartialEq, Eq)]
+#[repr(u8)]
+enum Key {
+    Unknown,
+    Epoch,
+    RemMs,
+    Active,
+    Mode,
+    Clr,
+    Z,
+    M,
+    Owner,
+}
+
+const KEY_MAX: usize = 8;
+
+/// Состояние разбора; C видит его как rust_kv_t (RUST_KV_STATE_WORDS слов).
+#[repr(C)]
+pub struct RustKv {
+    out: RustParsed,
+    st: St,
+    key_id: Key,
+    key: [u8; KEY_MAX],
+    key_len: u8,
+    key_bad: bool, // длиннее key[] или с пробелом внутри — заведомо неизвестный
+    failed: bool,
+    num: u32,
+
+    // IPv6 (o=): группы, позиция "::" (-1 — нет), текущая группа
+    ip_groups: [u16; 8],
+    ip_dc: i8,
+    ip_ng: u8,
+    ip_nd: u8,
+    ip_colons: u8, // подряд идущие ':' перед текущим символом
+    ip_cur: u16,
+    ip_bad: bool,
+}
+
+fn is_sep(c: u8) -> bool {
+    c == b';' || c == b'&'
+}
+
+fn is_space(c: u8) -> bool {
+    c.is_ascii_whitespace()
+}
+
+fn hex_val(c: u8) -> Option<u16> {
+    match c {
+        b'0'..=b'9' => Some((c - b'0') as u16),
+        b'a'..=b'f' => Some((c - b'a' + 10) as u16),
+        b'A'..=b'F' => Some((c - b'A' + 10) as u16),
+        _ => None,
+    }
+}
+
+impl RustKv {
+    pub fn new() -> Self {
+        RustKv {
+            out: RustParsed::default(),
+            st: St::KeyPre,
+            key_id: Key::Unknown,
+            key: [0; KEY_MAX],
+            key_len: 0,
+            key_bad: false,
+            failed: false,
+            num: 0,
+            ip_groups: [0; 8],
+            ip_dc: -1,
+            ip_ng: 0,
+            ip_nd: 0,
+            ip_colons: 0,
+            ip_cur: 0,
+            ip_bad: false,
+        }
+    }
+
+    pub fn feed(&mut self, data: &[u8]) {
+        for &c in data {
+            if self.failed {
+                return;
+            }
+            self.step(c);
+        }
+    }
+
+    /// Закрыть последний токен; Err — payload отвергнут.
+    pub fn finish(&mut self) -> Result<RustParsed, ()> {
+        if !self.failed && (self.st == St::Val || self.st == St::ValTrail) {
+            self.val_commit();
+        }
+        self.st = St::KeyPre;
+        if self.failed {
+            Err(())
+        } else {
+            Ok(self.out)
+        }
+    }
+
+    fn key_lookup(&self) -> Key {
+        if self.key_bad {
+            return Key::Unknown;
+        }
+        match &self.key[..self.key_len as usize] {
+            b"epoch" | b"e" => Key::Epoch,
+            b"rem_ms" | b"h" | b"r" => Key::RemMs,
+            b"active" | b"a" => Key::Active,
+            b"mode" => Key::Mode,
+            b"clr" => Key::Clr,
+            b"z" => Key::Z,
+            b"m" => Key::M,
+            b"o" => Key::Owner,
+            _ => Key::Unknown,
+        }
+    }
+
+    // ---- IPv6 ----
+
+    fn ip_start(&mut self) {
+        self.ip_dc = -1;
+        self.ip_ng = 0;
+        self.ip_nd = 0;
+        self.ip_colons = 0;
+        self.ip_cur = 0;
+        self.ip_bad = false;
+    }
+
+    fn ip_push(&mut self) {
+        if self.ip_ng >= 8 {
+            self.ip_bad = true;
+            return;
+        }
+        self.ip_groups[self.ip_ng as usize] = self.ip_cur;
+        self.ip_ng += 1;
+        self.ip_cur = 0;
+        self.ip_nd = 0;
+    }
+
+    fn ip_char(&mut self, c: u8) {
+        if self.ip_bad {
+            return;
+        }
+        if let Some(h) = hex_val(c) {
+            // одиночное ':' в начале адреса допустимо только как часть "::"
+            if self.ip_nd == 4 || (self.ip_colons == 1 && self.ip_ng == 0 && self.ip_dc < 0) {
+                self.ip_bad = true;
+                return;
+            }
+            self.ip_cur = self.ip_cur << 4 | h;
+            self.ip_nd += 1;
+            self.ip_colons = 0;
+            return;
+        }
+        if c != b':' {
+            self.ip_bad = true;
+            return;
+        }
+        if self.ip_nd > 0 {
+            self.ip_push();
+            self.ip_colons = 1;
+        } else if self.ip_colons == 1 {
+            if self.ip_dc >= 0 {
+                self.ip_bad = true; // второй "::"
+                return;
+            }
+            self.ip_dc = self.ip_ng as i8;
+            self.ip_colons = 2;
+        } else if self.ip_colons == 0 && self.ip_ng == 0 && self.ip_dc < 0 {
+            self.ip_colons = 1; // первый ':' из ведущего "::"
+        } else {
+            self.ip_bad = true; // ":::"
+        }
+    }
+
+    fn ip_commit(&mut self) {
+        if self.ip_nd > 0 {
+            self.ip_push();
+        } else if self.ip_colons == 1 {
+            self.ip_bad = true; // адрес кончается одиночным ':'
+        }
+        let ng = self.ip_ng as usize;
+        if self.ip_bad || (if self.ip_dc < 0 { ng != 8 } else { ng > 7 }) {
+            return;
+        }
+
+        let mut g = [0u16; 8];
+        let head = if self.ip_dc < 0 { ng } else { self.ip_dc as usize };
+        let tail = ng - head;
+        g[..head].copy_from_slice(&self.ip_groups[..head]);
+        g[8 - tail..].copy_from_slice(&self.ip_groups[head..ng]);
+        for (i, v) in g.iter().enumerate() {
+            self.out.owner[2 * i..2 * i + 2].copy_from_slice(&v.to_be_bytes());
+        }
+        self.out.has_owner = 1;
+    }
+
+    // ---- значения ----
+
+    fn num_commit(&mut self) {
+        let o = &mut self.out;
+        let v = self.num;
+        match self.key_id {
+            Key::Epoch => {
+                o.has_epoch = 1;
+                o.epoch = v;
+            }
+            Key::RemMs => {
+                o.has_rem_ms = 1;
+                o.rem_ms = v;
+            }
+            Key::Active => {
+                if v > 1 {
+                    self.failed = true;
+                    return;
+                }
+                o.has_active = 1;
+                o.active = v;
+            }
+            Key::Mode => {
+                if v > u8::MAX as u32 {
+                    self.failed = true;
+                    return;
+                }
+                o.has_mode = 1;
+                o.mode = v;
+            }
+            Key::Clr => {
+                o.has_clr = 1;
+                o.clr = v;
+            }
+            Key::Z => {
+                o.has_z = 1;
+                o.z = v;
+            }
+            Key::M => {
+                o.has_m = 1;
+                o.m = v;
+            }
+            Key::Unknown | Key::Owner => {}
+        }
+    }
+
+    fn val_commit(&mut self) {
+        if self.key_id == Key::Owner {
+            self.ip_commit();
+        } else {
+            self.num_commit();
+        }
+    }
+
+    fn num_char(&mut self, c: u8) {
+        if !c.is_ascii_digit() {
+            self.failed = true;
+            return;
+        }
+        match self.num.checked_mul(10).and_then(|n| n.checked_add((c - b'0') as u32)) {
+            Some(n) => self.num = n,
+            None => self.failed = true,
+        }
+    }
+
+    fn val_char(&mut self, c: u8) {
+        if self.key_id == Key::Owner {
+            self.ip_char(c);
+        } else {
+            self.num_char(c);
+        }
+    }
+
+    fn step(&mut self, c: u8) {
+        match self.st {
+            St::KeyPre | St::Key | St::KeyTrail => {
+                if self.st == St::KeyPre {
+                    if is_space(c) || is_sep(c) {
+                        return;
+                    }
+                    self.key_len = 0;
+                    self.key_bad = false;
+                    self.st = St::Key;
+                }
+                if c == b'=' {
+                    self.key_id = if self.key_len == 0 { Key::Unknown } else { self.key_lookup() };
+                    self.st = if self.key_id == Key::Unknown { St::Skip } else { St::ValPre };
+                } else if is_sep(c) {
+                    self.st = St::KeyPre; // токен без '='
+                } else if is_space(c) {
+                    self.st = St::KeyTrail;
+                } else {
+                    if self.st == St::KeyTrail || self.key_len as usize >= KEY_MAX {
+                        self.key_bad = true; // пробел внутри ключа или слишком длинный
+                    } else {
+                        self.key[self.key_len as usize] = c;
+                        self.key_len += 1;
+                    }
+                    self.st = St::Key;
+                }
+            }
+            St::ValPre => {
+                if is_space(c) {
+                    return;
+                }
+                if is_sep(c) {
+                    self.st = St::KeyPre; // пустое значение
+                    return;
+                }
+                self.num = 0;
+                self.ip_start();
+                self.st = St::Val;
+                self.val_char(c);
+            }
+            St::Val | St::ValTrail => {
+                if is_sep(c) {
+                    self.val_commit();
+                    self.st = St::KeyPre;
+                } else if is_space(c) {
+                    self.st = St::ValTrail;
+                } else if self.st == St::ValTrail {
+                    // пробел внутри значения: число — ошибка, адрес — нечитаем
+                    self.failed = self.key_id != Key::Owner;
+                    self.ip_bad = true;
+                    self.st = St::Skip;
+                } else {
+                    self.val_char(c);
+                }
+            }
+            St::Skip => {
+                if is_sep(c) {
+                    self.st = St::KeyPre;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,171 @@
+// Binary zone payload (main/coap_bin.h): round-trip checks and bytes-on-air.
+//
+// For every zone message the text payload coap_if.c sent before and the binary
+// one it sends now (COAP_TX_BINARY) are built for representative values, and the
+// CoAP message size is printed for both:
+//   4 (header, NON, no token) + Uri-Path zone/<id>/<name> + Content-Format
+//   (binary only, 65001 -> 3 bytes) + payload marker + payload.
+// UDP/IPv6 (6LoWPAN-compressed) headers are the same for both and not counted.
+// Then encode/decode is checked on edge values and malformed input.
+//
+// Usage: coap_bin_size [-q]    exit code 1 on a failed check
+
+#include "coap_bin.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ZONE_ID_STR "1"
+
+static const uint8_t k_owner[16] = {
+    0xfd, 0x11, 0x22, 0x33, 0x44, 0x55, 0x00, 0x00,
+    0x1a, 0x2b, 0x3c, 0x4d, 0x5e, 0x6f, 0x70, 0x81,
+};
+
+static int s_fail;
+static bool s_quiet;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        s_fail++;
+    }
+}
+
+// как otIp6AddressToString: 8 групп %x через ':'
+static void owner_to_str(const uint8_t *a, char *out, size_t n)
+{
+    snprintf(out, n, "%x:%x:%x:%x:%x:%x:%x:%x",
+             a[0] << 8 | a[1], a[2] << 8 | a[3], a[4] << 8 | a[5], a[6] << 8 | a[7],
+             a[8] << 8 | a[9], a[10] << 8 | a[11], a[12] << 8 | a[13], a[14] << 8 | a[15]);
+}
+
+// CoAP без payload: заголовок + Uri-Path zone/<id>/<name> (+ Content-Format)
+static size_t coap_overhead(const char *name, bool binary)
+{
+    const char *segs[] = {"zone", ZONE_ID_STR, name};
+    size_t n = 4;
+    for (size_t i = 0; i < 3; i++) {
+        n += 1 + strlen(segs[i]);   // delta/len < 13 -> 1 байт заголовка опции
+    }
+    if (binary) {
+        n += 1 + 2;                 // Content-Format 65001
+    }
+    return n + 1;                   // маркер payload
+}
+
+static void row(const char *name, const char *text, const coap_bin_msg_t *bm)
+{
+    uint8_t bin[COAP_BIN_MAX_LEN];
+    size_t bin_len = coap_bin_encode(bm, bin, sizeof(bin));
+    check(bin_len > 0, name);
+
+    coap_bin_msg_t back;
+    check(coap_bin_decode(bin, bin_len, &back), name);
+    check(back.type == bm->type && back.flags == bm->flags && back.epoch == bm->epoch &&
+          back.rem_ms == bm->rem_ms && back.m == bm->m && back.clr == bm->clr && back.z == bm->z,
+          name);
+    if (bm->flags & COAP_BIN_F_OWNER_FULL) {
+        check(memcmp(back.owner, bm->owner, 16) == 0, name);
+    } else if (bm->flags & COAP_BIN_F_OWNER_IID) {
+        check(memcmp(&back.owner[8], &bm->owner[8], 8) == 0, name);
+    }
+
+    const char *uri = strchr(name, ' ') ? "state_rsp" : name;
+    size_t text_total = coap_overhead(uri, false) + strlen(text);
+    size_t bin_total = coap_overhead(uri, true) + bin_len;
+    if (!s_quiet) {
+        printf("%-16s %4zu -> %2zu   %4zu -> %3zu  (%+d)\n", name, strlen(text),
+               bin_len, text_total, bin_total, (int)bin_total - (int)text_total);
+    }
+}
+
+static void sizes(void)
+{
+    char text[128];
+    char owner[48];
+    owner_to_str(k_owner, owner, sizeof(owner));
+
+    if (!s_quiet) {
+        printf("message          payload       coap bytes (text -> bin)\n");
+    }
+
+    snprintf(text, sizeof(text), "epoch=%lu&rem_ms=%lu", 1234ul, 300000ul);
+    row("trigger", text, &(coap_bin_msg_t){.type = COAP_BIN_TRIGGER, .epoch = 1234, .rem_ms = 300000});
+
+    snprintf(text, sizeof(text), "e=%lu", 1234ul);
+    row("off", text, &(coap_bin_msg_t){.type = COAP_BIN_OFF, .epoch = 1234});
+
+    row("state_req", "1", &(coap_bin_msg_t){.type = COAP_BIN_STATE_REQ});
+
+    coap_bin_msg_t rsp = {.type = COAP_BIN_STATE_RSP, .epoch = 1234, .rem_ms = 287500};
+    memcpy(rsp.owner, k_owner, 16);
+    snprintf(text, sizeof(text), "e=%lu;a=%u;r=%lu;o=%s", 1234ul, 1u, 287500ul, owner);
+    rsp.flags = COAP_BIN_F_ACTIVE | COAP_BIN_F_OWNER_IID;
+    row("state_rsp iid", text, &rsp);
+    rsp.flags = COAP_BIN_F_ACTIVE | COAP_BIN_F_OWNER_FULL;
+    row("state_rsp full", text, &rsp);
+    snprintf(text, sizeof(text), "e=%lu;a=%u;r=%lu;o=%s", 1234ul, 0u, 0ul, "::");
+    row("state_rsp idle", text, &(coap_bin_msg_t){.type = COAP_BIN_STATE_RSP, .epoch = 1234});
+
+    snprintf(text, sizeof(text), "m=%u;z=%u;", 0u, 3u);
+    row("mode", text, &(coap_bin_msg_t){.type = COAP_BIN_MODE, .flags = COAP_BIN_F_M | COAP_BIN_F_Z, .z = 3});
+}
+
+static void edges(void)
+{
+    uint8_t buf[COAP_BIN_MAX_LEN];
+    coap_bin_msg_t out;
+
+    // максимальные varint и самое длинное сообщение
+    coap_bin_msg_t big = {.type = COAP_BIN_STATE_RSP, .flags = COAP_BIN_F_OWNER_FULL,
+                          .epoch = UINT32_MAX, .rem_ms = UINT32_MAX};
+    size_t n = coap_bin_encode(&big, buf, sizeof(buf));
+    check(n == COAP_BIN_MAX_LEN, "max length");
+    check(coap_bin_decode(buf, n, &out) && out.epoch == UINT32_MAX && out.rem_ms == UINT32_MAX,
+          "max varint");
+    check(coap_bin_encode(&big, buf, n - 1) == 0, "encode into short buffer");
+
+    // обрезанное, с хвостом, чужая версия, неизвестный тип, лишние флаги
+    coap_bin_msg_t trg = {.type = COAP_BIN_TRIGGER, .epoch = 300, .rem_ms = 70000};
+    n = coap_bin_encode(&trg, buf, sizeof(buf));
+    for (size_t cut = 0; cut < n; cut++) {
+        check(!coap_bin_decode(buf, cut, &out), "truncated");
+    }
+    buf[n] = 0;
+    check(!coap_bin_decode(buf, n + 1, &out), "trailing byte");
+    uint8_t hdr = buf[0];
+    buf[0] = (uint8_t)((hdr & 0x3F) | (2 << 6));
+    check(!coap_bin_decode(buf, n, &out), "version");
+    buf[0] = (uint8_t)((hdr & 0xC7) | (7 << 3));
+    check(!coap_bin_decode(buf, n, &out), "type");
+    buf[0] = (uint8_t)(hdr | 0x01);
+    check(!coap_bin_decode(buf, n, &out), "trigger flags");
+
+    // varint длиннее uint32
+    const uint8_t over[] = {(1 << 6) | (COAP_BIN_OFF << 3), 0xFF, 0xFF, 0xFF, 0xFF, 0x1F};
+    check(!coap_bin_decode(over, sizeof(over), &out), "varint overflow");
+
+    // IID и полный owner одновременно
+    const uint8_t both[] = {(1 << 6) | (COAP_BIN_STATE_RSP << 3) | COAP_BIN_F_OWNER_IID | COAP_BIN_F_OWNER_FULL, 0, 0};
+    check(!coap_bin_decode(both, sizeof(both), &out), "owner iid+full");
+
+    // mode: только clr
+    coap_bin_msg_t clr = {.type = COAP_BIN_MODE, .flags = COAP_BIN_F_CLR, .clr = 1};
+    n = coap_bin_encode(&clr, buf, sizeof(buf));
+    check(n == 2 && coap_bin_decode(buf, n, &out) && out.clr == 1 && out.flags == COAP_BIN_F_CLR,
+          "mode clr");
+}
+
+int main(int argc, char **argv)
+{
+    s_quiet = (argc > 1 && strcmp(argv[1], "-q") == 0);
+    sizes();
+    edges();
+    if (!s_quiet || s_fail) {
+        printf("%d check(s) failed\n", s_fail);
+    }
+    return s_fail ? 1 : 0;
+}
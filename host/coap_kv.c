@@ -0,0 +1,318 @@
+#include "coap_kv.h"
+
+#include <string.h>
+
+
+enum {
+    ST_KEY_PRE = 0,   // до ключа (пробелы, разделители)
+    ST_KEY,
+    ST_KEY_TRAIL,     // пробелы после ключа, до '='
+    ST_VAL_PRE,       // после '='
+    ST_VAL,
+    ST_VAL_TRAIL,     // пробелы после значения
+    ST_SKIP,          // до разделителя (неизвестный ключ, пустой ключ)
+};
+
+enum {
+    KEY_UNKNOWN = 0,
+    KEY_EPOCH,
+    KEY_REM_MS,
+    KEY_ACTIVE,
+    KEY_MODE,
+    KEY_CLR,
+    KEY_Z,
+    KEY_M,
+    KEY_OWNER,
+};
+
+static const struct {
+    const char *name;
+    uint8_t id;
+} k_keys[] = {
+    {"epoch", KEY_EPOCH}, {"e", KEY_EPOCH},
+    {"rem_ms", KEY_REM_MS}, {"h", KEY_REM_MS}, {"r", KEY_REM_MS},
+    {"active", KEY_ACTIVE}, {"a", KEY_ACTIVE},
+    {"mode", KEY_MODE},
+    {"clr", KEY_CLR},
+    {"z", KEY_Z},
+    {"m", KEY_M},
+    {"o", KEY_OWNER},
+};
+
+void coap_kv_init(coap_kv_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+static bool is_sep(uint8_t c)
+{
+    return c == ';' || c == '&';
+}
+
+static bool is_space(uint8_t c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static int hex_val(uint8_t c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static uint8_t key_lookup(const coap_kv_t *p)
+{
+    if (p->key_bad) {
+        return KEY_UNKNOWN;
+    }
+    for (size_t i = 0; i < sizeof(k_keys) / sizeof(k_keys[0]); i++) {
+        if (strlen(k_keys[i].name) == p->key_len &&
+            memcmp(k_keys[i].name, p->key, p->key_len) == 0) {
+            return k_keys[i].id;
+        }
+    }
+    return KEY_UNKNOWN;
+}
+
+// ---- IPv6 ----
+
+static void ip_start(coap_kv_t *p)
+{
+    p->ip_dc = -1;
+    p->ip_ng = 0;
+    p->ip_nd = 0;
+    p->ip_colons = 0;
+    p->ip_cur = 0;
+    p->ip_bad = false;
+}
+
+static void ip_push(coap_kv_t *p)
+{
+    if (p->ip_ng >= 8) {
+        p->ip_bad = true;
+        return;
+    }
+    p->ip_groups[p->ip_ng++] = p->ip_cur;
+    p->ip_cur = 0;
+    p->ip_nd = 0;
+}
+
+static void ip_char(coap_kv_t *p, uint8_t c)
+{
+    if (p->ip_bad) {
+        return;
+    }
+    int h = hex_val(c);
+    if (h >= 0) {
+        // одиночное ':' в начале адреса допустимо только как часть "::"
+        if (p->ip_nd == 4 || (p->ip_colons == 1 && p->ip_ng == 0 && p->ip_dc < 0)) {
+            p->ip_bad = true;
+            return;
+        }
+        p->ip_cur = (uint16_t)(p->ip_cur << 4 | (uint16_t)h);
+        p->ip_nd++;
+        p->ip_colons = 0;
+        return;
+    }
+    if (c != ':') {
+        p->ip_bad = true;
+        return;
+    }
+    if (p->ip_nd > 0) {
+        ip_push(p);
+        p->ip_colons = 1;
+    } else if (p->ip_colons == 1) {
+        if (p->ip_dc >= 0) {
+            p->ip_bad = true;   // второй "::"
+            return;
+        }
+        p->ip_dc = (int8_t)p->ip_ng;
+        p->ip_colons = 2;
+    } else if (p->ip_colons == 0 && p->ip_ng == 0 && p->ip_dc < 0) {
+        p->ip_colons = 1;       // первый ':' из ведущего "::"
+    } else {
+        p->ip_bad = true;       // ":::"
+    }
+}
+
+static void ip_commit(coap_kv_t *p)
+{
+    if (p->ip_nd > 0) {
+        ip_push(p);
+    } else if (p->ip_colons == 1) {
+        p->ip_bad = true;       // адрес кончается одиночным ':'
+    }
+    if (p->ip_bad || (p->ip_dc < 0 ? p->ip_ng != 8 : p->ip_ng > 7)) {
+        return;
+    }
+
+    uint16_t g[8] = {0};
+    uint8_t head = (p->ip_dc < 0) ? p->ip_ng : (uint8_t)p->ip_dc;
+    uint8_t tail = (uint8_t)(p->ip_ng - head);
+    for (uint8_t i = 0; i < head; i++) {
+        g[i] = p->ip_groups[i];
+    }
+    for (uint8_t i = 0; i < tail; i++) {
+        g[8 - tail + i] = p->ip_groups[head + i];
+    }
+    for (int i = 0; i < 8; i++) {
+        p->out.owner[2 * i] = (uint8_t)(g[i] >> 8);
+        p->out.owner[2 * i + 1] = (uint8_t)g[i];
+    }
+    p->out.has_owner = 1;
+}
+
+// ---- значения ----
+
+static void num_commit(coap_kv_t *p)
+{
+    rust_parsed_t *o = &p->out;
+    uint32_t v = p->num;
+    switch (p->key_id) {
+        case KEY_EPOCH:  o->has_epoch = 1;  o->epoch = v;  break;
+        case KEY_REM_MS: o->has_rem_ms = 1; o->rem_ms = v; break;
+        case KEY_ACTIVE:
+            if (v > 1) {
+                p->failed = true;
+                return;
+            }
+            o->has_active = 1;
+            o->active = v;
+            break;
+        case KEY_MODE:
+            if (v > UINT8_MAX) {
+                p->failed = true;
+                return;
+            }
+            o->has_mode = 1;
+            o->mode = v;
+            break;
+        case KEY_CLR: o->has_clr = 1; o->clr = v; break;
+        case KEY_Z:   o->has_z = 1;   o->z = v;   break;
+        case KEY_M:   o->has_m = 1;   o->m = v;   break;
+        default: break;
+    }
+}
+
+static void val_commit(coap_kv_t *p)
+{
+    if (p->key_id == KEY_OWNER) {
+        ip_commit(p);
+    } else {
+        num_commit(p);
+    }
+}
+
+static void num_char(coap_kv_t *p, uint8_t c)
+{
+    if (c < '0' || c > '9') {
+        p->failed = true;
+        return;
+    }
+    uint32_t d = (uint32_t)(c - '0');
+    if (p->num > (UINT32_MAX - d) / 10) {
+        p->failed = true;
+        return;
+    }
+    p->num = p->num * 10 + d;
+}
+
+static void val_char(coap_kv_t *p, uint8_t c)
+{
+    if (p->key_id == KEY_OWNER) {
+        ip_char(p, c);
+    } else {
+        num_char(p, c);
+    }
+}
+
+static void step(coap_kv_t *p, uint8_t c)
+{
+    switch (p->st) {
+        case ST_KEY_PRE:
+            if (is_space(c) || is_sep(c)) {
+                return;
+            }
+            p->key_len = 0;
+            p->key_bad = false;
+            p->st = ST_KEY;
+            /* fallthrough */
+        case ST_KEY:
+        case ST_KEY_TRAIL:
+            if (c == '=') {
+                p->key_id = (p->key_len == 0) ? KEY_UNKNOWN : key_lookup(p);
+                p->st = (p->key_id == KEY_UNKNOWN) ? ST_SKIP : ST_VAL_PRE;
+            } else if (is_sep(c)) {
+                p->st = ST_KEY_PRE;            // токен без '='
+            } else if (is_space(c)) {
+                p->st = ST_KEY_TRAIL;
+            } else {
+                if (p->st == ST_KEY_TRAIL || p->key_len >= sizeof(p->key)) {
+                    p->key_bad = true;         // пробел внутри ключа или слишком длинный
+                } else {
+                    p->key[p->key_len++] = (char)c;
+                }
+                p->st = ST_KEY;
+            }
+            return;
+        case ST_VAL_PRE:
+            if (is_space(c)) {
+                return;
+            }
+            if (is_sep(c)) {
+                p->st = ST_KEY_PRE;            // пустое значение
+                return;
+            }
+            p->num = 0;
+            ip_start(p);
+            p->st = ST_VAL;
+            val_char(p, c);
+            return;
+        case ST_VAL:
+        case ST_VAL_TRAIL:
+            if (is_sep(c)) {
+                val_commit(p);
+                p->st = ST_KEY_PRE;
+            } else if (is_space(c)) {
+                p->st = ST_VAL_TRAIL;
+            } else if (p->st == ST_VAL_TRAIL) {
+                // пробел внутри значения: число — ошибка, адрес — нечитаем
+                p->failed = (p->key_id != KEY_OWNER);
+                p->ip_bad = true;
+                p->st = ST_SKIP;
+            } else {
+                val_char(p, c);
+            }
+            return;
+        default:
+            if (is_sep(c)) {
+                p->st = ST_KEY_PRE;
+            }
+            return;
+    }
+}
+
+void coap_kv_feed(coap_kv_t *p, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len && !p->failed; i++) {
+        step(p, data[i]);
+    }
+}
+
+bool coap_kv_finish(coap_kv_t *p)
+{
+    if (!p->failed) {
+        switch (p->st) {
+            case ST_VAL:
+            case ST_VAL_TRAIL:
+                val_commit(p);
+                break;
+            default:
+                break;
+        }
+    }
+    p->st = ST_KEY_PRE;
+    return !p->failed;
+}
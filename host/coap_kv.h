@@ -0,0 +1,57 @@
+#pragma once
+
+// Потоковый разбор текстового payload зоны "key=value;key=value" (разделители ';' и '&').
+// Данные подаются кусками любого размера (окна otMessageRead), один проход без
+// промежуточного буфера под весь payload.
+//
+// Только на хосте: эталон для payload_diff и coap_kv_check. В прошивке текст разбирает
+// Rust (rust_kv_*, components/rust_payload/rust/payload_parser/src/stream.rs).
+//
+// Ключи и правила — как у Rust-парсера: epoch/e, rem_ms/h/r, active/a, mode, m, clr, z и
+// o (IPv6 owner, с "::", в out.owner). Пробелы вокруг ключа/значения допустимы, токен
+// без '=' и пустые ключ/значение пропускаются; у числового ключа значение — только
+// десятичные цифры в пределах uint32, иначе весь разбор неуспешен (active/a <= 1,
+// mode <= 255). Значение неизвестного ключа не проверяется, нечитаемый o= — owner
+// просто не задан.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rust_payload.h"   // rust_parsed_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    rust_parsed_t out;
+
+    // состояние разбора
+    uint8_t st;
+    uint8_t key_id;
+    char key[8];
+    uint8_t key_len;
+    bool key_bad;         // длиннее key[] или с пробелом внутри — заведомо неизвестный
+    bool failed;
+    uint32_t num;
+
+    // IPv6 (o=): группы, позиция "::" (-1 — нет), текущая группа
+    uint16_t ip_groups[8];
+    int8_t ip_dc;
+    uint8_t ip_ng;
+    uint8_t ip_nd;
+    uint8_t ip_colons;    // подряд идущие ':' перед текущим символом
+    uint16_t ip_cur;
+    bool ip_bad;
+} coap_kv_t;
+
+void coap_kv_init(coap_kv_t *p);
+void coap_kv_feed(coap_kv_t *p, const uint8_t *data, size_t len);
+
+// закрыть последний токен; false — payload отвергнут (см. правила выше)
+bool coap_kv_finish(coap_kv_t *p);
+
+#ifdef __cplusplus
+}
+#endif
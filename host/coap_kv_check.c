@@ -0,0 +1,164 @@
+// Streaming text payload parser (host/coap_kv.h, the host reference for the Rust
+// parser): every vector is fed whole, byte by byte and split at every position into two
+// chunks, the way coap_if.c feeds otMessageRead windows; all splits must give the same
+// result.
+//
+// Vectors: the Rust parser unit tests, the text payloads coap_if.c has always sent
+// (state_rsp with o=), IPv6 forms and the inputs that must be rejected.
+//
+// Usage: coap_kv_check [-q]    exit code 1 on a failed check
+
+#include "coap_kv.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NA (-1)              // поле не должно быть задано
+#define BAD(s) {s, false, NA, NA, NA, NA, NA, NA, NA, NULL}
+
+typedef struct {
+    const char *in;
+    bool ok;
+    int64_t epoch, rem_ms, active, mode, m, clr, z;
+    const char *owner;   // NULL — owner не задан; иначе 32 hex-символа
+} vec_t;
+
+static const vec_t k_vecs[] = {
+    // Rust payload_parser tests
+    {"epoch=10;rem_ms=250;active=1;mode=2", true, 10, 250, 1, 2, NA, NA, NA, NULL},
+    {" e = 7 & h = 42 ; a = 0 ", true, 7, 42, 0, NA, NA, NA, NA, NULL},
+    {"foo=1;epoch=3", true, 3, NA, NA, NA, NA, NA, NA, NULL},
+    BAD("epoch=999999999999"),
+    BAD("epoch=12x"),
+    BAD("active=2"),
+    {"m=1;clr=2;z=3", true, NA, NA, NA, NA, 1, 2, 3, NULL},
+
+    // то, что шлёт coap_if.c в текстовом режиме
+    {"epoch=1234&rem_ms=300000", true, 1234, 300000, NA, NA, NA, NA, NA, NULL},
+    {"e=1234", true, 1234, NA, NA, NA, NA, NA, NA, NULL},
+    {"m=0;z=3;", true, NA, NA, NA, NA, 0, NA, 3, NULL},
+    {"e=1234;a=1;r=287500;o=fd11:2233:4455:0:1a2b:3c4d:5e6f:7081", true,
+     1234, 287500, 1, NA, NA, NA, NA, "fd112233445500001a2b3c4d5e6f7081"},
+    {"e=1234;a=0;r=0;o=::", true, 1234, 0, 0, NA, NA, NA, NA, "00000000000000000000000000000000"},
+
+    // границы чисел и пробелы
+    {"e=4294967295", true, 4294967295u, NA, NA, NA, NA, NA, NA, NULL},
+    BAD("e=4294967296"),
+    {"e=0000000000012", true, 12, NA, NA, NA, NA, NA, NA, NULL},
+    {"mode=255", true, NA, NA, NA, 255, NA, NA, NA, NULL},
+    BAD("mode=256"),
+    BAD("e=1 2"),
+    BAD("e=-1"),
+    BAD("e=+1"),
+    BAD("e=1=2"),
+    {"e=\t5\r\n", true, 5, NA, NA, NA, NA, NA, NA, NULL},
+    BAD("e=5\v"),
+
+    // пропускаемое: пустые ключ/значение, токен без '=', неизвестные ключи
+    {"", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {";;&&  ;", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"e=;a=1", true, NA, NA, 1, NA, NA, NA, NA, NULL},
+    {"=5;e=2", true, 2, NA, NA, NA, NA, NA, NA, NULL},
+    {"hello;e=2;bye", true, 2, NA, NA, NA, NA, NA, NA, NULL},
+    {"x=abc;e=2", true, 2, NA, NA, NA, NA, NA, NA, NULL},
+    {"epochs=5;e p=5;verylongkey=5", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"e=1;e=2", true, 2, NA, NA, NA, NA, NA, NA, NULL},
+
+    // IPv6: формы "::", нечитаемый адрес — owner не задан, разбор успешен
+    {"o=::1", true, NA, NA, NA, NA, NA, NA, NA, "00000000000000000000000000000001"},
+    {"o=fe80::", true, NA, NA, NA, NA, NA, NA, NA, "fe800000000000000000000000000000"},
+    {"o=FD00:0:0:1::ABCD", true, NA, NA, NA, NA, NA, NA, NA, "fd00000000000001000000000000abcd"},
+    {"o=1:2:3:4:5:6:7::", true, NA, NA, NA, NA, NA, NA, NA, "00010002000300040005000600070000"},
+    {"o = ::2 ;e=1", true, 1, NA, NA, NA, NA, NA, NA, "00000000000000000000000000000002"},
+    {"o=1:2:3:4:5:6:7:8:9", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=1:2:3:4:5:6:7", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=1::2::3", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=:1::", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=1:::2", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=1::2:", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=12345::", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=fe80::1%wpan0", true, NA, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=fe80:: 1;e=3", true, 3, NA, NA, NA, NA, NA, NA, NULL},
+    {"o=1:2:3:4:5:6:7:8", true, NA, NA, NA, NA, NA, NA, NA, "00010002000300040005000600070008"},
+};
+
+static int s_fail;
+
+static void hex_owner(const uint8_t *a, char *out)
+{
+    for (int i = 0; i < 16; i++) {
+        sprintf(&out[2 * i], "%02x", a[i]);
+    }
+}
+
+static bool field_ok(uint32_t has, uint32_t v, int64_t want)
+{
+    return want == NA ? !has : (has && v == want);
+}
+
+static bool same(const vec_t *v, bool ok, const coap_kv_t *p)
+{
+    if (ok != v->ok) {
+        return false;
+    }
+    if (!ok) {
+        return true;
+    }
+    const rust_parsed_t *o = &p->out;
+    if (!field_ok(o->has_epoch, o->epoch, v->epoch) ||
+        !field_ok(o->has_rem_ms, o->rem_ms, v->rem_ms) ||
+        !field_ok(o->has_active, o->active, v->active) ||
+        !field_ok(o->has_mode, o->mode, v->mode) ||
+        !field_ok(o->has_m, o->m, v->m) ||
+        !field_ok(o->has_clr, o->clr, v->clr) ||
+        !field_ok(o->has_z, o->z, v->z)) {
+        return false;
+    }
+    if (!v->owner) {
+        return !o->has_owner;
+    }
+    char hex[33];
+    hex_owner(o->owner, hex);
+    return o->has_owner && strcmp(hex, v->owner) == 0;
+}
+
+// split: SIZE_MAX — по байту, иначе два куска [0, split) и [split, len)
+static void run(const vec_t *v, size_t split)
+{
+    const uint8_t *in = (const uint8_t *)v->in;
+    size_t len = strlen(v->in);
+    coap_kv_t p;
+    coap_kv_init(&p);
+    if (split == SIZE_MAX) {
+        for (size_t i = 0; i < len; i++) {
+            coap_kv_feed(&p, &in[i], 1);
+        }
+    } else {
+        coap_kv_feed(&p, in, split);
+        coap_kv_feed(&p, &in[split], len - split);
+    }
+    bool ok = coap_kv_finish(&p);
+    if (!same(v, ok, &p)) {
+        fprintf(stderr, "FAIL: '%s' split=%ld: ok=%d (want %d)\n", v->in,
+                split == SIZE_MAX ? -1L : (long)split, ok, v->ok);
+        s_fail++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool quiet = (argc > 1 && strcmp(argv[1], "-q") == 0);
+    size_t n = sizeof(k_vecs) / sizeof(k_vecs[0]);
+    for (size_t i = 0; i < n; i++) {
+        size_t len = strlen(k_vecs[i].in);
+        run(&k_vecs[i], SIZE_MAX);
+        for (size_t split = 0; split <= len; split++) {
+            run(&k_vecs[i], split);
+        }
+    }
+    if (!quiet || s_fail) {
+        printf("%zu vector(s), %d check(s) failed\n", n, s_fail);
+    }
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,381 @@
+#include "host_backends.h"
+
+#include "coap_if.h"
+#include "netdata_if.h"
+#include "config.h"
+#include "config_store.h"
+#include "io_board.h"
+#include "rgb_led.h"
+
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+host_counters_t g_host_counters;
+int g_host_log_level;
+
+// ===== clock =====
+
+static int64_t s_now_us;
+
+void host_clock_set(int64_t now_us)
+{
+    s_now_us = now_us;
+}
+
+int64_t host_clock_now(void)
+{
+    return s_now_us;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+// ===== random =====
+
+#define HOST_RANDOM_SEED 0x2545F491u
+
+static uint32_t s_rand = HOST_RANDOM_SEED;
+
+uint32_t esp_random(void)
+{
+    // xorshift32
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return s_rand;
+}
+
+// ===== log =====
+
+void host_log(char level, const char *tag, const char *fmt, ...)
+{
+    int need;
+    switch (level) {
+        case 'E':
+        case 'W': need = 1; break;
+        case 'I': need = 2; break;
+        default:  need = 3; break;
+    }
+    if (g_host_log_level < need) {
+        return;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    printf("%c (%lld) %s: ", level, (long long)(s_now_us / 1000), tag);
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+}
+
+// ===== config_store =====
+
+static app_config_t s_cfg = {
+    .zone_id = ZONE_ID,
+    .auto_hold_ms = AUTO_HOLD_MS,
+    .tfmini_trigger_cm = TFMINI_TRIGGER_CM,
+    .tfmini_release_cm = TFMINI_RELEASE_CM,
+};
+
+const app_config_t *config_store_get(void)
+{
+    return &s_cfg;
+}
+
+void host_set_auto_hold_ms(uint32_t hold_ms)
+{
+    s_cfg.auto_hold_ms = hold_ms;
+}
+
+// ===== io_board / rgb_led =====
+
+static bool s_relay_on[LOGIC_MAX_ZONES];
+
+void io_board_set_relay_ch(uint8_t ch, bool on)
+{
+    if (ch >= LOGIC_MAX_ZONES) {
+        return;
+    }
+    g_host_counters.relay_writes++;
+    if (on != s_relay_on[ch]) {
+        g_host_counters.relay_toggles++;
+    }
+    s_relay_on[ch] = on;
+}
+
+bool io_board_get_relay_ch(uint8_t ch)
+{
+    return (ch < LOGIC_MAX_ZONES) ? s_relay_on[ch] : false;
+}
+
+void io_board_set_relay(bool on)
+{
+    io_board_set_relay_ch(0, on);
+}
+
+bool io_board_get_relay(void)
+{
+    return s_relay_on[0];
+}
+
+bool host_relay_on(uint8_t ch)
+{
+    return io_board_get_relay_ch(ch);
+}
+
+light_mode_t io_board_read_mode_switch(void)
+{
+    return MODE_AUTO;
+}
+
+void rgb_set_mode_color(light_mode_t m)
+{
+    (void)m;
+    g_host_counters.led_updates++;
+}
+
+// ===== coap_if =====
+
+static bool s_my_addr_valid;
+static otIp6Address s_my_addr;
+static bool s_thread_ready = true;
+
+void host_set_my_addr(const otIp6Address *addr)
+{
+    s_my_addr_valid = (addr != NULL);
+    if (addr) {
+        s_my_addr = *addr;
+    }
+}
+
+void host_set_thread_ready(bool ready)
+{
+    s_thread_ready = ready;
+}
+
+bool coap_if_get_my_meshlocal_eid(otIp6Address *out)
+{
+    if (!s_my_addr_valid || !out) {
+        return false;
+    }
+    *out = s_my_addr;
+    return true;
+}
+
+bool coap_if_thread_ready(void)
+{
+    return s_thread_ready;
+}
+
+void coap_if_send_state_req(uint8_t zone_id)
+{
+    (void)zone_id;
+    g_host_counters.tx_state_req++;
+}
+
+void coap_if_send_state_rsp(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                            uint32_t remaining_ms, bool active)
+{
+    (void)zone_id;
+    (void)epoch;
+    (void)owner;
+    (void)remaining_ms;
+    (void)active;
+    g_host_counters.tx_state_rsp++;
+}
+
+void coap_if_send_trigger(uint8_t zone_id, uint32_t epoch, uint32_t rem_ms)
+{
+    (void)zone_id;
+    (void)epoch;
+    (void)rem_ms;
+    g_host_counters.tx_trigger++;
+}
+
+void coap_if_send_off(uint8_t zone_id, uint32_t epoch)
+{
+    (void)zone_id;
+    (void)epoch;
+    g_host_counters.tx_off++;
+}
+
+void coap_if_notify_state(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                          uint32_t rem_ms, bool active, bool final)
+{
+    (void)zone_id;
+    (void)epoch;
+    (void)owner;
+    (void)rem_ms;
+    (void)active;
+    (void)final;
+    g_host_counters.tx_notify++;
+}
+
+void coap_if_get_state(uint8_t zone_id, const otIp6Address *dst)
+{
+    (void)zone_id;
+    (void)dst;
+    g_host_counters.tx_state_get++;
+}
+
+// ===== netdata_if =====
+
+bool netdata_if_publish(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                        uint32_t rem_ms, bool active)
+{
+    (void)zone_id;
+    (void)epoch;
+    (void)owner;
+    (void)rem_ms;
+    (void)active;
+    if (!s_thread_ready) {
+        return false;
+    }
+    g_host_counters.netdata_pub++;
+    return true;
+}
+
+bool netdata_if_withdraw(uint8_t zone_id)
+{
+    (void)zone_id;
+    if (!s_thread_ready) {
+        return false;
+    }
+    g_host_counters.netdata_del++;
+    return true;
+}
+
+// ===== NVS (in-memory, single namespace table) =====
+
+#define HOST_NVS_MAX_KEYS 32
+#define HOST_NVS_MAX_VAL  48
+
+typedef struct {
+    char ns[16];
+    char key[16];
+    uint8_t len;
+    uint8_t val[HOST_NVS_MAX_VAL];
+} host_nvs_entry_t;
+
+static host_nvs_entry_t s_nvs[HOST_NVS_MAX_KEYS];
+static size_t s_nvs_count;
+static const char *s_nvs_open_ns[4];
+
+static host_nvs_entry_t *nvs_find(nvs_handle_t h, const char *key, bool create)
+{
+    const char *ns = s_nvs_open_ns[h & 3];
+    for (size_t i = 0; i < s_nvs_count; i++) {
+        if (strcmp(s_nvs[i].ns, ns) == 0 && strcmp(s_nvs[i].key, key) == 0) {
+            return &s_nvs[i];
+        }
+    }
+    if (!create || s_nvs_count >= HOST_NVS_MAX_KEYS) {
+        return NULL;
+    }
+    host_nvs_entry_t *e = &s_nvs[s_nvs_count++];
+    memset(e, 0, sizeof(*e));
+    snprintf(e->ns, sizeof(e->ns), "%s", ns);
+    snprintf(e->key, sizeof(e->key), "%s", key);
+    return e;
+}
+
+static esp_err_t nvs_set(nvs_handle_t h, const char *key, const void *v, size_t n)
+{
+    if (n > HOST_NVS_MAX_VAL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_nvs_entry_t *e = nvs_find(h, key, true);
+    if (!e) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(e->val, v, n);
+    e->len = (uint8_t)n;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_get(nvs_handle_t h, const char *key, void *v, size_t n)
+{
+    host_nvs_entry_t *e = nvs_find(h, key, false);
+    if (!e || e->len != n) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    memcpy(v, e->val, n);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (open_mode == NVS_READONLY) {
+        bool any = false;
+        for (size_t i = 0; i < s_nvs_count; i++) {
+            any |= (strcmp(s_nvs[i].ns, name) == 0);
+        }
+        if (!any) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+    static nvs_handle_t next;
+    nvs_handle_t h = (next++) & 3;
+    s_nvs_open_ns[h] = name;
+    *out_handle = h;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    s_nvs_open_ns[handle & 3] = NULL;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    g_host_counters.nvs_commits++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *k, uint8_t v)   { return nvs_set(h, k, &v, sizeof(v)); }
+esp_err_t nvs_set_u16(nvs_handle_t h, const char *k, uint16_t v) { return nvs_set(h, k, &v, sizeof(v)); }
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *k, uint32_t v) { return nvs_set(h, k, &v, sizeof(v)); }
+esp_err_t nvs_set_i64(nvs_handle_t h, const char *k, int64_t v)  { return nvs_set(h, k, &v, sizeof(v)); }
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *k, const void *v, size_t n)
+{
+    return nvs_set(h, k, v, n);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *k, uint8_t *v)   { return nvs_get(h, k, v, sizeof(*v)); }
+esp_err_t nvs_get_u16(nvs_handle_t h, const char *k, uint16_t *v) { return nvs_get(h, k, v, sizeof(*v)); }
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *k, uint32_t *v) { return nvs_get(h, k, v, sizeof(*v)); }
+esp_err_t nvs_get_i64(nvs_handle_t h, const char *k, int64_t *v)  { return nvs_get(h, k, v, sizeof(*v)); }
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *k, void *v, size_t *n)
+{
+    host_nvs_entry_t *e = nvs_find(h, k, false);
+    if (!e || e->len > *n) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    memcpy(v, e->val, e->len);
+    *n = e->len;
+    return ESP_OK;
+}
+
+void host_backends_reset(void)
+{
+    memset(&g_host_counters, 0, sizeof(g_host_counters));
+    s_rand = HOST_RANDOM_SEED;
+    s_nvs_count = 0;
+    memset(s_relay_on, 0, sizeof(s_relay_on));
+}
+
+void host_power_cycle(void)
+{
+    memset(s_relay_on, 0, sizeof(s_relay_on));
+}
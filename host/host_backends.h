@@ -0,0 +1,47 @@
+#pragma once
+
+// Host-side backends for the logic core: virtual clock, relay/LED, CoAP TX, Network
+// Data and NVS are replaced by counters so a trace replay can report what the FSM did.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <openthread/ip6.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t relay_writes;
+    uint32_t relay_toggles;
+    uint32_t led_updates;
+    uint32_t tx_state_req;
+    uint32_t tx_state_rsp;
+    uint32_t tx_trigger;
+    uint32_t tx_off;
+    uint32_t tx_notify;       // Observe notifications (zone/<id>/state)
+    uint32_t tx_state_get;    // unicast GET zone/<id>/state to the known owner
+    uint32_t netdata_pub;
+    uint32_t netdata_del;
+    uint32_t nvs_commits;
+} host_counters_t;
+
+extern host_counters_t g_host_counters;
+extern int g_host_log_level;   // 0 = silent, 1 = E/W, 2 = +I, 3 = +D
+
+void host_clock_set(int64_t now_us);
+int64_t host_clock_now(void);
+
+void host_set_my_addr(const otIp6Address *addr);   // NULL = no ML-EID yet
+void host_set_thread_ready(bool ready);
+void host_set_auto_hold_ms(uint32_t hold_ms);
+
+bool host_relay_on(uint8_t ch);
+
+void host_backends_reset(void);   // counters + NVS contents
+void host_power_cycle(void);      // GPIO state after reset (NVS kept)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,323 @@
+// Coverage walk of the zone FSM spec (main/logic_fsm_spec.h).
+//
+// Every combination of mode layers (local / global / zone / node override) and
+// auto sub-state (idle, active, pending restore, cold boot) is set up from a fresh
+// boot, then every event variant is applied once. The coverage counters of
+// logic_fsm.c are then compared with the spec:
+//   - a transition listed in LOGIC_FSM_TRANSITIONS that was never taken  -> fail
+//   - a transition that was taken but is not listed in the spec           -> fail
+//   - a (state, event) pair with a handler that was never dispatched      -> fail
+// and a state x event table of dispatch counts is printed.
+//
+// Usage: logic_fsm_cover [-q]
+
+#include "logic_fsm.h"
+#include "host_backends.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !LOGIC_FSM_COVERAGE
+#error "logic_fsm_cover needs LOGIC_FSM_COVERAGE=1"
+#endif
+
+#define COVER_T0_US   (1000 * 1000)
+#define COVER_HOLD_MS 10000
+#define COVER_ZONE    1
+
+#define LAYER_UNSET   0xFF
+
+static logic_state_t s_st;
+
+static otIp6Address addr_n(uint16_t n)
+{
+    otIp6Address a;
+    memset(&a, 0, sizeof(a));
+    a.mFields.m8[0] = 0xfd;
+    a.mFields.m8[14] = (uint8_t)(n >> 8);
+    a.mFields.m8[15] = (uint8_t)n;
+    return a;
+}
+
+static void run(const logic_evt_t *e)
+{
+    int64_t now = host_clock_now();
+    fsm_actions_t actions = logic_fsm_step(&s_st, e, now);
+    logic_fsm_apply_actions(&s_st, &actions);
+}
+
+// как logic_task после событий: истёкшие таймеры, затем EVT_TICK
+static void run_timers_and_tick(void)
+{
+    int64_t now = host_clock_now();
+    logic_evt_t e;
+    while (logic_fsm_pop_timer(&s_st, now, &e)) {
+        run(&e);
+    }
+    logic_evt_t tick = {.type = EVT_TICK};
+    run(&tick);
+}
+
+static void post(logic_evt_type_t type, uint32_t epoch, uint16_t addr, uint32_t u32, bool b)
+{
+    logic_evt_t e = {.type = type, .zone = COVER_ZONE, .epoch = epoch, .u32 = u32, .b = b};
+    if (addr) {
+        e.addr = addr_n(addr);
+    }
+    run(&e);
+    run_timers_and_tick();
+}
+
+typedef enum {
+    SUB_IDLE,
+    SUB_ACTIVE,      // peer trigger (owner fd00::2, epoch 5)
+    SUB_OWN,         // own local trigger
+    SUB_PENDING,     // strict restore after a warm boot
+    SUB_COLD,        // cold boot
+    SUB_COUNT,
+} sub_state_t;
+
+typedef struct {
+    uint8_t local;   // MODE_*; LAYER_UNSET — только для overrides
+    uint8_t global;
+    uint8_t zone;
+    uint8_t node;
+    sub_state_t sub;
+} setup_t;
+
+static void setup(const setup_t *su)
+{
+    host_backends_reset();
+    host_clock_set(COVER_T0_US);
+    otIp6Address me = addr_n(1);
+    host_set_my_addr(&me);
+    host_set_thread_ready(true);
+    host_set_auto_hold_ms(COVER_HOLD_MS);
+
+    uint8_t zone_id = COVER_ZONE;
+    memset(&s_st, 0, sizeof(s_st));
+    logic_fsm_init_zones(&s_st, &zone_id, NULL, 1);
+    logic_fsm_nvs_load(&s_st, MODE_AUTO);
+    logic_fsm_boot(&s_st, su->sub == SUB_COLD, host_clock_now());
+
+    // сначала слои режима, потом подсостояние (оно действует только в AUTO)
+    if (su->local != MODE_AUTO) {
+        post(EVT_LOCAL_MODE_SET, 0, 0, su->local, false);
+    }
+    if (su->global != LAYER_UNSET) {
+        post(EVT_MODE_SET_GLOBAL, 0, 0, su->global, false);
+    }
+    if (su->zone != LAYER_UNSET) {
+        post(EVT_MODE_SET_ZONE, 0, 0, ((uint32_t)COVER_ZONE << 8) | su->zone, false);
+    }
+    if (su->node != LAYER_UNSET) {
+        post(EVT_MODE_SET_NODE, 0, 0, su->node, false);
+    }
+
+    switch (su->sub) {
+        case SUB_ACTIVE:
+            post(EVT_TRIGGER_RX, 5, 2, COVER_HOLD_MS, false);
+            break;
+        case SUB_OWN:
+            post(EVT_LOCAL_TRIGGER, 0, 0, 100, false);
+            break;
+        case SUB_PENDING:
+            post(EVT_ENTER_PENDING_RESTORE, 0, 0, 0, false);
+            break;
+        default:
+            break;
+    }
+}
+
+typedef struct {
+    logic_evt_type_t type;
+    uint32_t epoch;      // CUR_EPOCH = текущий epoch зоны
+    uint16_t addr;
+    uint32_t u32;
+    bool b;
+    int64_t advance_us;  // > 0: вместо события — сдвиг часов и истёкшие таймеры
+} variant_t;
+
+#define CUR_EPOCH UINT32_MAX
+
+static const variant_t k_variants[] = {
+    {EVT_STATE_RSP, 6, 2, 10000, true, 0},
+    {EVT_STATE_RSP, 6, 2, 0, false, 0},
+    {EVT_STATE_RSP, 5, 2, 5000, true, 0},
+    {EVT_STATE_RSP, 5, 2, 0, false, 0},
+    {EVT_TRIGGER_RX, 6, 3, 10000, false, 0},
+    {EVT_TRIGGER_RX, 6, 3, 0, false, 0},
+    {EVT_TRIGGER_RX, 5, 2, 3000, false, 0},
+    {EVT_OFF_RX, CUR_EPOCH, 0, 0, false, 0},
+    {EVT_OFF_RX, 99, 0, 0, false, 0},
+    {EVT_STATE_REQ_RX, 0, 4, 0, false, 0},
+    {EVT_NETDATA_STATE, 6, 2, 10000, true, 0},
+    {EVT_NETDATA_STATE, 6, 2, 0, false, 0},
+    {EVT_NETDATA_STATE, CUR_EPOCH, 2, 0, false, 0},
+    {EVT_MODE_SET_GLOBAL, 0, 0, MODE_OFF, false, 0},
+    {EVT_MODE_SET_GLOBAL, 0, 0, MODE_ON, false, 0},
+    {EVT_MODE_SET_GLOBAL, 0, 0, MODE_AUTO, false, 0},
+    {EVT_MODE_SET_ZONE, 0, 0, (COVER_ZONE << 8) | MODE_OFF, false, 0},
+    {EVT_MODE_SET_ZONE, 0, 0, (COVER_ZONE << 8) | MODE_ON, false, 0},
+    {EVT_MODE_SET_ZONE, 0, 0, (COVER_ZONE << 8) | MODE_AUTO, false, 0},
+    {EVT_MODE_SET_NODE, 0, 0, MODE_OFF, false, 0},
+    {EVT_MODE_SET_NODE, 0, 0, MODE_ON, false, 0},
+    {EVT_MODE_SET_NODE, 0, 0, MODE_AUTO, false, 0},
+    {EVT_MODE_CLR_GLOBAL, 0, 0, 0, false, 0},
+    {EVT_MODE_CLR_ZONE, 0, 0, COVER_ZONE, false, 0},
+    {EVT_MODE_CLR_NODE, 0, 0, 0, false, 0},
+    {EVT_LOCAL_MODE_SET, 0, 0, MODE_OFF, false, 0},
+    {EVT_LOCAL_MODE_SET, 0, 0, MODE_ON, false, 0},
+    {EVT_LOCAL_MODE_SET, 0, 0, MODE_AUTO, false, 0},
+    {EVT_LOCAL_TRIGGER, 0, 0, 100, false, 0},
+    {EVT_TICK, 0, 0, 0, false, 0},
+    {EVT_ENTER_PENDING_RESTORE, 0, 0, 0, false, 0},
+    {EVT_COLD_BOOT, 0, 0, 0, false, 0},
+    {EVT_THREAD_UP, 0, 0, 0, false, 0},
+    {EVT_THREAD_DOWN, 0, 0, 0, false, 0},
+    {EVT_TIMER, 0, 0, 0, false, 1300 * 1000},          // strict restore timeout
+    {EVT_TIMER, 0, 0, 0, false, 3100 * 1000},          // past the strict restore timeout
+    {EVT_TIMER, 0, 0, 0, false, (COVER_HOLD_MS + 100) * 1000},
+    {EVT_TIMER, 0, 0, 0, false, 200 * 1000 * 1000},    // cold boot timeout
+};
+
+static void apply_variant(const variant_t *v)
+{
+    if (v->advance_us > 0) {
+        host_clock_set(host_clock_now() + v->advance_us);
+        run_timers_and_tick();
+        return;
+    }
+    uint32_t epoch = (v->epoch == CUR_EPOCH) ? s_st.zones[0].zone.epoch : v->epoch;
+    post(v->type, epoch, v->addr, v->u32, v->b);
+}
+
+static const uint8_t k_layers[] = {LAYER_UNSET, MODE_OFF, MODE_ON, MODE_AUTO};
+#define LAYER_COUNT (sizeof(k_layers) / sizeof(k_layers[0]))
+
+static uint32_t walk(void)
+{
+    uint32_t runs = 0;
+    for (uint8_t local = MODE_OFF; local <= MODE_AUTO; local++) {
+        for (size_t g = 0; g < LAYER_COUNT; g++) {
+            for (size_t zn = 0; zn < LAYER_COUNT; zn++) {
+                for (size_t n = 0; n < LAYER_COUNT; n++) {
+                    for (int sub = 0; sub < SUB_COUNT; sub++) {
+                        setup_t su = {
+                            .local = local,
+                            .global = k_layers[g],
+                            .zone = k_layers[zn],
+                            .node = k_layers[n],
+                            .sub = (sub_state_t)sub,
+                        };
+                        for (size_t v = 0; v < sizeof(k_variants) / sizeof(k_variants[0]); v++) {
+                            setup(&su);
+                            apply_variant(&k_variants[v]);
+                            runs++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return runs;
+}
+
+static void print_mask(FILE *f, uint8_t mask)
+{
+    for (int s = 0; s < FSM_STATE_COUNT; s++) {
+        if (mask & FSM_S(s)) {
+            fprintf(f, " %s", logic_fsm_state_name((fsm_state_t)s));
+        }
+    }
+    fprintf(f, "\n");
+}
+
+static uint32_t check(bool quiet)
+{
+    uint32_t failures = 0;
+    uint32_t spec_transitions = 0;
+    uint32_t hit_transitions = 0;
+
+    if (!quiet) {
+        printf("%-22s", "event \\ state");
+        for (int s = 0; s < FSM_STATE_COUNT; s++) {
+            printf(" %14s", logic_fsm_state_name((fsm_state_t)s));
+        }
+        printf("\n");
+    }
+
+    for (int e = 0; e < EVT_COUNT; e++) {
+        if (!quiet) {
+            printf("%-22s", logic_fsm_event_name((logic_evt_type_t)e));
+        }
+        for (int s = 0; s < FSM_STATE_COUNT; s++) {
+            fsm_state_t from = (fsm_state_t)s;
+            logic_evt_type_t ev = (logic_evt_type_t)e;
+            bool handled = logic_fsm_spec_handled(from, ev);
+            uint32_t hits = logic_fsm_coverage_hits(from, ev);
+            uint8_t seen = (uint8_t)(logic_fsm_coverage_to(from, ev) & ~FSM_S(from));
+            uint8_t spec = (uint8_t)(logic_fsm_spec_to(from, ev) & ~FSM_S(from));
+
+            if (!quiet) {
+                if (handled) {
+                    printf(" %14" PRIu32, hits);
+                } else {
+                    printf(" %14s", "-");
+                }
+            }
+
+            for (int t = 0; t < FSM_STATE_COUNT; t++) {
+                if (spec & FSM_S(t)) {
+                    spec_transitions++;
+                    if (seen & FSM_S(t)) {
+                        hit_transitions++;
+                    }
+                }
+            }
+            if (!handled && spec) {
+                fprintf(stderr, "spec: %s x %s lists transitions but has no handler\n",
+                        logic_fsm_state_name(from), logic_fsm_event_name(ev));
+                failures++;
+            }
+            if (handled && hits == 0) {
+                fprintf(stderr, "not dispatched: %s x %s\n",
+                        logic_fsm_state_name(from), logic_fsm_event_name(ev));
+                failures++;
+            }
+            if (spec & ~seen) {
+                fprintf(stderr, "unreached: %s x %s ->", logic_fsm_state_name(from),
+                        logic_fsm_event_name(ev));
+                print_mask(stderr, (uint8_t)(spec & ~seen));
+                failures++;
+            }
+            if (seen & ~spec) {
+                fprintf(stderr, "not in spec: %s x %s ->", logic_fsm_state_name(from),
+                        logic_fsm_event_name(ev));
+                print_mask(stderr, (uint8_t)(seen & ~spec));
+                failures++;
+            }
+        }
+        if (!quiet) {
+            printf("\n");
+        }
+    }
+
+    printf("transitions: %" PRIu32 "/%" PRIu32 " reached, %" PRIu32 " problem(s)\n",
+           hit_transitions, spec_transitions, failures);
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    bool quiet = (argc > 1 && strcmp(argv[1], "-q") == 0);
+
+    g_host_log_level = 0;
+    logic_fsm_set_clock(host_clock_now);
+    logic_fsm_coverage_reset();
+
+    uint32_t runs = walk();
+    printf("runs: %" PRIu32 "\n", runs);
+    return check(quiet) ? 1 : 0;
+}
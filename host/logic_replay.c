@@ -0,0 +1,713 @@
+// Host replay driver for the logic FSM (main/logic_fsm.c).
+//
+// Reads an event trace, feeds it through the mailbox and logic_fsm_step()/
+// logic_fsm_apply_actions() on a virtual clock the same way logic_task does
+// (deadline wakeups, consecutive events with the same t_ms are posted as one burst
+// and drained together, then EVT_TICK), then prints throughput and the final state.
+//
+// Trace format (one item per line, '#' starts a comment):
+//   <t_ms> <EVENT> [z=N] [epoch=N] [addr=N] [u32=N] [b=0|1]   event at virtual time t_ms
+//          z = zone id (default: first zone of @zones), addr=N means fd00::N,
+//          aliases: rem_ms/hold_ms/mode/dist -> u32, active/force -> b
+//          every=MS until=T_MS repeats the event every MS up to virtual time T_MS
+//   @zones ID...             zones served by the node (default ZONE_ID), before events
+//   @boot cold|warm          reload state from (in-memory) NVS and run the boot sequence
+//   @me N|none               own mesh-local EID (fd00::N)
+//   @hold MS                 auto_hold_ms
+//   @thread 0|1              coap_if_thread_ready()
+//   @refresh PCT             trigger_refresh_pct (TRIGGER_REFRESH_PCT), kept across @boot
+//   @expect key=value ...    fsm, epoch, active, relay, pending, owner, tx_trigger,
+//                            tx_off, tx_state_req, tx_state_rsp, rsp_suppressed,
+//                            netdata_pub, netdata_del (Network Data publish/withdraw),
+//                            tx_notify, tx_state_get, tx (all CoAP TX above),
+//                            observable (Observe source),
+//                            nvs_commits, mb_merged, mb_dropped,
+//                            dedup_hits, trace (ring records; both since the last @boot),
+//                            first (first event drained in the last burst);
+//                            z=N switches the zone
+//                            for the following zone keys (default: first zone)
+//
+// Usage: logic_replay [-n iterations] [-v level] [-t records] trace...
+//   -t N  print the last N records of the event trace ring (logic_trace.h)
+
+#include "logic_fsm.h"
+#include "logic_mailbox.h"
+#include "logic_trace.h"
+#include "config.h"
+#include "host_backends.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPLAY_MAX_LINES   4096
+#define REPLAY_MAX_EXPECT  12
+#define REPLAY_T0_US       (1000 * 1000)   // 0 is "unset" for FSM deadlines
+
+typedef enum {
+    LINE_EVENT,
+    LINE_BOOT,
+    LINE_ZONES,
+    LINE_ME,
+    LINE_HOLD,
+    LINE_THREAD,
+    LINE_REFRESH,
+    LINE_EXPECT,
+} line_kind_t;
+
+typedef struct {
+    char key[16];
+    char val[24];
+} expect_kv_t;
+
+typedef struct {
+    line_kind_t kind;
+    int lineno;
+    int64_t t_us;
+    logic_evt_t evt;
+    uint32_t arg;          // boot: cold, me: N (0 = none), hold, thread, refresh, zones: count
+    uint32_t every_ms;     // событие: повтор с шагом every_ms до until_ms (0 = нет)
+    uint32_t until_ms;
+    uint8_t zones[LOGIC_MAX_ZONES];
+    uint8_t n_expect;
+    expect_kv_t expect[REPLAY_MAX_EXPECT];
+} trace_line_t;
+
+typedef struct {
+    trace_line_t *lines;
+    size_t count;
+} trace_t;
+
+typedef struct {
+    int64_t t_us;
+    uint8_t primary_zone;   // зона событий без z=
+} parse_ctx_t;
+
+typedef struct {
+    uint64_t events;
+    uint64_t ticks;
+    uint64_t timers;
+    uint32_t expect_ok;
+    uint32_t expect_fail;
+} replay_stats_t;
+
+static logic_state_t s_st;
+static logic_mailbox_t s_mb;
+static logic_trace_t s_trace;
+static uint32_t s_trace_dump;
+static logic_evt_type_t s_burst_first;
+static uint8_t s_zone_ids[LOGIC_MAX_ZONES] = {ZONE_ID};
+static uint8_t s_zone_count = 1;
+static uint8_t s_refresh_pct = TRIGGER_REFRESH_PCT;
+
+static otIp6Address addr_from_n(uint32_t n)
+{
+    otIp6Address a;
+    memset(&a, 0, sizeof(a));
+    a.mFields.m8[0] = 0xfd;
+    a.mFields.m8[14] = (uint8_t)(n >> 8);
+    a.mFields.m8[15] = (uint8_t)n;
+    return a;
+}
+
+static void addr_to_str(const otIp6Address *a, char *out, size_t n)
+{
+    otIp6Address probe = addr_from_n(((uint32_t)a->mFields.m8[14] << 8) | a->mFields.m8[15]);
+    if (memcmp(&probe, a, sizeof(probe)) == 0) {
+        snprintf(out, n, "fd00::%x", ((unsigned)a->mFields.m8[14] << 8) | a->mFields.m8[15]);
+        return;
+    }
+    size_t off = 0;
+    for (int i = 0; i < 8 && off < n; i++) {
+        off += (size_t)snprintf(out + off, n - off, i ? ":%x" : "%x",
+                                ((unsigned)a->mFields.m8[2 * i] << 8) | a->mFields.m8[2 * i + 1]);
+    }
+}
+
+static bool parse_event_name(const char *name, logic_evt_type_t *out)
+{
+    for (int t = 0; t < EVT_COUNT; t++) {
+        const char *n = logic_fsm_event_name((logic_evt_type_t)t);
+        if (strcmp(n, name) == 0) {
+            *out = (logic_evt_type_t)t;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_u32(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    errno = 0;
+    unsigned long v = strtoul(s, &end, 10);
+    if (end == s || *end != '\0' || errno != 0 || v > UINT32_MAX) {
+        return false;
+    }
+    *out = (uint32_t)v;
+    return true;
+}
+
+static bool parse_event_arg(trace_line_t *ln, char *tok)
+{
+    char *eq = strchr(tok, '=');
+    if (!eq) {
+        return false;
+    }
+    *eq = '\0';
+    const char *k = tok;
+    uint32_t v = 0;
+    if (!parse_u32(eq + 1, &v)) {
+        return false;
+    }
+
+    if (strcmp(k, "z") == 0) {
+        if (v > UINT8_MAX) {
+            return false;
+        }
+        ln->evt.zone = (uint8_t)v;
+    } else if (strcmp(k, "epoch") == 0) {
+        ln->evt.epoch = v;
+    } else if (strcmp(k, "addr") == 0) {
+        ln->evt.addr = addr_from_n(v);
+    } else if (strcmp(k, "u32") == 0 || strcmp(k, "rem_ms") == 0 || strcmp(k, "hold_ms") == 0 ||
+               strcmp(k, "dist") == 0) {
+        ln->evt.u32 = v;
+    } else if (strcmp(k, "mode") == 0) {
+        ln->evt.u32 = (ln->evt.u32 & ~0xFFu) | (v & 0xFF);
+    } else if (strcmp(k, "zone") == 0) {
+        // MODE_SET_ZONE: (zone << 8) | mode, MODE_CLR_ZONE: zone
+        ln->evt.u32 = (ln->evt.type == EVT_MODE_CLR_ZONE) ? v : ((v << 8) | (ln->evt.u32 & 0xFF));
+    } else if (strcmp(k, "b") == 0 || strcmp(k, "active") == 0 || strcmp(k, "force") == 0) {
+        ln->evt.b = (v != 0);
+    } else if (strcmp(k, "every") == 0) {
+        ln->every_ms = v;
+    } else if (strcmp(k, "until") == 0) {
+        ln->until_ms = v;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parse_line(char *s, int lineno, parse_ctx_t *ctx, trace_line_t *ln)
+{
+    memset(ln, 0, sizeof(*ln));
+    ln->lineno = lineno;
+
+    char *save = NULL;
+    char *tok = strtok_r(s, " \t\r\n", &save);
+
+    if (tok[0] == '@') {
+        ln->t_us = ctx->t_us;
+        char *arg = strtok_r(NULL, " \t\r\n", &save);
+        if (strcmp(tok, "@boot") == 0 && arg) {
+            ln->kind = LINE_BOOT;
+            ln->arg = (strcmp(arg, "cold") == 0);
+            return ln->arg || strcmp(arg, "warm") == 0;
+        }
+        if (strcmp(tok, "@zones") == 0 && arg) {
+            ln->kind = LINE_ZONES;
+            for (; arg; arg = strtok_r(NULL, " \t\r\n", &save)) {
+                uint32_t id = 0;
+                if (ln->arg >= LOGIC_MAX_ZONES || !parse_u32(arg, &id) || id > UINT8_MAX) {
+                    return false;
+                }
+                ln->zones[ln->arg++] = (uint8_t)id;
+            }
+            ctx->primary_zone = ln->zones[0];
+            return true;
+        }
+        if (strcmp(tok, "@me") == 0 && arg) {
+            ln->kind = LINE_ME;
+            return strcmp(arg, "none") == 0 || (parse_u32(arg, &ln->arg) && ln->arg != 0);
+        }
+        if (strcmp(tok, "@hold") == 0 && arg) {
+            ln->kind = LINE_HOLD;
+            return parse_u32(arg, &ln->arg);
+        }
+        if (strcmp(tok, "@thread") == 0 && arg) {
+            ln->kind = LINE_THREAD;
+            return parse_u32(arg, &ln->arg);
+        }
+        if (strcmp(tok, "@refresh") == 0 && arg) {
+            ln->kind = LINE_REFRESH;
+            return parse_u32(arg, &ln->arg) && ln->arg <= 100;
+        }
+        if (strcmp(tok, "@expect") == 0) {
+            ln->kind = LINE_EXPECT;
+            for (; arg; arg = strtok_r(NULL, " \t\r\n", &save)) {
+                char *eq = strchr(arg, '=');
+                if (!eq || ln->n_expect >= REPLAY_MAX_EXPECT) {
+                    return false;
+                }
+                *eq = '\0';
+                expect_kv_t *kv = &ln->expect[ln->n_expect++];
+                snprintf(kv->key, sizeof(kv->key), "%s", arg);
+                snprintf(kv->val, sizeof(kv->val), "%s", eq + 1);
+            }
+            return ln->n_expect > 0;
+        }
+        return false;
+    }
+
+    uint32_t t_ms = 0;
+    if (!parse_u32(tok, &t_ms)) {
+        return false;
+    }
+    int64_t t = REPLAY_T0_US + (int64_t)t_ms * 1000;
+    if (t < ctx->t_us) {
+        return false;   // время в трассе только растёт
+    }
+    ctx->t_us = t;
+    ln->t_us = t;
+    ln->kind = LINE_EVENT;
+    ln->evt.zone = ctx->primary_zone;
+
+    char *name = strtok_r(NULL, " \t\r\n", &save);
+    if (!name || !parse_event_name(name, &ln->evt.type)) {
+        return false;
+    }
+    for (tok = strtok_r(NULL, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (!parse_event_arg(ln, tok)) {
+            return false;
+        }
+    }
+    if (!ln->every_ms) {
+        return ln->until_ms == 0;
+    }
+    return ln->until_ms >= t_ms;
+}
+
+static bool load_trace(const char *path, trace_t *tr)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    tr->lines = calloc(REPLAY_MAX_LINES, sizeof(trace_line_t));
+    tr->count = 0;
+    if (!tr->lines) {
+        fclose(f);
+        return false;
+    }
+
+    char buf[256];
+    int lineno = 0;
+    parse_ctx_t ctx = {.t_us = REPLAY_T0_US, .primary_zone = ZONE_ID};
+    bool ok = true;
+    while (fgets(buf, sizeof(buf), f)) {
+        lineno++;
+        char *hash = strchr(buf, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        char *p = buf + strspn(buf, " \t\r\n");
+        if (*p == '\0') {
+            continue;
+        }
+        if (tr->count >= REPLAY_MAX_LINES) {
+            fprintf(stderr, "%s:%d: too many lines\n", path, lineno);
+            ok = false;
+            break;
+        }
+        if (!parse_line(p, lineno, &ctx, &tr->lines[tr->count])) {
+            fprintf(stderr, "%s:%d: parse error\n", path, lineno);
+            ok = false;
+            break;
+        }
+        // every=/until=: копии события по шагу, время трассы — по последней
+        trace_line_t *ln = &tr->lines[tr->count++];
+        if (ln->kind != LINE_EVENT || !ln->every_ms) {
+            continue;
+        }
+        int64_t until_us = REPLAY_T0_US + (int64_t)ln->until_ms * 1000;
+        for (int64_t t = ln->t_us + (int64_t)ln->every_ms * 1000; t <= until_us;
+             t += (int64_t)ln->every_ms * 1000) {
+            if (tr->count >= REPLAY_MAX_LINES) {
+                fprintf(stderr, "%s:%d: too many lines\n", path, lineno);
+                fclose(f);
+                return false;
+            }
+            tr->lines[tr->count] = *ln;
+            tr->lines[tr->count].t_us = t;
+            ctx.t_us = t;
+            tr->count++;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// ===== replay =====
+
+static void dispatch(const logic_evt_t *e, int64_t now, replay_stats_t *rs)
+{
+    fsm_actions_t actions = logic_fsm_step(&s_st, e, now);
+    logic_trace_step(&s_trace, &s_st, e, &actions, now);
+    logic_fsm_apply_actions(&s_st, &actions);
+    if (e->type == EVT_TICK) {
+        rs->ticks++;
+    } else if (e->type == EVT_TIMER) {
+        rs->timers++;
+    } else {
+        rs->events++;
+    }
+}
+
+// как шаги 3-4 logic_task: истёкшие таймеры, затем EVT_TICK
+static void run_tick(int64_t now, replay_stats_t *rs)
+{
+    logic_evt_t e;
+    while (logic_fsm_pop_timer(&s_st, now, &e)) {
+        dispatch(&e, now, rs);
+    }
+    logic_evt_t tick = {.type = EVT_TICK};
+    dispatch(&tick, now, rs);
+}
+
+// как logic_task: просыпаемся на каждом дедлайне до момента t_us
+static void advance_to(int64_t t_us, replay_stats_t *rs)
+{
+    for (int guard = 0; guard < 10000; guard++) {
+        int64_t d = logic_fsm_next_deadline_us(&s_st);
+        if (d == 0 || d >= t_us) {
+            break;
+        }
+        int64_t wake = d;
+        if (wake > t_us) {
+            wake = t_us;
+        }
+        if (wake < host_clock_now()) {
+            wake = host_clock_now();
+        }
+        host_clock_set(wake);
+        run_tick(wake, rs);
+    }
+    if (t_us > host_clock_now()) {
+        host_clock_set(t_us);
+    }
+}
+
+static void boot(bool cold)
+{
+    int64_t now = host_clock_now();
+    host_power_cycle();
+    memset(&s_st, 0, sizeof(s_st));
+    logic_fsm_init_zones(&s_st, s_zone_ids, NULL, s_zone_count);
+    logic_fsm_nvs_load(&s_st, MODE_AUTO);
+    logic_trace_init(&s_trace);   // кольцо в RAM перезагрузку не переживает
+    s_st.trigger_refresh_pct = s_refresh_pct;
+    logic_fsm_boot(&s_st, cold, now);
+}
+
+static uint32_t rem_ms_now(const logic_zone_t *z)
+{
+    int64_t now = host_clock_now();
+    if (!z->zone.active || z->zone.deadline_us <= now) {
+        return 0;
+    }
+    return (uint32_t)((z->zone.deadline_us - now) / 1000);
+}
+
+static bool check_expect(const trace_line_t *ln, const char *path, replay_stats_t *rs)
+{
+    bool all_ok = true;
+    const logic_zone_t *z = &s_st.zones[0];
+    for (uint8_t i = 0; i < ln->n_expect; i++) {
+        const expect_kv_t *kv = &ln->expect[i];
+        char actual[48];
+
+        if (strcmp(kv->key, "z") == 0) {
+            uint32_t id = 0;
+            z = (parse_u32(kv->val, &id) && id <= UINT8_MAX) ? logic_fsm_zone(&s_st, (uint8_t)id) : NULL;
+            if (!z) {
+                fprintf(stderr, "%s:%d: zone %s not served\n", path, ln->lineno, kv->val);
+                rs->expect_fail++;
+                return false;
+            }
+            continue;
+        } else if (strcmp(kv->key, "fsm") == 0) {
+            snprintf(actual, sizeof(actual), "%s", logic_fsm_state_name(z->fsm));
+        } else if (strcmp(kv->key, "epoch") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, z->zone.epoch);
+        } else if (strcmp(kv->key, "active") == 0) {
+            snprintf(actual, sizeof(actual), "%d", z->zone.active ? 1 : 0);
+        } else if (strcmp(kv->key, "relay") == 0) {
+            snprintf(actual, sizeof(actual), "%d", host_relay_on(z->relay_ch) ? 1 : 0);
+        } else if (strcmp(kv->key, "pending") == 0) {
+            snprintf(actual, sizeof(actual), "%d", z->zone.pending_restore ? 1 : 0);
+        } else if (strcmp(kv->key, "owner") == 0) {
+            if (!z->zone.owner_valid) {
+                snprintf(actual, sizeof(actual), "none");
+            } else {
+                snprintf(actual, sizeof(actual), "%u",
+                         ((unsigned)z->zone.owner_addr.mFields.m8[14] << 8) |
+                         z->zone.owner_addr.mFields.m8[15]);
+            }
+        } else if (strcmp(kv->key, "tx_trigger") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.tx_trigger);
+        } else if (strcmp(kv->key, "tx_off") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.tx_off);
+        } else if (strcmp(kv->key, "tx_state_req") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.tx_state_req);
+        } else if (strcmp(kv->key, "tx_state_rsp") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.tx_state_rsp);
+        } else if (strcmp(kv->key, "netdata_pub") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.netdata_pub);
+        } else if (strcmp(kv->key, "netdata_del") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.netdata_del);
+        } else if (strcmp(kv->key, "tx_notify") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.tx_notify);
+        } else if (strcmp(kv->key, "tx_state_get") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.tx_state_get);
+        } else if (strcmp(kv->key, "tx") == 0) {
+            const host_counters_t *c = &g_host_counters;
+            snprintf(actual, sizeof(actual), "%" PRIu32,
+                     c->tx_trigger + c->tx_off + c->tx_state_req + c->tx_state_rsp +
+                     c->tx_notify + c->tx_state_get);
+        } else if (strcmp(kv->key, "observable") == 0) {
+            snprintf(actual, sizeof(actual), "%d", z->obs_source ? 1 : 0);
+        } else if (strcmp(kv->key, "rsp_suppressed") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, s_st.rsp_stats.suppressed);
+        } else if (strcmp(kv->key, "mb_merged") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32,
+                     s_mb.stats[LOGIC_MB_LANE_HIGH].merged + s_mb.stats[LOGIC_MB_LANE_NORMAL].merged);
+        } else if (strcmp(kv->key, "mb_dropped") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32,
+                     s_mb.stats[LOGIC_MB_LANE_HIGH].dropped + s_mb.stats[LOGIC_MB_LANE_NORMAL].dropped);
+        } else if (strcmp(kv->key, "dedup_hits") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, s_st.dedup.stats.hits);
+        } else if (strcmp(kv->key, "trace") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, logic_trace_head(&s_trace));
+        } else if (strcmp(kv->key, "first") == 0) {
+            snprintf(actual, sizeof(actual), "%s", logic_fsm_event_name(s_burst_first));
+        } else if (strcmp(kv->key, "nvs_commits") == 0) {
+            snprintf(actual, sizeof(actual), "%" PRIu32, g_host_counters.nvs_commits);
+        } else {
+            snprintf(actual, sizeof(actual), "<unknown key>");
+        }
+
+        if (strcmp(actual, kv->val) != 0) {
+            fprintf(stderr, "%s:%d: expect %s=%s, got %s\n",
+                    path, ln->lineno, kv->key, kv->val, actual);
+            all_ok = false;
+        }
+    }
+    if (all_ok) {
+        rs->expect_ok++;
+    } else {
+        rs->expect_fail++;
+    }
+    return all_ok;
+}
+
+static void replay_once(const trace_t *tr, const char *path, bool check, replay_stats_t *rs)
+{
+    otIp6Address me = addr_from_n(1);
+
+    host_backends_reset();
+    logic_mb_init(&s_mb);
+    host_clock_set(REPLAY_T0_US);
+    host_set_my_addr(&me);
+    host_set_thread_ready(true);
+    host_set_auto_hold_ms(AUTO_HOLD_MS);
+    s_zone_ids[0] = ZONE_ID;
+    s_zone_count = 1;
+    s_refresh_pct = TRIGGER_REFRESH_PCT;
+
+    bool booted = false;
+    for (size_t i = 0; i < tr->count; i++) {
+        const trace_line_t *ln = &tr->lines[i];
+        if (!booted && (ln->kind == LINE_EVENT || ln->kind == LINE_EXPECT)) {
+            boot(false);
+            booted = true;
+        }
+
+        switch (ln->kind) {
+            case LINE_EVENT: {
+                advance_to(ln->t_us, rs);
+                logic_mb_post(&s_mb, &ln->evt, ln->t_us);
+                const trace_line_t *next = (i + 1 < tr->count) ? &tr->lines[i + 1] : NULL;
+                if (next && next->kind == LINE_EVENT && next->t_us == ln->t_us) {
+                    break;   // тот же момент — копим пачку
+                }
+                logic_evt_t e;
+                bool first = true;
+                while (logic_mb_pop(&s_mb, &e, ln->t_us)) {
+                    if (first) {
+                        s_burst_first = e.type;
+                        first = false;
+                    }
+                    dispatch(&e, ln->t_us, rs);
+                }
+                run_tick(ln->t_us, rs);
+            } break;
+            case LINE_BOOT:
+                advance_to(ln->t_us, rs);
+                boot(ln->arg != 0);
+                booted = true;
+                break;
+            case LINE_ZONES:
+                memcpy(s_zone_ids, ln->zones, ln->arg);
+                s_zone_count = (uint8_t)ln->arg;
+                break;
+            case LINE_ME:
+                if (ln->arg) {
+                    me = addr_from_n(ln->arg);
+                    host_set_my_addr(&me);
+                } else {
+                    host_set_my_addr(NULL);
+                }
+                break;
+            case LINE_HOLD:
+                host_set_auto_hold_ms(ln->arg);
+                break;
+            case LINE_THREAD:
+                host_set_thread_ready(ln->arg != 0);
+                break;
+            case LINE_REFRESH:
+                s_refresh_pct = (uint8_t)ln->arg;
+                s_st.trigger_refresh_pct = s_refresh_pct;
+                break;
+            case LINE_EXPECT:
+                if (check) {
+                    check_expect(ln, path, rs);
+                }
+                break;
+        }
+    }
+}
+
+static double elapsed_s(const struct timespec *a, const struct timespec *b)
+{
+    return (double)(b->tv_sec - a->tv_sec) + (double)(b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static int run_trace(const char *path, uint32_t iterations)
+{
+    trace_t tr = {0};
+    if (!load_trace(path, &tr)) {
+        free(tr.lines);
+        return 2;
+    }
+
+    replay_stats_t rs = {0};
+    replay_once(&tr, path, true, &rs);
+    replay_stats_t check = rs;
+
+    struct timespec t0, t1;
+    replay_stats_t bench = {0};
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t it = 0; it < iterations; it++) {
+        replay_once(&tr, path, false, &bench);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double sec = elapsed_s(&t0, &t1);
+    uint64_t dispatched = bench.events + bench.ticks + bench.timers;
+
+    printf("trace: %s\n", path);
+    printf("  iterations=%" PRIu32 " events=%" PRIu64 " ticks=%" PRIu64 " timers=%" PRIu64 "\n",
+           iterations, bench.events, bench.ticks, bench.timers);
+    if (sec > 0 && dispatched > 0) {
+        printf("  elapsed=%.3f ms  %.2f Mevents/s  %.1f ns/event\n",
+               sec * 1e3, (double)dispatched / sec / 1e6, sec * 1e9 / (double)dispatched);
+    }
+    for (uint8_t i = 0; i < s_st.zone_count; i++) {
+        const logic_zone_t *z = &s_st.zones[i];
+        char owner[OT_IP6_ADDRESS_STRING_SIZE] = "none";
+        if (z->zone.owner_valid) {
+            addr_to_str(&z->zone.owner_addr, owner, sizeof(owner));
+        }
+        printf("  final zone %u: fsm=%s epoch=%" PRIu32 " active=%d rem_ms=%" PRIu32
+               " pending=%d relay=%d owner=%s\n",
+               (unsigned)z->zone_id, logic_fsm_state_name(z->fsm), z->zone.epoch,
+               z->zone.active ? 1 : 0, rem_ms_now(z), z->zone.pending_restore ? 1 : 0,
+               host_relay_on(z->relay_ch) ? 1 : 0, owner);
+    }
+    for (int lane = 0; lane < LOGIC_MB_LANE_COUNT; lane++) {
+        const logic_mb_lane_stats_t *ls = &s_mb.stats[lane];
+        printf("  mailbox %s: posted=%" PRIu32 " merged=%" PRIu32 " dropped=%" PRIu32
+               " depth_max=%u\n",
+               logic_mb_lane_name((logic_mb_lane_t)lane), ls->posted, ls->merged, ls->dropped,
+               (unsigned)ls->depth_max);
+    }
+    {
+        const logic_dedup_stats_t *ds = &s_st.dedup.stats;
+        printf("  dedup: lookups=%" PRIu32 " hits=%" PRIu32 " (%.1f%%) inserts=%" PRIu32
+               " evictions=%" PRIu32 "\n",
+               ds->lookups, ds->hits, ds->lookups ? 100.0 * ds->hits / ds->lookups : 0.0,
+               ds->inserts, ds->evictions);
+    }
+    printf("  tx: state_req=%" PRIu32 " trigger=%" PRIu32 " off=%" PRIu32
+           "  nvs_commits=%" PRIu32 " relay_toggles=%" PRIu32 "\n",
+           g_host_counters.tx_state_req, g_host_counters.tx_trigger, g_host_counters.tx_off,
+           g_host_counters.nvs_commits, g_host_counters.relay_toggles);
+    if (s_trace_dump) {
+        uint32_t head = logic_trace_head(&s_trace);
+        uint32_t n = s_trace_dump;
+        if (n > head) n = head;
+        if (n > LOGIC_TRACE_LEN) n = LOGIC_TRACE_LEN;
+        printf("  trace: last %" PRIu32 " of %" PRIu32 " records\n", n, head);
+        for (uint32_t seq = head - n; seq != head; seq++) {
+            logic_trace_rec_t r;
+            char line[128];
+            if (logic_trace_get(&s_trace, seq, &r)) {
+                logic_trace_format(&r, line, sizeof(line));
+                printf("    %s\n", line);
+            }
+        }
+    }
+    printf("  expect: %" PRIu32 " ok, %" PRIu32 " failed\n", check.expect_ok, check.expect_fail);
+
+    free(tr.lines);
+    return check.expect_fail ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 1;
+    int first = 1;
+
+    while (first < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-n") == 0 && first + 1 < argc) {
+            if (!parse_u32(argv[first + 1], &iterations) || iterations == 0) {
+                fprintf(stderr, "bad -n\n");
+                return 2;
+            }
+            first += 2;
+        } else if (strcmp(argv[first], "-t") == 0 && first + 1 < argc) {
+            if (!parse_u32(argv[first + 1], &s_trace_dump)) {
+                fprintf(stderr, "bad -t\n");
+                return 2;
+            }
+            first += 2;
+        } else if (strcmp(argv[first], "-v") == 0 && first + 1 < argc) {
+            g_host_log_level = atoi(argv[first + 1]);
+            first += 2;
+        } else {
+            break;
+        }
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [-n iterations] [-v level] [-t records] trace...\n", argv[0]);
+        return 2;
+    }
+
+    logic_fsm_set_clock(host_clock_now);
+
+    int rc = 0;
+    for (int i = first; i < argc; i++) {
+        int r = run_trace(argv[i], iterations);
+        if (r > rc) {
+            rc = r;
+        }
+    }
+    return rc;
+}
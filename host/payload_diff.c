@@ -0,0 +1,586 @@
+// Differential fuzz of the text payload parsers on the same inputs:
+//   rust   — rust_parse_payload (components/rust_payload, staticlib built for the host),
+//            and its streaming form rust_kv_* that coap_if.c uses on RX (random chunks)
+//   kv     — coap_kv (host/coap_kv.h), the C reference of the same rules, random chunks
+//   legacy — parse_u32_kv/parse_bool_kv/parse_ip_kv, the strstr/strtoul fallback older
+//            firmware still runs when its Rust parser rejects a payload (copied below)
+//
+// rust, rust_kv and kv must agree on every input (accept/reject, every field, owner); a
+// mismatch fails the run. legacy is compared with rust the way a receiver acts on the payload
+// (trigger, off, state_rsp: accepted?, epoch, rem_ms, active, owner) and only reported:
+// those are the inputs a mixed-firmware network interprets differently.
+// Throughput (ns/payload) is measured for all three on the same inputs.
+//
+// Inputs: corpus lines (-c dir with *.txt, one payload per line, '#' = comment, e.g.
+// payload_parser/benches/corpus), byte mutations of them and payloads generated from
+// the keys, values and separators of the format.
+//
+// Usage: payload_diff [-q] [-v] [-n N] [-s seed] [-c corpus_dir]
+//        exit code 1 on a rust/kv or whole/chunked divergence
+
+#include "coap_kv.h"
+#include "rust_payload.h"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_IN      200          // байт на вход (state_rsp старых прошивок — до 159)
+#define MAX_SEEDS   256
+#define BATCH       1024
+#define EXAMPLES    3            // примеров на вид расхождения
+
+// ---- legacy: как в прошивках до потокового разбора (otIp6AddressFromString -> inet_pton) ----
+
+static bool parse_ip_kv(const char *s, const char *key, uint8_t out[16])
+{
+    const char *p = strstr(s, key);
+    if (!p) return false;
+    p += strlen(key);
+    if (*p != '=') return false;
+    p++;
+
+    // копируем до ';' или конца
+    char buf[64];
+    size_t i = 0;
+    while (*p && *p != ';' && i + 1 < sizeof(buf)) {
+        buf[i++] = *p++;
+    }
+    buf[i] = 0;
+    if (i == 0) return false;
+
+    return inet_pton(AF_INET6, buf, out) == 1;
+}
+
+static bool parse_u32_kv(const char *s, const char *key, uint32_t *out)
+{
+    const char *p = strstr(s, key);
+    if (!p) {
+        return false;
+    }
+    p += strlen(key);
+    if (*p != '=') {
+        return false;
+    }
+    p++;
+
+    char *end = NULL;
+    unsigned long v = strtoul(p, &end, 10);
+    if (end == p) {
+        return false;
+    }
+    *out = (uint32_t)v;
+    return true;
+}
+
+static bool parse_bool_kv(const char *s, const char *key, bool *out)
+{
+    uint32_t v = 0;
+    if (!parse_u32_kv(s, key, &v)) {
+        return false;
+    }
+    *out = (v != 0);
+    return true;
+}
+
+// ---- то, на что действует приёмник ----
+
+enum { K_TRIGGER, K_OFF, K_STATE_RSP, K_COUNT };
+static const char *const k_kind_names[K_COUNT] = {"trigger", "off", "state_rsp"};
+static const size_t k_legacy_buf[K_COUNT] = {96, 64, 160};   // буферы read_payload
+
+#define REM_DEFAULT UINT32_MAX   // trigger без rem_ms: auto_hold_ms узла
+
+typedef struct {
+    bool ok;
+    uint32_t epoch;
+    uint32_t rem_ms;
+    bool active;
+    uint8_t owner[16];
+} action_t;
+
+static action_t act_current(int kind, bool ok, const rust_parsed_t *p)
+{
+    action_t a = {0};
+    switch (kind) {
+        case K_TRIGGER:
+            a.ok = ok && p->has_epoch;
+            a.rem_ms = p->has_rem_ms ? p->rem_ms : REM_DEFAULT;
+            break;
+        case K_OFF:
+            a.ok = ok && p->has_epoch;
+            break;
+        default:
+            a.ok = ok && p->has_epoch && p->has_active;
+            a.rem_ms = p->has_rem_ms ? p->rem_ms : 0;
+            a.active = p->active != 0;
+            if (p->has_owner) {
+                memcpy(a.owner, p->owner, 16);
+            }
+            break;
+    }
+    a.epoch = a.ok ? p->epoch : 0;
+    if (!a.ok) {
+        memset(&a, 0, sizeof(a));
+    }
+    return a;
+}
+
+static action_t act_legacy(int kind, const uint8_t *in, size_t len)
+{
+    char buf[160];
+    size_t n = len < k_legacy_buf[kind] - 1 ? len : k_legacy_buf[kind] - 1;
+    memcpy(buf, in, n);
+    buf[n] = 0;
+
+    action_t a = {0};
+    switch (kind) {
+        case K_TRIGGER:
+            a.ok = parse_u32_kv(buf, "epoch", &a.epoch) || parse_u32_kv(buf, "e", &a.epoch);
+            if (!parse_u32_kv(buf, "rem_ms", &a.rem_ms) && !parse_u32_kv(buf, "h", &a.rem_ms)) {
+                a.rem_ms = REM_DEFAULT;
+            }
+            break;
+        case K_OFF:
+            a.ok = parse_u32_kv(buf, "e", &a.epoch);
+            break;
+        default:
+            a.ok = parse_u32_kv(buf, "e", &a.epoch) && parse_bool_kv(buf, "a", &a.active);
+            if (!parse_u32_kv(buf, "r", &a.rem_ms)) {
+                a.rem_ms = 0;
+            }
+            if (!parse_ip_kv(buf, "o", a.owner)) {
+                memset(a.owner, 0, sizeof(a.owner));
+            }
+            break;
+    }
+    if (!a.ok) {
+        memset(&a, 0, sizeof(a));
+    }
+    return a;
+}
+
+// ---- входы ----
+
+typedef struct {
+    uint8_t b[MAX_IN];
+    uint16_t len;
+} input_t;
+
+static uint64_t s_rng;
+
+static uint32_t rnd(uint32_t n)
+{
+    // xorshift64*
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    return (uint32_t)((s_rng * 0x2545F4914F6CDD1DULL) >> 32) % n;
+}
+
+static input_t s_seeds[MAX_SEEDS];
+static int s_seed_count;
+
+static void add_seed(const char *s, size_t len)
+{
+    if (s_seed_count < MAX_SEEDS && len < MAX_IN) {
+        memcpy(s_seeds[s_seed_count].b, s, len);
+        s_seeds[s_seed_count].len = (uint16_t)len;
+        s_seed_count++;
+    }
+}
+
+static void load_corpus(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "corpus: cannot open %s\n", dir);
+        return;
+    }
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        size_t nl = strlen(e->d_name);
+        if (nl < 5 || strcmp(&e->d_name[nl - 4], ".txt") != 0) {
+            continue;
+        }
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            continue;
+        }
+        char line[256];
+        while (fgets(line, sizeof(line), f)) {
+            size_t len = strcspn(line, "\n");
+            if (len > 0 && line[0] != '#') {
+                add_seed(line, len);
+            }
+        }
+        fclose(f);
+    }
+    closedir(d);
+}
+
+static const char *const k_gen_keys[] = {
+    "epoch", "e", "rem_ms", "h", "r", "active", "a", "mode", "m", "clr", "z", "o",
+    "E", "ee", "re", "epochs", "xe", "ra", "oo", "e p", "", " e", "r ",
+};
+static const char *const k_gen_nums[] = {
+    "0", "1", "2", "255", "256", "4294967295", "4294967296", "99999999999", "007",
+    "12x", "-1", "+1", " 5 ", "1 2", "", "0x10", "1e3", "300000",
+};
+static const char *const k_gen_ips[] = {
+    "::", "::1", "fe80::", "fd11:2233:4455:0:1a2b:3c4d:5e6f:7081", "FD00:0:0:1::ABCD",
+    "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7", "1:2:3:4:5:6:7:8:9", "1::2::3", ":1::", "1:::2",
+    "1::2:", "12345::", "fe80::1%wpan0", "::ffff:1.2.3.4", "fe80:: 1", "0:0:0:0:0:0:0:0",
+};
+static const char *const k_gen_seps[] = {";", "&", ";;", " ; ", "", "=", ";\t"};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static void put(input_t *in, const char *s)
+{
+    size_t n = strlen(s);
+    if (in->len + n > MAX_IN) {
+        n = MAX_IN - in->len;
+    }
+    memcpy(&in->b[in->len], s, n);
+    in->len = (uint16_t)(in->len + n);
+}
+
+static void gen_ip(input_t *in)
+{
+    if (rnd(2)) {
+        put(in, k_gen_ips[rnd(COUNT(k_gen_ips))]);
+        return;
+    }
+    static const char k_hex[] = "0123456789abcdefABCDEF";
+    int groups = 1 + (int)rnd(9);
+    int dc = rnd(3) ? (int)rnd((uint32_t)groups + 1) : -1;
+    for (int g = 0; g < groups; g++) {
+        if (g == dc) {
+            put(in, "::");
+        } else if (g > 0) {
+            put(in, ":");
+        }
+        int digits = (int)rnd(6);
+        for (int i = 0; i < digits; i++) {
+            char c[2] = {k_hex[rnd(sizeof(k_hex) - 1)], 0};
+            put(in, c);
+        }
+    }
+}
+
+static void gen_payload(input_t *in)
+{
+    in->len = 0;
+    int tokens = (int)rnd(9);
+    for (int t = 0; t < tokens; t++) {
+        if (t > 0) {
+            put(in, k_gen_seps[rnd(COUNT(k_gen_seps))]);
+        }
+        const char *key = k_gen_keys[rnd(COUNT(k_gen_keys))];
+        put(in, key);
+        if (rnd(10) == 0) {
+            continue;                     // токен без '='
+        }
+        put(in, rnd(6) ? "=" : " = ");
+        if (strcmp(key, "o") == 0 || rnd(12) == 0) {
+            gen_ip(in);
+        } else if (rnd(3) == 0) {
+            char num[16];
+            snprintf(num, sizeof(num), "%u", rnd(UINT32_MAX));
+            put(in, num);
+        } else {
+            put(in, k_gen_nums[rnd(COUNT(k_gen_nums))]);
+        }
+    }
+}
+
+static void mutate(input_t *in)
+{
+    static const char k_alpha[] = ";&= :0123456789abcdefox\t";
+    int ops = 1 + (int)rnd(4);
+    for (int i = 0; i < ops; i++) {
+        uint16_t at = in->len ? (uint16_t)rnd(in->len + 1u) : 0;
+        switch (rnd(5)) {
+            case 0:                       // замена байта (в т.ч. не-ASCII и '\0')
+                if (at < in->len) {
+                    in->b[at] = rnd(4) ? (uint8_t)k_alpha[rnd(sizeof(k_alpha) - 1)]
+                                       : (uint8_t)rnd(256);
+                }
+                break;
+            case 1:                       // вставка
+                if (in->len < MAX_IN) {
+                    memmove(&in->b[at + 1], &in->b[at], in->len - at);
+                    in->b[at] = (uint8_t)k_alpha[rnd(sizeof(k_alpha) - 1)];
+                    in->len++;
+                }
+                break;
+            case 2: {                     // удаление куска
+                uint16_t n = (uint16_t)rnd(8);
+                if (at + n > in->len) {
+                    n = (uint16_t)(in->len - at);
+                }
+                memmove(&in->b[at], &in->b[at + n], in->len - at - n);
+                in->len = (uint16_t)(in->len - n);
+                break;
+            }
+            case 3: {                     // повтор куска
+                uint16_t n = (uint16_t)rnd(16);
+                if (at + n > in->len) {
+                    n = (uint16_t)(in->len - at);
+                }
+                if (in->len + n <= MAX_IN) {
+                    memmove(&in->b[at + n], &in->b[at], in->len - at);
+                    in->len = (uint16_t)(in->len + n);
+                }
+                break;
+            }
+            default:                      // обрезка
+                in->len = at;
+                break;
+        }
+    }
+}
+
+static void next_input(input_t *in)
+{
+    uint32_t r = rnd(10);
+    if (s_seed_count > 0 && r < 2) {
+        *in = s_seeds[rnd((uint32_t)s_seed_count)];
+    } else if (s_seed_count > 0 && r < 6) {
+        *in = s_seeds[rnd((uint32_t)s_seed_count)];
+        mutate(in);
+    } else {
+        gen_payload(in);
+        if (r == 9) {
+            mutate(in);
+        }
+    }
+}
+
+// ---- сравнение ----
+
+typedef struct {
+    bool ok;
+    rust_parsed_t p;
+} result_t;
+
+static bool same_parsed(const result_t *a, const result_t *b)
+{
+    if (a->ok != b->ok) {
+        return false;
+    }
+    if (!a->ok) {
+        return true;
+    }
+    const rust_parsed_t *x = &a->p, *y = &b->p;
+#define FIELD(h, v) \
+    if (x->h != y->h || (x->h && x->v != y->v)) return false;
+    FIELD(has_epoch, epoch)
+    FIELD(has_rem_ms, rem_ms)
+    FIELD(has_active, active)
+    FIELD(has_mode, mode)
+    FIELD(has_clr, clr)
+    FIELD(has_z, z)
+    FIELD(has_m, m)
+#undef FIELD
+    return x->has_owner == y->has_owner &&
+           (!x->has_owner || memcmp(x->owner, y->owner, 16) == 0);
+}
+
+static bool same_action(const action_t *a, const action_t *b)
+{
+    return a->ok == b->ok && a->epoch == b->epoch && a->rem_ms == b->rem_ms &&
+           a->active == b->active && memcmp(a->owner, b->owner, 16) == 0;
+}
+
+static void print_input(const char *tag, const input_t *in)
+{
+    fprintf(stderr, "%s '", tag);
+    for (uint16_t i = 0; i < in->len; i++) {
+        uint8_t c = in->b[i];
+        if (c >= 0x20 && c < 0x7f && c != '\'' && c != '\\') {
+            fputc(c, stderr);
+        } else {
+            fprintf(stderr, "\\x%02x", c);
+        }
+    }
+    fprintf(stderr, "'\n");
+}
+
+static void print_action(const char *tag, const action_t *a)
+{
+    char ip[INET6_ADDRSTRLEN];
+    inet_ntop(AF_INET6, a->owner, ip, sizeof(ip));
+    char rem[16];
+    if (a->rem_ms == REM_DEFAULT) {
+        snprintf(rem, sizeof(rem), "default");
+    } else {
+        snprintf(rem, sizeof(rem), "%u", a->rem_ms);
+    }
+    fprintf(stderr, "    %-7s ok=%d epoch=%u rem_ms=%s active=%d owner=%s\n", tag, a->ok,
+            a->epoch, rem, a->active, ip);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void kv_parse(const input_t *in, bool chunked, result_t *out)
+{
+    coap_kv_t kv;
+    coap_kv_init(&kv);
+    uint16_t off = 0;
+    while (off < in->len) {
+        uint16_t n = (uint16_t)(in->len - off);
+        if (chunked) {
+            n = (uint16_t)(1 + rnd(n));
+        }
+        coap_kv_feed(&kv, &in->b[off], n);
+        off = (uint16_t)(off + n);
+    }
+    out->ok = coap_kv_finish(&kv);
+    out->p = kv.out;
+}
+
+static void rust_kv_parse(const input_t *in, result_t *out)
+{
+    rust_kv_t kv;
+    rust_kv_init(&kv);
+    uint16_t off = 0;
+    while (off < in->len) {
+        uint16_t n = (uint16_t)(1 + rnd((uint32_t)(in->len - off)));
+        rust_kv_feed(&kv, &in->b[off], n);
+        off = (uint16_t)(off + n);
+    }
+    memset(&out->p, 0, sizeof(out->p));
+    out->ok = rust_kv_finish(&kv, &out->p) != 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool quiet = false, verbose = false;
+    long total = 100000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            total = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            load_corpus(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-q] [-v] [-n N] [-s seed] [-c corpus_dir]\n", argv[0]);
+            return 2;
+        }
+    }
+    s_rng = seed ? seed * 0x9E3779B97F4A7C15ULL : 1;
+
+    static input_t batch[BATCH];
+    static result_t r_rust[BATCH], r_kv[BATCH];
+    static action_t r_legacy[BATCH][K_COUNT];
+    double t_rust = 0, t_kv = 0, t_legacy = 0;
+    long done = 0, bytes = 0, accepted = 0;
+    long fail = 0, chunk_fail = 0;
+    long legacy_div[K_COUNT] = {0}, legacy_only[K_COUNT] = {0}, current_only[K_COUNT] = {0};
+
+    while (done < total) {
+        int n = (total - done) < BATCH ? (int)(total - done) : BATCH;
+        for (int i = 0; i < n; i++) {
+            next_input(&batch[i]);
+            bytes += batch[i].len;
+        }
+
+        double t0 = now_ns();
+        for (int i = 0; i < n; i++) {
+            memset(&r_rust[i].p, 0, sizeof(r_rust[i].p));
+            r_rust[i].ok = rust_parse_payload(batch[i].b, batch[i].len, &r_rust[i].p) != 0;
+        }
+        double t1 = now_ns();
+        for (int i = 0; i < n; i++) {
+            kv_parse(&batch[i], false, &r_kv[i]);
+        }
+        double t2 = now_ns();
+        for (int i = 0; i < n; i++) {
+            for (int k = 0; k < K_COUNT; k++) {
+                r_legacy[i][k] = act_legacy(k, batch[i].b, batch[i].len);
+            }
+        }
+        double t3 = now_ns();
+        t_rust += t1 - t0;
+        t_kv += t2 - t1;
+        t_legacy += (t3 - t2) / K_COUNT;
+
+        for (int i = 0; i < n; i++) {
+            accepted += r_rust[i].ok;
+            if (!same_parsed(&r_rust[i], &r_kv[i])) {
+                if (fail++ < EXAMPLES * 4) {
+                    print_input("DIVERGE rust/kv:", &batch[i]);
+                    fprintf(stderr, "    rust ok=%d kv ok=%d\n", r_rust[i].ok, r_kv[i].ok);
+                }
+            }
+            result_t chunked;
+            kv_parse(&batch[i], true, &chunked);
+            if (!same_parsed(&r_kv[i], &chunked)) {
+                if (chunk_fail++ < EXAMPLES) {
+                    print_input("DIVERGE kv whole/chunked:", &batch[i]);
+                }
+            }
+            rust_kv_parse(&batch[i], &chunked);
+            if (!same_parsed(&r_rust[i], &chunked)) {
+                if (chunk_fail++ < EXAMPLES) {
+                    print_input("DIVERGE rust whole/rust_kv chunked:", &batch[i]);
+                }
+            }
+            for (int k = 0; k < K_COUNT; k++) {
+                action_t cur = act_current(k, r_rust[i].ok, &r_rust[i].p);
+                const action_t *old = &r_legacy[i][k];
+                if (same_action(&cur, old)) {
+                    continue;
+                }
+                legacy_div[k]++;
+                legacy_only[k] += old->ok && !cur.ok;
+                current_only[k] += cur.ok && !old->ok;
+                if (verbose && legacy_div[k] <= EXAMPLES) {
+                    char tag[40];
+                    snprintf(tag, sizeof(tag), "legacy/current %s:", k_kind_names[k]);
+                    print_input(tag, &batch[i]);
+                    print_action("legacy", old);
+                    print_action("current", &cur);
+                }
+            }
+        }
+        done += n;
+    }
+
+    if (!quiet || fail || chunk_fail) {
+        printf("%ld input(s), %ld byte(s), %d seed(s), seed=%llu; rust accepted %ld\n", done,
+               bytes, s_seed_count, (unsigned long long)seed, accepted);
+        printf("rust/kv divergences: %ld, whole/chunked (kv, rust_kv): %ld\n", fail, chunk_fail);
+    }
+    if (!quiet) {
+        for (int k = 0; k < K_COUNT; k++) {
+            printf("legacy vs current %-9s: %6ld differ (%ld accepted only by legacy, "
+                   "%ld only by current)\n",
+                   k_kind_names[k], legacy_div[k], legacy_only[k], current_only[k]);
+        }
+        double avg = done ? (double)bytes / (double)done : 0;
+        printf("ns/payload (avg %.1f B): rust %.1f  kv %.1f  legacy %.1f\n", avg,
+               t_rust / (double)done, t_kv / (double)done, t_legacy / (double)done);
+    }
+    return (fail || chunk_fail) ? 1 : 0;
+}
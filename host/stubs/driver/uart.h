@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stub: config.h only needs the port constant.
+
+#define UART_NUM_1 1
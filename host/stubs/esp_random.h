@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stub: deterministic generator, restarted by host_backends_reset() so a
+// trace replays the same backoffs every run.
+
+#include <stdint.h>
+
+uint32_t esp_random(void);
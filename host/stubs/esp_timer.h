@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stub: returns the virtual clock driven by the replay tool.
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,21 @@
+#pragma once
+
+// Host stub: subset of OpenThread types used by the logic core.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct otInstance otInstance;
+
+typedef enum {
+    OT_ERROR_NONE = 0,
+    OT_ERROR_FAILED = 1,
+    OT_ERROR_PARSE = 6,
+    OT_ERROR_INVALID_ARGS = 7,
+} otError;
+
+typedef uint32_t otChangedFlags;
+
+#define OT_CHANGED_THREAD_ROLE    (1U << 2)
+#define OT_CHANGED_THREAD_NETDATA (1U << 9)
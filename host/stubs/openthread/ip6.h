@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stub: otIp6Address layout matches OpenThread.
+
+#include <openthread/instance.h>
+
+#define OT_IP6_ADDRESS_SIZE 16
+#define OT_IP6_ADDRESS_STRING_SIZE 40
+
+typedef struct {
+    union {
+        uint8_t m8[OT_IP6_ADDRESS_SIZE];
+        uint16_t m16[OT_IP6_ADDRESS_SIZE / 2];
+        uint32_t m32[OT_IP6_ADDRESS_SIZE / 4];
+    } mFields;
+} otIp6Address;
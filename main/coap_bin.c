@@ -0,0 +1,152 @@
+#include "coap_bin.h"
+
+#include <string.h>
+
+
+#define HDR_VERSION_SHIFT 6
+#define HDR_TYPE_SHIFT    3
+#define HDR_TYPE_MASK     0x07
+#define HDR_FLAGS_MASK    0x07
+
+static size_t put_varint(uint8_t *buf, size_t len, size_t pos, uint32_t v)
+{
+    do {
+        if (pos >= len) {
+            return 0;
+        }
+        uint8_t b = (uint8_t)(v & 0x7F);
+        v >>= 7;
+        buf[pos++] = v ? (uint8_t)(b | 0x80) : b;
+    } while (v);
+    return pos;
+}
+
+static bool get_varint(const uint8_t *buf, size_t len, size_t *pos, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 5; i++) {
+        if (*pos >= len) {
+            return false;
+        }
+        uint8_t b = buf[(*pos)++];
+        // 5-й байт несёт только старшие 4 бита uint32
+        if (i == 4 && (b & 0xF0)) {
+            return false;
+        }
+        v |= (uint32_t)(b & 0x7F) << (7 * i);
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint8_t owner_len(uint8_t flags)
+{
+    if (flags & COAP_BIN_F_OWNER_FULL) return 16;
+    if (flags & COAP_BIN_F_OWNER_IID) return 8;
+    return 0;
+}
+
+size_t coap_bin_encode(const coap_bin_msg_t *msg, uint8_t *buf, size_t len)
+{
+    if (msg->type < COAP_BIN_TRIGGER || msg->type > COAP_BIN_MODE || (msg->flags & ~HDR_FLAGS_MASK) ||
+        len == 0) {
+        return 0;
+    }
+    if (msg->type == COAP_BIN_STATE_RSP &&
+        (msg->flags & COAP_BIN_F_OWNER_IID) && (msg->flags & COAP_BIN_F_OWNER_FULL)) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    buf[pos++] = (uint8_t)((COAP_BIN_VERSION << HDR_VERSION_SHIFT) |
+                           ((uint8_t)msg->type << HDR_TYPE_SHIFT) | msg->flags);
+
+    switch (msg->type) {
+        case COAP_BIN_TRIGGER:
+            pos = put_varint(buf, len, pos, msg->epoch);
+            if (pos) pos = put_varint(buf, len, pos, msg->rem_ms);
+            break;
+        case COAP_BIN_OFF:
+            pos = put_varint(buf, len, pos, msg->epoch);
+            break;
+        case COAP_BIN_STATE_REQ:
+            break;
+        case COAP_BIN_STATE_RSP: {
+            pos = put_varint(buf, len, pos, msg->epoch);
+            if (pos) pos = put_varint(buf, len, pos, msg->rem_ms);
+            uint8_t ol = owner_len(msg->flags);
+            if (pos && ol) {
+                if (pos + ol > len) {
+                    return 0;
+                }
+                memcpy(&buf[pos], &msg->owner[16 - ol], ol);
+                pos += ol;
+            }
+            break;
+        }
+        case COAP_BIN_MODE:
+            if (msg->flags & COAP_BIN_F_M) pos = put_varint(buf, len, pos, msg->m);
+            if (pos && (msg->flags & COAP_BIN_F_CLR)) pos = put_varint(buf, len, pos, msg->clr);
+            if (pos && (msg->flags & COAP_BIN_F_Z)) pos = put_varint(buf, len, pos, msg->z);
+            break;
+    }
+    return pos;
+}
+
+bool coap_bin_decode(const uint8_t *buf, size_t len, coap_bin_msg_t *out)
+{
+    if (len < 1 || (buf[0] >> HDR_VERSION_SHIFT) != COAP_BIN_VERSION) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+    out->type = (coap_bin_type_t)((buf[0] >> HDR_TYPE_SHIFT) & HDR_TYPE_MASK);
+    out->flags = buf[0] & HDR_FLAGS_MASK;
+
+    size_t pos = 1;
+    switch (out->type) {
+        case COAP_BIN_TRIGGER:
+            if (out->flags ||
+                !get_varint(buf, len, &pos, &out->epoch) ||
+                !get_varint(buf, len, &pos, &out->rem_ms)) {
+                return false;
+            }
+            break;
+        case COAP_BIN_OFF:
+            if (out->flags || !get_varint(buf, len, &pos, &out->epoch)) {
+                return false;
+            }
+            break;
+        case COAP_BIN_STATE_REQ:
+            if (out->flags) {
+                return false;
+            }
+            break;
+        case COAP_BIN_STATE_RSP: {
+            if ((out->flags & COAP_BIN_F_OWNER_IID) && (out->flags & COAP_BIN_F_OWNER_FULL)) {
+                return false;
+            }
+            if (!get_varint(buf, len, &pos, &out->epoch) ||
+                !get_varint(buf, len, &pos, &out->rem_ms)) {
+                return false;
+            }
+            uint8_t ol = owner_len(out->flags);
+            if (pos + ol > len) {
+                return false;
+            }
+            memcpy(&out->owner[16 - ol], &buf[pos], ol);
+            pos += ol;
+            break;
+        }
+        case COAP_BIN_MODE:
+            if ((out->flags & COAP_BIN_F_M) && !get_varint(buf, len, &pos, &out->m)) return false;
+            if ((out->flags & COAP_BIN_F_CLR) && !get_varint(buf, len, &pos, &out->clr)) return false;
+            if ((out->flags & COAP_BIN_F_Z) && !get_varint(buf, len, &pos, &out->z)) return false;
+            break;
+        default:
+            return false;
+    }
+    return pos == len;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// Двоичный формат payload сообщений зоны (trigger / off / state_req / state_rsp / mode).
+// Выбирается опцией CoAP Content-Format = COAP_BIN_CONTENT_FORMAT; без неё payload —
+// прежний текст (e=..;a=..;r=..;o=..), его узлы принимают по-прежнему.
+//
+//   байт 0      версия (биты 7..6) | тип (5..3) | флаги типа (2..0)
+//   далее       поля типа, целые — varint (LEB128, до 5 байт на uint32)
+//
+//   TRIGGER     epoch, rem_ms
+//   OFF         epoch
+//   STATE_REQ   —
+//   STATE_RSP   флаги: ACTIVE, OWNER_IID (8 байт IID, префикс = mesh-local получателя)
+//               или OWNER_FULL (16 байт); поля: epoch, rem_ms, owner
+//   MODE        флаги: M, CLR, Z; поля: m, clr, z (только отмеченные, в этом порядке)
+//
+// Без зависимостей от OpenThread — собирается и на хосте (host/coap_bin_size.c).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// экспериментальный диапазон RFC 7252 (65000..65535)
+#define COAP_BIN_CONTENT_FORMAT 65001
+#define COAP_BIN_VERSION        1
+#define COAP_BIN_MAX_LEN        (1 + 5 + 5 + 16)   // самое длинное: state_rsp с полным owner
+
+typedef enum {
+    COAP_BIN_TRIGGER = 1,
+    COAP_BIN_OFF,
+    COAP_BIN_STATE_REQ,
+    COAP_BIN_STATE_RSP,
+    COAP_BIN_MODE,
+} coap_bin_type_t;
+
+// флаги STATE_RSP
+#define COAP_BIN_F_ACTIVE     (1u << 0)
+#define COAP_BIN_F_OWNER_IID  (1u << 1)
+#define COAP_BIN_F_OWNER_FULL (1u << 2)
+// флаги MODE
+#define COAP_BIN_F_M          (1u << 0)
+#define COAP_BIN_F_CLR        (1u << 1)
+#define COAP_BIN_F_Z          (1u << 2)
+
+typedef struct {
+    coap_bin_type_t type;
+    uint8_t flags;            // COAP_BIN_F_* своего типа
+    uint32_t epoch;
+    uint32_t rem_ms;
+    uint32_t m;
+    uint32_t clr;
+    uint32_t z;
+    uint8_t owner[16];        // при OWNER_IID значимы owner[8..15]
+} coap_bin_msg_t;
+
+// длина закодированного сообщения; 0 — не влезло в len или неверный тип/флаги
+size_t coap_bin_encode(const coap_bin_msg_t *msg, uint8_t *buf, size_t len);
+
+// false — чужая версия, неизвестный тип, лишние/недостающие байты
+bool coap_bin_decode(const uint8_t *buf, size_t len, coap_bin_msg_t *out);
+
+#ifdef __cplusplus
+}
+#endif
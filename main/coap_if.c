@@ -3,9 +3,14 @@
 #include "config.h"
 #include "config_store.h"
 #include "rust_payload.h"
+#include "coap_bin.h"
 
 #include "esp_openthread_lock.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #include <openthread/coap.h>
 #include <openthread/message.h>
@@ -15,19 +20,125 @@
 #include <stdio.h>
 
 #include <openthread/thread.h>
+#include "openthread/cli.h"
 
 
 static const char *TAG = "coap_if";
 static otInstance *s_ot = NULL;
 
 static otIp6Address s_mcast_all_nodes; // ff03::1
+static otIp6Address s_mcast_zone_base;  // COAP_ZONE_MCAST_BASE
+
+// роль и ML-EID узла: обновляет coap_if_state_changed() (контекст OpenThread), читают
+// логика и обработчики без обращения к стеку
+static portMUX_TYPE s_net_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_thread_ready;
+static bool s_ml_eid_valid;
+static otIp6Address s_ml_eid;
+
+// запросы, не совпавшие ни с одним ресурсом (чужие зоны через ff03::1 и т.п.)
+static uint32_t s_rx_foreign;
+// multicast зоны, дошедшие до обработчиков, по адресу назначения: группа зоны / ff03::1.
+// Вместе с foreign — RX узла на уровне CoAP при COAP_ZONE_MCAST 0 и 1
+static uint32_t s_rx_mc_group;
+static uint32_t s_rx_mc_all;
+
+// результат подписки на группу зоны (по слотам s_zone_ids); не подписан — multicast зоны
+// от узлов с COAP_ZONE_MCAST 1 сюда не доходит
+static otError s_zone_sub_err[LOGIC_MAX_ZONES];
+
+// каждая группа зоны — внешний multicast-адрес OpenThread (по умолчанию их всего 2)
+#if !defined(OPENTHREAD_CONFIG_IP6_MAX_EXT_MCAST_ADDRS) || \
+    OPENTHREAD_CONFIG_IP6_MAX_EXT_MCAST_ADDRS < LOGIC_MAX_ZONES
+#error "OPENTHREAD_CONFIG_IP6_MAX_EXT_MCAST_ADDRS must be >= LOGIC_MAX_ZONES (zone multicast groups)"
+#endif
+
+// multicast зоны по типам: hop limit отправки и счётчики для настройки рассылки
+typedef enum {
+    MC_TRIGGER,
+    MC_OFF,
+    MC_STATE_REQ,
+    MC_STATE_RSP,
+    MC_COUNT,
+} mc_type_t;
+
+static const char *const k_mc_names[MC_COUNT] = {"trigger", "off", "state_req", "state_rsp"};
+
+typedef struct {
+    uint8_t hops;        // 0 = по умолчанию стека
+    uint8_t rx_hop_min;  // наименьший остаток hop limit при приёме (0 = не было приёма)
+    uint32_t tx;
+    uint32_t rx;
+    uint32_t dup;        // повтор (отправитель, Message ID)
+} mc_stats_t;
+
+static mc_stats_t s_mc[MC_COUNT] = {
+    [MC_TRIGGER]   = {.hops = COAP_MCAST_HOPS_TRIGGER},
+    [MC_OFF]       = {.hops = COAP_MCAST_HOPS_OFF},
+    [MC_STATE_REQ] = {.hops = COAP_MCAST_HOPS_STATE_REQ},
+    [MC_STATE_RSP] = {.hops = COAP_MCAST_HOPS_STATE_RSP},
+};
+
+typedef struct {
+    otIp6Address peer;
+    uint16_t mid;
+    bool used;
+} mc_seen_t;
+
+static mc_seen_t s_mc_seen[COAP_MCAST_DUP_SLOTS];
+static uint8_t s_mc_seen_next;
+
+// зоны узла в порядке регистрации ресурсов (индекс = слот наблюдателей)
+static uint8_t s_zone_ids[LOGIC_MAX_ZONES];
+static uint8_t s_zone_count;
+
+// наблюдатель zone/<id>/state; gen отличает переиспользованный слот в ответе на CON
+typedef struct {
+    bool used;
+    uint8_t gen;
+    uint8_t token_len;
+    uint8_t token[OT_COAP_MAX_TOKEN_LENGTH];
+    otIp6Address addr;
+    uint16_t port;
+    uint32_t sent;       // уведомлений этому наблюдателю, для COAP_OBS_CON_EVERY
+} coap_obs_t;
+
+// пустой ACK на CON-уведомление (2.05) завершает обмен только с Observe API OpenThread;
+// без него стек ждёт отдельного ответа, и on_notify_ack снимал бы живого наблюдателя по
+// таймауту. Флаг задаётся в корневом CMakeLists.txt для всех компонентов
+#if !OPENTHREAD_CONFIG_COAP_OBSERVE_API_ENABLE
+#error "OPENTHREAD_CONFIG_COAP_OBSERVE_API_ENABLE=1 is required for Observe notifications"
+#endif
+
+static coap_obs_t s_obs[LOGIC_MAX_ZONES][COAP_OBS_MAX];
+static uint32_t s_obs_seq[LOGIC_MAX_ZONES];    // Observe: 24 бита, на ресурс
 
 // ---- helpers ----
 
-static void zone_id_str(char *out, size_t n)
+// на каждой отправке: без snprintf
+static void zone_id_str(uint8_t zone_id, char *out, size_t n)
 {
-    const app_config_t *cfg = config_store_get();
-    snprintf(out, n, "%d", cfg->zone_id);
+    if (n < 4) {
+        if (n) {
+            out[0] = '\0';
+        }
+        return;
+    }
+    char *p = out;
+    if (zone_id >= 100) {
+        *p++ = (char)('0' + zone_id / 100);
+    }
+    if (zone_id >= 10) {
+        *p++ = (char)('0' + zone_id / 10 % 10);
+    }
+    *p++ = (char)('0' + zone_id % 10);
+    *p = '\0';
+}
+
+// zone_id передаётся в mContext ресурса
+static uint8_t ctx_zone_id(void *ctx)
+{
+    return (uint8_t)(uintptr_t)ctx;
 }
 
 static otMessage *new_post_msg(void)
@@ -43,7 +154,67 @@ static void append_uri(otMessage *m, const char *seg)
     (void)otCoapMessageAppendUriPathOptions(m, seg);
 }
 
-static otMessage *build_state_req_msg(void)
+// двоичный payload (coap_bin.h): Content-Format после Uri-Path, затем маркер и данные
+static void append_payload_bin(otMessage *m, const coap_bin_msg_t *bm)
+{
+    uint8_t pl[COAP_BIN_MAX_LEN];
+    size_t n = coap_bin_encode(bm, pl, sizeof(pl));
+    (void)otCoapMessageAppendContentFormatOption(m, (otCoapOptionContentFormat)COAP_BIN_CONTENT_FORMAT);
+    otCoapMessageSetPayloadMarker(m);
+    otMessageAppend(m, pl, (uint16_t)n);
+}
+
+#if !COAP_TX_BINARY
+static bool msg_sink(void *ctx, const uint8_t *data, uint32_t len)
+{
+    return otMessageAppend((otMessage *)ctx, data, (uint16_t)len) == OT_ERROR_NONE;
+}
+
+// текстовый payload (rust_encode_payload_sink): прямо в сообщение, без printf и буфера
+static void append_payload_text(otMessage *m, const rust_parsed_t *p)
+{
+    otCoapMessageSetPayloadMarker(m);
+    (void)rust_encode_payload_sink(p, msg_sink, m);
+}
+#endif
+
+static int zone_slot(uint8_t zone_id)
+{
+    for (uint8_t i = 0; i < s_zone_count; i++) {
+        if (s_zone_ids[i] == zone_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool msg_observe(const otMessage *msg, uint64_t *val)
+{
+    otCoapOptionIterator it;
+    if (otCoapOptionIteratorInit(&it, msg) != OT_ERROR_NONE) {
+        return false;
+    }
+    if (!otCoapOptionIteratorGetFirstOptionMatching(&it, OT_COAP_OPTION_OBSERVE)) {
+        return false;
+    }
+    return otCoapOptionIteratorGetOptionUintValue(&it, val) == OT_ERROR_NONE;
+}
+
+static bool msg_is_binary(const otMessage *msg)
+{
+    otCoapOptionIterator it;
+    if (otCoapOptionIteratorInit(&it, msg) != OT_ERROR_NONE) {
+        return false;
+    }
+    if (!otCoapOptionIteratorGetFirstOptionMatching(&it, OT_COAP_OPTION_CONTENT_FORMAT)) {
+        return false;
+    }
+    uint64_t cf = 0;
+    return otCoapOptionIteratorGetOptionUintValue(&it, &cf) == OT_ERROR_NONE &&
+           cf == COAP_BIN_CONTENT_FORMAT;
+}
+
+static otMessage *build_state_req_msg(uint8_t zone_id)
 {
     otMessage *m = new_post_msg();
     if (!m) {
@@ -51,23 +222,156 @@ static otMessage *build_state_req_msg(void)
     }
 
     char zid[8];
-    zone_id_str(zid, sizeof(zid));
+    zone_id_str(zone_id, zid, sizeof(zid));
 
     append_uri(m, "zone");
     append_uri(m, zid);
     append_uri(m, "state_req");
 
+#if COAP_TX_BINARY
+    coap_bin_msg_t bm = {.type = COAP_BIN_STATE_REQ};
+    append_payload_bin(m, &bm);
+#else
     otCoapMessageSetPayloadMarker(m);
     otMessageAppend(m, "1", 1);
+#endif
 
     return m;
 }
 
-static void send_mcast(otMessage *m)
+// payload state_rsp: owner в двоичном виде — IID, если префикс совпадает с нашим mesh-local
+static void append_state_rsp_payload(otMessage *m, uint32_t epoch, const otIp6Address *owner,
+                                     uint32_t rem_ms, bool active)
+{
+#if COAP_TX_BINARY
+    coap_bin_msg_t bm = {
+        .type = COAP_BIN_STATE_RSP,
+        .flags = active ? COAP_BIN_F_ACTIVE : 0,
+        .epoch = epoch,
+        .rem_ms = rem_ms,
+    };
+    static const uint8_t k_zero[16] = {0};
+    if (memcmp(owner->mFields.m8, k_zero, 16) != 0) {
+        const otMeshLocalPrefix *ml = otThreadGetMeshLocalPrefix(s_ot);
+        bool same_prefix = ml && memcmp(owner->mFields.m8, ml->m8, 8) == 0;
+        bm.flags |= same_prefix ? COAP_BIN_F_OWNER_IID : COAP_BIN_F_OWNER_FULL;
+        memcpy(bm.owner, owner->mFields.m8, 16);
+    }
+    append_payload_bin(m, &bm);
+#else
+    // e=..;a=..;r=..;o=....
+    rust_parsed_t p = {
+        .has_epoch = 1, .epoch = epoch,
+        .has_active = 1, .active = active ? 1 : 0,
+        .has_rem_ms = 1, .rem_ms = rem_ms,
+        .has_owner = 1,
+    };
+    memcpy(p.owner, owner->mFields.m8, sizeof(p.owner));
+    append_payload_text(m, &p);
+#endif
+}
+
+// Разбор payload прямо из otMessage, без копии всего payload: текст идёт в потоковый
+// Rust-разборщик (rust_kv_*) окнами COAP_RX_WINDOW байт (размер payload стек не
+// увеличивает), двоичный (msg_is_binary) читается целиком — он не длиннее COAP_BIN_MAX_LEN. Owner state_rsp
+// (o= текста или из двоичного) — в out->owner за тот же проход.
+static bool parse_payload(const otMessage *msg, coap_bin_type_t type, rust_parsed_t *out)
+{
+    uint16_t off = otMessageGetOffset(msg);
+    uint16_t end = otMessageGetLength(msg);
+    int len = (end > off) ? (int)(end - off) : 0;
+
+    if (!msg_is_binary(msg)) {
+        rust_kv_t kv;
+        uint8_t win[COAP_RX_WINDOW];
+        rust_kv_init(&kv);
+        while (off < end) {
+            uint16_t n = (uint16_t)(end - off);
+            if (n > sizeof(win)) {
+                n = sizeof(win);
+            }
+            if (otMessageRead(msg, off, win, n) != n) {
+                return false;
+            }
+            rust_kv_feed(&kv, win, n);
+            off = (uint16_t)(off + n);
+        }
+        if (!rust_kv_finish(&kv, out)) {
+            ESP_LOGW(TAG, "bad text payload len=%d type=%d", len, (int)type);
+            return false;
+        }
+        return true;
+    }
+
+    uint8_t buf[COAP_BIN_MAX_LEN];
+    coap_bin_msg_t bm;
+    if (len <= 0 || len > (int)sizeof(buf) || otMessageRead(msg, off, buf, (uint16_t)len) != len ||
+        !coap_bin_decode(buf, (size_t)len, &bm) || bm.type != type) {
+        ESP_LOGW(TAG, "bad binary payload len=%d type=%d", len, (int)type);
+        return false;
+    }
+    switch (type) {
+        case COAP_BIN_TRIGGER:
+            out->has_epoch = 1;
+            out->epoch = bm.epoch;
+            out->has_rem_ms = 1;
+            out->rem_ms = bm.rem_ms;
+            break;
+        case COAP_BIN_OFF:
+            out->has_epoch = 1;
+            out->epoch = bm.epoch;
+            break;
+        case COAP_BIN_STATE_RSP:
+            out->has_epoch = 1;
+            out->epoch = bm.epoch;
+            out->has_rem_ms = 1;
+            out->rem_ms = bm.rem_ms;
+            out->has_active = 1;
+            out->active = (bm.flags & COAP_BIN_F_ACTIVE) ? 1 : 0;
+            if (bm.flags & COAP_BIN_F_OWNER_FULL) {
+                out->has_owner = 1;
+                memcpy(out->owner, bm.owner, 16);
+            } else if (bm.flags & COAP_BIN_F_OWNER_IID) {
+                const otMeshLocalPrefix *ml = otThreadGetMeshLocalPrefix(s_ot);
+                if (ml) {
+                    memcpy(out->owner, ml->m8, 8);
+                }
+                memcpy(&out->owner[8], &bm.owner[8], 8);
+                out->has_owner = 1;
+            }
+            break;
+        case COAP_BIN_MODE:
+            out->has_m = (bm.flags & COAP_BIN_F_M) ? 1 : 0;
+            out->m = bm.m;
+            out->has_clr = (bm.flags & COAP_BIN_F_CLR) ? 1 : 0;
+            out->clr = bm.clr;
+            out->has_z = (bm.flags & COAP_BIN_F_Z) ? 1 : 0;
+            out->z = bm.z;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+static void zone_mcast_addr(uint8_t zone_id, otIp6Address *out)
+{
+    *out = s_mcast_zone_base;
+    out->mFields.m8[15] = zone_id;
+}
+
+static void send_mcast(otMessage *m, uint8_t zone_id, mc_type_t type)
 {
     otMessageInfo info;
     memset(&info, 0, sizeof(info));
+    info.mHopLimit = s_mc[type].hops;
+    s_mc[type].tx++;
+#if COAP_ZONE_MCAST
+    zone_mcast_addr(zone_id, &info.mPeerAddr);
+#else
+    (void)zone_id;
     info.mPeerAddr = s_mcast_all_nodes;
+#endif
     info.mPeerPort = OT_DEFAULT_COAP_PORT;
 
     otError e = otCoapSendRequest(s_ot, m, &info, NULL, NULL);
@@ -138,115 +442,6 @@ static void coap_send_empty_ack(otMessage *req, const otMessageInfo *req_info)
 
 
 
-static bool parse_ip_kv(const char *s, const char *key, otIp6Address *out)
-{
-    const char *p = strstr(s, key);
-    if (!p) return false;
-    p += strlen(key);
-    if (*p != '=') return false;
-    p++;
-
-    // копируем до ';' или конца
-    char buf[64];
-    size_t i = 0;
-    while (*p && *p != ';' && i + 1 < sizeof(buf)) {
-        buf[i++] = *p++;
-    }
-    buf[i] = 0;
-    if (i == 0) return false;
-
-    return (otIp6AddressFromString(buf, out) == OT_ERROR_NONE);
-}
-
-static bool parse_u32_kv(const char *s, const char *key, uint32_t *out)
-{
-    const char *p = strstr(s, key);
-    if (!p) {
-        return false;
-    }
-    p += strlen(key);
-    if (*p != '=') {
-        return false;
-    }
-    p++;
-
-    char *end = NULL;
-    unsigned long v = strtoul(p, &end, 10);
-    if (end == p) {
-        return false;
-    }
-    *out = (uint32_t)v;
-    return true;
-}
-
-static bool parse_bool_kv(const char *s, const char *key, bool *out)
-{
-    uint32_t v = 0;
-    if (!parse_u32_kv(s, key, &v)) {
-        return false;
-    }
-    *out = (v != 0);
-    return true;
-}
-
-// static int read_payload(otMessage *msg, char *buf, size_t n)
-// {
-//     uint16_t off = otMessageGetOffset(msg);
-//     uint16_t len = otMessageGetLength(msg);
-//     if (len <= off) return 0;
-//     uint16_t pl = (uint16_t)(len - off);
-//     if (pl >= n) pl = (uint16_t)(n - 1);
-
-//     otMessageRead(msg, off, buf, pl);
-//     buf[pl] = 0;
-//     return (int)pl;
-// }
-
-static int read_payload(otMessage *msg, char *out, size_t out_sz)
-{
-    if (!out || out_sz == 0) {
-        return 0;
-    }
-    out[0] = 0;
-
-    int len = (int)otMessageGetLength(msg);
-    if (len <= 0) {
-        return 0;
-    }
-
-    uint16_t offset = otMessageGetOffset(msg);
-    if (offset >= len) {
-        return 0;
-    }
-
-    int payload_len = len - (int)offset;
-    if (payload_len <= 0) {
-        return 0;
-    }
-
-    size_t copy = (size_t)payload_len;
-    bool truncated = false;
-    if (copy > out_sz - 1) {
-        copy = out_sz - 1;
-        truncated = true;
-    }
-
-    int rd = otMessageRead(msg, offset, out, (uint16_t)copy);
-    if (rd <= 0) {
-        out[0] = 0;
-        return 0;
-    }
-
-    out[rd] = 0;
-
-    if (truncated) {
-        ESP_LOGW(TAG, "payload truncated: len=%d, buf=%zu", payload_len, out_sz - 1);
-    }
-
-    return rd;
-}
-
-
 static void send_ok(otMessage *req, const otMessageInfo *info)
 {
     otMessage *rsp = otCoapNewMessage(s_ot, NULL);
@@ -281,42 +476,52 @@ static void send_ok(otMessage *req, const otMessageInfo *info)
 //     send_ok(msg, info);
 // }
 
+// учёт multicast-приёма; false — дубль (тот же отправитель и Message ID), не обрабатывать
+static bool mc_rx(mc_type_t type, const otMessage *msg, const otMessageInfo *info)
+{
+    if (info->mSockAddr.mFields.m8[0] != 0xff) {
+        return true;
+    }
+    if (memcmp(info->mSockAddr.mFields.m8, s_mcast_zone_base.mFields.m8, 15) == 0) {
+        s_rx_mc_group++;
+    } else {
+        s_rx_mc_all++;
+    }
+    mc_stats_t *st = &s_mc[type];
+    st->rx++;
+    if (st->rx_hop_min == 0 || info->mHopLimit < st->rx_hop_min) {
+        st->rx_hop_min = info->mHopLimit;
+    }
+
+    uint16_t mid = otCoapMessageGetMessageId(msg);
+    for (int i = 0; i < COAP_MCAST_DUP_SLOTS; i++) {
+        const mc_seen_t *s = &s_mc_seen[i];
+        if (s->used && s->mid == mid && memcmp(&s->peer, &info->mPeerAddr, sizeof(s->peer)) == 0) {
+            st->dup++;
+            return false;
+        }
+    }
+    mc_seen_t *s = &s_mc_seen[s_mc_seen_next];
+    s_mc_seen_next = (uint8_t)((s_mc_seen_next + 1) % COAP_MCAST_DUP_SLOTS);
+    s->peer = info->mPeerAddr;
+    s->mid = mid;
+    s->used = true;
+    return true;
+}
+
 static void on_state_req(void *ctx, otMessage *msg, const otMessageInfo *info)
 {
-    (void)ctx;
+    uint8_t zone_id = ctx_zone_id(ctx);
+    if (!mc_rx(MC_STATE_REQ, msg, info)) {
+        return;
+    }
 
     // ACK только для CON, для NON ничего не отвечаем
     coap_send_empty_ack(msg, info);
 
-    // кто угодно отвечает своим состоянием unicast обратно отправителю
-    uint32_t epoch = 0;
-    otIp6Address owner;
-    uint32_t rem_ms = 0;
-    bool active = false;
-
-    logic_build_state(&epoch, &owner, &rem_ms, &active);
-    otMessage *rsp = new_post_msg();
-    if (rsp) {
-        append_uri(rsp, "zone");
-        char zid[8];
-        zone_id_str(zid, sizeof(zid));
-        append_uri(rsp, zid);
-        append_uri(rsp, "state_rsp");
-
-        char owner_str[OT_IP6_ADDRESS_STRING_SIZE];
-        otIp6AddressToString(&owner, owner_str, sizeof(owner_str));
-
-        char pl[200];
-        snprintf(pl, sizeof(pl), "e=%lu;a=%u;r=%lu;o=%s",
-                 (unsigned long)epoch,
-                 active ? 1u : 0u,
-                 (unsigned long)rem_ms,
-                 owner_str);
-
-        otCoapMessageSetPayloadMarker(rsp);
-        otMessageAppend(rsp, pl, (uint16_t)strlen(pl));
-        send_ucast(rsp, info);
-    }
+    // ответ — не сразу unicast'ом, а отложенным multicast'ом из logic (STATE_RSP_*):
+    // так его слышат и остальные узлы зоны и не отвечают повторно
+    logic_post_state_req_rx(zone_id, &info->mPeerAddr);
 
     // НЕ send_ok() !
 }
@@ -324,7 +529,11 @@ static void on_state_req(void *ctx, otMessage *msg, const otMessageInfo *info)
 
 static void on_state_rsp(void *ctx, otMessage *msg, const otMessageInfo *info)
 {
-    (void)ctx;
+    logic_rx_stamp();
+    uint8_t zone_id = ctx_zone_id(ctx);
+    if (!mc_rx(MC_STATE_RSP, msg, info)) {
+        return;
+    }
 
     otIp6Address my;
     if (coap_if_get_my_meshlocal_eid(&my)) {
@@ -335,90 +544,39 @@ static void on_state_rsp(void *ctx, otMessage *msg, const otMessageInfo *info)
     }
 
 
-    (void)info;
-
-    char buf[160];
-    int len = read_payload(msg, buf, sizeof(buf));
-
-    // формат: e=123;a=1;r=600000;o=fdde:....
+    // формат: e=123;a=1;r=600000;o=fdde:.... или двоичный (coap_bin.h)
     rust_parsed_t parsed = {0};
-    if (rust_parse_payload((const uint8_t *)buf, (uint32_t)len, &parsed) &&
-        parsed.has_epoch && parsed.has_active) {
-        otIp6Address owner;
-        if (!parse_ip_kv(buf, "o", &owner)) {
-            memset(&owner, 0, sizeof(owner));
-        }
-
-        if (!logic_post_parsed(LOGIC_PARSED_STATE_RSP, &parsed, &owner, true)) {
-            return;
-        }
-
-        send_ok(msg, info);
+    if (!parse_payload(msg, COAP_BIN_STATE_RSP, &parsed) ||
+        !logic_post_parsed(LOGIC_PARSED_STATE_RSP, zone_id, &parsed, NULL, true)) {
         return;
     }
 
-    uint32_t epoch = 0;
-    uint32_t rem_ms = 0;
-    bool active = false;
-    otIp6Address owner;
-    if (!parse_u32_kv(buf, "e", &epoch)) {
-        return;
-    }
-    if (!parse_bool_kv(buf, "a", &active)) {
-        return;
-    }
-    if (!parse_u32_kv(buf, "r", &rem_ms)) {
-        rem_ms = 0;
-    }
-    if (!parse_ip_kv(buf, "o", &owner)) {
-        memset(&owner, 0, sizeof(owner));
-    }
-
-    logic_post_state_response(epoch, &owner, rem_ms, active);
-    send_ok(msg, info);
+    // НЕ send_ok(): state_rsp идёт multicast на всю зону, "ok" от каждого узла зоны —
+    // та же лавина ответов, а отправитель ответ не ждёт (send_mcast без обработчика)
 }
 
 static void on_trigger(void *ctx, otMessage *msg, const otMessageInfo *info)
 {
-    (void)ctx;
-
-    char buf[96];
-    int len = read_payload(msg, buf, sizeof(buf));
-
-    rust_parsed_t parsed = {0};
-    if (rust_parse_payload((const uint8_t *)buf, (uint32_t)len, &parsed) &&
-        logic_post_parsed(LOGIC_PARSED_TRIGGER, &parsed, &info->mPeerAddr, true)) {
-        // ACK только для CON, для NON ничего не отвечаем
-        coap_send_empty_ack(msg, info);
-
-        if (parsed.has_epoch) {
-            uint32_t rem_ms = parsed.has_rem_ms ? parsed.rem_ms : config_store_get()->auto_hold_ms;
-            ESP_LOGI(TAG, "RX trigger from peer, epoch=%lu rem_ms=%lu",
-                     (unsigned long)parsed.epoch, (unsigned long)rem_ms);
-        }
+    logic_rx_stamp();
+    uint8_t zone_id = ctx_zone_id(ctx);
+    if (!mc_rx(MC_TRIGGER, msg, info)) {
         return;
     }
 
-    uint32_t epoch = 0;
-    uint32_t rem_ms = 0;
-    if (!parse_u32_kv(buf, "epoch", &epoch)) {
-        if (!parse_u32_kv(buf, "e", &epoch)) {
-            return;
-        }
-    }
-    if (!parse_u32_kv(buf, "rem_ms", &rem_ms)) {
-        if (!parse_u32_kv(buf, "h", &rem_ms)) {
-            rem_ms = config_store_get()->auto_hold_ms;
-        }
+    rust_parsed_t parsed = {0};
+    if (!parse_payload(msg, COAP_BIN_TRIGGER, &parsed) ||
+        !logic_post_parsed(LOGIC_PARSED_TRIGGER, zone_id, &parsed, &info->mPeerAddr, true)) {
+        return;
     }
 
+    // ACK только для CON, для NON ничего не отвечаем
     coap_send_empty_ack(msg, info);
-    ESP_LOGI(TAG, "RX trigger from peer, epoch=%lu rem_ms=%lu",
-             (unsigned long)epoch, (unsigned long)rem_ms);
-    logic_post_trigger_rx(epoch, &info->mPeerAddr, rem_ms);
-
-    // logic_post_state_response(epoch, &owner, rem_ms, active);
 
+    if (parsed.has_epoch) {
+        uint32_t rem_ms = parsed.has_rem_ms ? parsed.rem_ms : config_store_get()->auto_hold_ms;
+        ESP_LOGI(TAG, "RX trigger zone=%u from peer, epoch=%lu rem_ms=%lu",
+                 (unsigned)zone_id, (unsigned long)parsed.epoch, (unsigned long)rem_ms);
+    }
 
     // НЕ делать send_ok() здесь!
 }
@@ -426,28 +584,21 @@ static void on_trigger(void *ctx, otMessage *msg, const otMessageInfo *info)
 
 static void on_off(void *ctx, otMessage *msg, const otMessageInfo *info)
 {
-    (void)ctx;
-
-    char buf[64];
-    int len = read_payload(msg, buf, sizeof(buf));
-
-    rust_parsed_t parsed = {0};
-    if (rust_parse_payload((const uint8_t *)buf, (uint32_t)len, &parsed) &&
-        logic_post_parsed(LOGIC_PARSED_OFF, &parsed, NULL, true)) {
-        if (parsed.has_epoch) {
-            ESP_LOGI(TAG, "RX off epoch=%lu", (unsigned long)parsed.epoch);
-        }
-        send_ok(msg, info);
+    logic_rx_stamp();
+    uint8_t zone_id = ctx_zone_id(ctx);
+    if (!mc_rx(MC_OFF, msg, info)) {
         return;
     }
 
-    uint32_t epoch = 0;
-    if (!parse_u32_kv(buf, "e", &epoch)) {
+    rust_parsed_t parsed = {0};
+    if (!parse_payload(msg, COAP_BIN_OFF, &parsed) ||
+        !logic_post_parsed(LOGIC_PARSED_OFF, zone_id, &parsed, NULL, true)) {
         return;
     }
 
-    ESP_LOGI(TAG, "RX off epoch=%lu", (unsigned long)epoch);
-    logic_post_off_rx(epoch);
+    if (parsed.has_epoch) {
+        ESP_LOGI(TAG, "RX off zone=%u epoch=%lu", (unsigned)zone_id, (unsigned long)parsed.epoch);
+    }
     send_ok(msg, info);
 }
 
@@ -462,16 +613,16 @@ static void on_off(void *ctx, otMessage *msg, const otMessageInfo *info)
 
 static void on_mode_set(void *ctx, otMessage *msg, const otMessageInfo *info)
 {
-    (void)ctx;
-
-    char buf[128];
-    int len = read_payload(msg, buf, sizeof(buf));
-
-    ESP_LOGI(TAG, "RX /mode from %x.. payload='%s' sock0=%02x",
-         info->mPeerAddr.mFields.m8[15], buf, info->mSockAddr.mFields.m8[0]);
+    logic_rx_stamp();
+    uint8_t zone_id = ctx_zone_id(ctx);
 
     rust_parsed_t parsed = {0};
-    if (!rust_parse_payload((const uint8_t *)buf, (uint32_t)len, &parsed)) {
+    bool ok = parse_payload(msg, COAP_BIN_MODE, &parsed);
+    ESP_LOGI(TAG, "RX /mode from %x.. %s m=%ld clr=%ld z=%ld sock0=%02x",
+             info->mPeerAddr.mFields.m8[15], msg_is_binary(msg) ? "bin" : "text",
+             parsed.has_m ? (long)parsed.m : -1L, parsed.has_clr ? (long)parsed.clr : -1L,
+             parsed.has_z ? (long)parsed.z : -1L, info->mSockAddr.mFields.m8[0]);
+    if (!ok) {
         return;
     }
 
@@ -480,7 +631,7 @@ static void on_mode_set(void *ctx, otMessage *msg, const otMessageInfo *info)
     // bool is_multicast = (info->mSockAddr.mAddress.mFields.m8[0] == 0xFF);
     bool is_multicast = (info->mSockAddr.mFields.m8[0] == 0xFF);
 
-    if (!logic_post_parsed(LOGIC_PARSED_MODE, &parsed, NULL, is_multicast)) {
+    if (!logic_post_parsed(LOGIC_PARSED_MODE, zone_id, &parsed, NULL, is_multicast)) {
         return;
     }
 
@@ -488,87 +639,351 @@ static void on_mode_set(void *ctx, otMessage *msg, const otMessageInfo *info)
 }
 
 
-// ---- register ----
+// ---- RX: state (Observe) ----
 
-void coap_if_register(otInstance *ot)
+static coap_obs_t *obs_find(int slot, const otMessage *msg, const otMessageInfo *info)
 {
-    esp_openthread_lock_acquire(portMAX_DELAY);
-    s_ot = ot;
+    uint8_t tlen = otCoapMessageGetTokenLength(msg);
+    const uint8_t *tok = otCoapMessageGetToken(msg);
+    for (int i = 0; i < COAP_OBS_MAX; i++) {
+        coap_obs_t *o = &s_obs[slot][i];
+        if (o->used && o->port == info->mPeerPort && o->token_len == tlen &&
+            memcmp(&o->addr, &info->mPeerAddr, sizeof(o->addr)) == 0 &&
+            memcmp(o->token, tok, tlen) == 0) {
+            return o;
+        }
+    }
+    return NULL;
+}
 
-    otIp6AddressFromString("ff03::1", &s_mcast_all_nodes);
-    otCoapStart(s_ot, OT_DEFAULT_COAP_PORT);
+static coap_obs_t *obs_alloc(int slot)
+{
+    for (int i = 0; i < COAP_OBS_MAX; i++) {
+        if (!s_obs[slot][i].used) {
+            return &s_obs[slot][i];
+        }
+    }
+    return NULL;
+}
+
+static void obs_drop(coap_obs_t *o)
+{
+    o->used = false;
+    o->gen++;
+}
 
-    static char path_state_req[40];
-    static char path_state_rsp[40];
-    static char path_trigger[40];
-    static char path_off[40];
-    static char path_mode[40];
+// GET zone/<id>/state (RFC 7641): Observe=0 — регистрация, только у источника состояния
+// зоны (logic_zone_observable) и не больше COAP_OBS_MAX; Observe=1 — снятие.
+// Ответ — payload state_rsp, Observe в нём — только если наблюдатель зарегистрирован.
+static void on_state_get(void *ctx, otMessage *msg, const otMessageInfo *info)
+{
+    uint8_t zone_id = ctx_zone_id(ctx);
+    int slot = zone_slot(zone_id);
+    if (slot < 0 || otCoapMessageGetCode(msg) != OT_COAP_CODE_GET) {
+        return;
+    }
+
+    uint64_t obs = 0;
+    bool has_obs = msg_observe(msg, &obs);
+    coap_obs_t *o = obs_find(slot, msg, info);
+    bool registered = false;
+    if (has_obs && obs == 0 && logic_zone_observable(zone_id)) {
+        if (!o) {
+            o = obs_alloc(slot);
+            if (o) {
+                o->sent = 0;
+            }
+        }
+        if (o) {
+            o->used = true;
+            o->token_len = otCoapMessageGetTokenLength(msg);
+            memcpy(o->token, otCoapMessageGetToken(msg), o->token_len);
+            o->addr = info->mPeerAddr;
+            o->port = info->mPeerPort;
+            registered = true;
+        } else {
+            ESP_LOGW(TAG, "observe zone=%u: %d observers, refused", (unsigned)zone_id, COAP_OBS_MAX);
+        }
+    } else if (o && has_obs) {
+        obs_drop(o);   // Observe=1 или повторная регистрация, когда источник уже не мы
+    }
+
+    uint32_t epoch = 0;
+    uint32_t rem_ms = 0;
+    bool active = false;
+    otIp6Address owner;
+    logic_build_zone_state(zone_id, &epoch, &owner, &rem_ms, &active);
+
+    otMessage *rsp = otCoapNewMessage(s_ot, NULL);
+    if (!rsp) {
+        return;
+    }
+    bool con = otCoapMessageGetType(msg) == OT_COAP_TYPE_CONFIRMABLE;
+    otCoapMessageInitResponse(rsp, msg, con ? OT_COAP_TYPE_ACKNOWLEDGMENT : OT_COAP_TYPE_NON_CONFIRMABLE,
+                              OT_COAP_CODE_CONTENT);
+    if (registered) {
+        (void)otCoapMessageAppendObserveOption(rsp, s_obs_seq[slot]);
+    }
+    append_state_rsp_payload(rsp, epoch, &owner, rem_ms, active);
+    if (otCoapSendResponse(s_ot, rsp, info) != OT_ERROR_NONE) {
+        otMessageFree(rsp);
+    }
+}
+
+// ---- RX: без ресурса ----
+
+static void on_unmatched(void *ctx, otMessage *msg, const otMessageInfo *info)
+{
+    (void)ctx;
+    s_rx_foreign++;
+    // на multicast не отвечаем; unicast — 4.04, как без обработчика по умолчанию
+    if (info->mSockAddr.mFields.m8[0] == 0xff ||
+        otCoapMessageGetType(msg) != OT_COAP_TYPE_CONFIRMABLE) {
+        return;
+    }
+    otMessage *rsp = otCoapNewMessage(s_ot, NULL);
+    if (!rsp) {
+        return;
+    }
+    otCoapMessageInitResponse(rsp, msg, OT_COAP_TYPE_ACKNOWLEDGMENT, OT_COAP_CODE_NOT_FOUND);
+    if (otCoapSendResponse(s_ot, rsp, info) != OT_ERROR_NONE) {
+        otMessageFree(rsp);
+    }
+}
+
+void coap_if_get_rx_stats(uint32_t *foreign, uint32_t *mc_group, uint32_t *mc_all)
+{
+    if (foreign) *foreign = s_rx_foreign;
+    if (mc_group) *mc_group = s_rx_mc_group;
+    if (mc_all) *mc_all = s_rx_mc_all;
+}
+
+bool coap_if_set_mcast_hops(const char *type, uint8_t hops)
+{
+    for (int t = 0; t < MC_COUNT; t++) {
+        if (strcmp(type, k_mc_names[t]) == 0) {
+            s_mc[t].hops = hops;
+            return true;
+        }
+    }
+    return false;
+}
+
+void coap_if_cli_print_mcast(void)
+{
+    for (int t = 0; t < MC_COUNT; t++) {
+        const mc_stats_t *st = &s_mc[t];
+        otCliOutputFormat("mcast %s: hops=%u tx=%lu rx=%lu dup=%lu rx_hop_min=%u\r\n",
+                          k_mc_names[t], (unsigned)st->hops, (unsigned long)st->tx,
+                          (unsigned long)st->rx, (unsigned long)st->dup,
+                          (unsigned)st->rx_hop_min);
+    }
+    for (uint8_t i = 0; i < s_zone_count; i++) {
+        otCliOutputFormat("zone %u group: %s\r\n", (unsigned)s_zone_ids[i],
+                          s_zone_sub_err[i] == OT_ERROR_NONE ? "subscribed" : "NOT subscribed");
+    }
+}
+
+// ---- logic txbench ----
+// Текстовый state_rsp двумя способами: как раньше (otIp6AddressToString + snprintf в
+// char[200]) и rust_encode_payload_sink. Циклы — среднее на payload в задаче CLI; стек —
+// по high water mark короткой задачи на каждый способ, за вычетом пустой задачи.
+
+#define TXBENCH_STACK 4096
+
+typedef enum { TXB_BASE, TXB_SNPRINTF, TXB_RUST } txbench_kind_t;
+
+typedef struct {
+    txbench_kind_t kind;
+    TaskHandle_t waiter;
+    UBaseType_t hwm;
+} txbench_run_t;
 
+static const otIp6Address k_bench_owner = {
+    .mFields.m8 = {0xfd, 0x11, 0x22, 0x33, 0x44, 0x55, 0x00, 0x00,
+                   0x1a, 0x2b, 0x3c, 0x4d, 0x5e, 0x6f, 0x70, 0x81},
+};
+static uint8_t s_bench_out[RUST_PAYLOAD_TEXT_MAX];   // вместо otMessage
+static uint32_t s_bench_len;
 
-    uint8_t zid = config_store_get()->zone_id;
-    snprintf(path_state_req, sizeof(path_state_req), "zone/%d/state_req", zid);
-    snprintf(path_state_rsp, sizeof(path_state_rsp), "zone/%d/state_rsp", zid);
-    snprintf(path_trigger,   sizeof(path_trigger),   "zone/%d/trigger",   zid);
-    snprintf(path_off,       sizeof(path_off),       "zone/%d/off",       zid);
-    snprintf(path_mode,      sizeof(path_mode),      "zone/%d/mode",      zid);
+static bool bench_sink(void *ctx, const uint8_t *data, uint32_t len)
+{
+    (void)ctx;
+    if (s_bench_len + len > sizeof(s_bench_out)) {
+        return false;
+    }
+    memcpy(&s_bench_out[s_bench_len], data, len);
+    s_bench_len += len;
+    return true;
+}
 
+static __attribute__((noinline)) uint32_t bench_encode(txbench_kind_t kind, uint32_t epoch)
+{
+    s_bench_len = 0;
+    if (kind == TXB_SNPRINTF) {
+        char owner_str[OT_IP6_ADDRESS_STRING_SIZE];
+        otIp6AddressToString(&k_bench_owner, owner_str, sizeof(owner_str));
+        char pl[200];
+        snprintf(pl, sizeof(pl), "e=%lu;a=%u;r=%lu;o=%s", (unsigned long)epoch, 1u,
+                 (unsigned long)287500, owner_str);
+        return bench_sink(NULL, (const uint8_t *)pl, (uint32_t)strlen(pl)) ? s_bench_len : 0;
+    }
+    if (kind == TXB_RUST) {
+        rust_parsed_t p = {
+            .has_epoch = 1, .epoch = epoch,
+            .has_active = 1, .active = 1,
+            .has_rem_ms = 1, .rem_ms = 287500,
+            .has_owner = 1,
+        };
+        memcpy(p.owner, k_bench_owner.mFields.m8, sizeof(p.owner));
+        return rust_encode_payload_sink(&p, bench_sink, NULL);
+    }
+    return 0;
+}
 
-    static otCoapResource r_state_req;
-    static otCoapResource r_state_rsp;
-    static otCoapResource r_trigger;
-    static otCoapResource r_off;
-    static otCoapResource r_mode;
+static void txbench_task(void *arg)
+{
+    txbench_run_t *run = (txbench_run_t *)arg;
+    (void)bench_encode(run->kind, 4000000000u);
+    run->hwm = uxTaskGetStackHighWaterMark(NULL);
+    xTaskNotifyGive(run->waiter);
+    vTaskDelete(NULL);
+}
 
+// байт стека задачи, занятых к концу прогона; 0 — задача не создана
+static uint32_t txbench_stack(txbench_kind_t kind)
+{
+    txbench_run_t run = {.kind = kind, .waiter = xTaskGetCurrentTaskHandle()};
+    if (xTaskCreate(txbench_task, "txbench", TXBENCH_STACK, &run, uxTaskPriorityGet(NULL),
+                    NULL) != pdPASS) {
+        return 0;
+    }
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return (uint32_t)(TXBENCH_STACK - run.hwm * sizeof(StackType_t));
+}
 
-    memset(&r_state_req, 0, sizeof(r_state_req));
-    memset(&r_state_rsp, 0, sizeof(r_state_rsp));
-    memset(&r_trigger,   0, sizeof(r_trigger));
-    memset(&r_off,       0, sizeof(r_off));
-    memset(&r_mode, 0, sizeof(r_mode));
+void coap_if_cli_bench_tx(uint32_t n)
+{
+    static const txbench_kind_t k_kinds[] = {TXB_SNPRINTF, TXB_RUST};
+    static const char *const k_names[] = {"snprintf", "rust"};
+    if (n == 0) {
+        n = 1;
+    }
+    uint32_t base = txbench_stack(TXB_BASE);
+    for (int k = 0; k < 2; k++) {
+        uint32_t len = bench_encode(k_kinds[k], 4000000000u);
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (uint32_t i = 0; i < n; i++) {
+            (void)bench_encode(k_kinds[k], 4000000000u - i);
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+        uint32_t stack = txbench_stack(k_kinds[k]);
+        otCliOutputFormat("txbench %s: len=%lu cycles/payload=%lu stack=%lu\r\n", k_names[k],
+                          (unsigned long)len, (unsigned long)(cycles / n),
+                          (unsigned long)(stack > base ? stack - base : 0));
+    }
+    otCliOutputFormat("txbench: n=%lu '%.*s'\r\n", (unsigned long)n, (int)s_bench_len,
+                      (const char *)s_bench_out);
+}
 
+// lock OpenThread взят
+static void net_refresh_locked(void)
+{
+    otDeviceRole r = otThreadGetDeviceRole(s_ot);
+    const otIp6Address *ml = otThreadGetMeshLocalEid(s_ot);
 
-    r_state_req.mUriPath = path_state_req;
-    r_state_req.mHandler = on_state_req;
+    taskENTER_CRITICAL(&s_net_lock);
+    s_thread_ready = (r != OT_DEVICE_ROLE_DISABLED && r != OT_DEVICE_ROLE_DETACHED);
+    s_ml_eid_valid = (ml != NULL);
+    if (ml) {
+        s_ml_eid = *ml;
+    }
+    taskEXIT_CRITICAL(&s_net_lock);
+}
 
-    r_state_rsp.mUriPath = path_state_rsp;
-    r_state_rsp.mHandler = on_state_rsp;
+// ---- register ----
 
-    r_trigger.mUriPath = path_trigger;
-    r_trigger.mHandler = on_trigger;
+// ресурсы на каждую зону узла: zone/<id>/<name>, mContext = zone_id
+typedef struct {
+    const char *name;
+    otCoapRequestHandler handler;
+} zone_res_def_t;
 
-    r_off.mUriPath = path_off;
-    r_off.mHandler = on_off;
+static const zone_res_def_t s_zone_res_defs[] = {
+    {"state_req", on_state_req},
+    {"state_rsp", on_state_rsp},
+    {"trigger",   on_trigger},
+    {"off",       on_off},
+    {"mode",      on_mode_set},
+    {"state",     on_state_get},
+};
 
-    r_mode.mUriPath = path_mode;
-    r_mode.mHandler = on_mode_set;
+#define COAP_IF_ZONE_RES_COUNT (sizeof(s_zone_res_defs) / sizeof(s_zone_res_defs[0]))
 
+static otCoapResource s_zone_res[LOGIC_MAX_ZONES][COAP_IF_ZONE_RES_COUNT];
+static char s_zone_paths[LOGIC_MAX_ZONES][COAP_IF_ZONE_RES_COUNT][24];
 
-    otCoapAddResource(s_ot, &r_state_req);
-    otCoapAddResource(s_ot, &r_state_rsp);
-    otCoapAddResource(s_ot, &r_trigger);
-    otCoapAddResource(s_ot, &r_off);
-    otCoapAddResource(s_ot, &r_mode);
+void coap_if_register(otInstance *ot)
+{
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    s_ot = ot;
 
+    otIp6AddressFromString("ff03::1", &s_mcast_all_nodes);
+    otIp6AddressFromString(COAP_ZONE_MCAST_BASE, &s_mcast_zone_base);
+    otCoapStart(s_ot, OT_DEFAULT_COAP_PORT);
+    otCoapSetDefaultHandler(s_ot, on_unmatched, NULL);
+    net_refresh_locked();
+
+    s_zone_count = logic_get_zone_ids(s_zone_ids, LOGIC_MAX_ZONES);
+    uint8_t zone_count = s_zone_count;
+
+    // группы своих зон: подписка и при COAP_ZONE_MCAST 0 — узлы с новой прошивкой шлют туда
+    for (uint8_t i = 0; i < zone_count; i++) {
+        otIp6Address grp;
+        zone_mcast_addr(s_zone_ids[i], &grp);
+        otError e = otIp6SubscribeMulticastAddress(s_ot, &grp);
+        if (e == OT_ERROR_ALREADY) {
+            e = OT_ERROR_NONE;
+        }
+        s_zone_sub_err[i] = e;
+        if (e != OT_ERROR_NONE) {
+            ESP_LOGE(TAG, "subscribe zone=%u mcast -> %d: zone multicast will be missed",
+                     (unsigned)s_zone_ids[i], (int)e);
+        }
+    }
 
-    esp_openthread_lock_release();
+    for (uint8_t i = 0; i < zone_count; i++) {
+        for (size_t r = 0; r < COAP_IF_ZONE_RES_COUNT; r++) {
+            otCoapResource *res = &s_zone_res[i][r];
+            snprintf(s_zone_paths[i][r], sizeof(s_zone_paths[i][r]), "zone/%u/%s",
+                     (unsigned)s_zone_ids[i], s_zone_res_defs[r].name);
+            memset(res, 0, sizeof(*res));
+            res->mUriPath = s_zone_paths[i][r];
+            res->mHandler = s_zone_res_defs[r].handler;
+            res->mContext = (void *)(uintptr_t)s_zone_ids[i];
+            otCoapAddResource(s_ot, res);
+        }
+    }
 
-    ESP_LOGI(TAG, "CoAP: /%s /%s /%s /%s /%s",
-         path_state_req, path_state_rsp, path_trigger, path_off, path_mode);
 
+    esp_openthread_lock_release();
 
-    // ESP_LOGI(TAG, "CoAP: /%s /%s /%s /%s",
-    //          path_state_req, path_state_rsp, path_trigger, path_off);
+    for (uint8_t i = 0; i < zone_count; i++) {
+        ESP_LOGI(TAG, "CoAP: /%s /%s /%s /%s /%s /%s",
+                 s_zone_paths[i][0], s_zone_paths[i][1], s_zone_paths[i][2],
+                 s_zone_paths[i][3], s_zone_paths[i][4], s_zone_paths[i][5]);
+    }
 }
 
 // ---- SEND (multicast) ----
 
-void coap_if_send_state_req(void)
-{
-    if (!s_ot) return;
+// отправка из очереди (outbox ниже), lock OpenThread уже взят
 
+static void tx_state_req(uint8_t zone_id)
+{
     otIp6Address leader_addr;
     if (otThreadGetLeaderRloc(s_ot, &leader_addr) == OT_ERROR_NONE) {
-        otMessage *ucast = build_state_req_msg();
+        otMessage *ucast = build_state_req_msg(zone_id);
         if (ucast) {
             otMessageInfo info;
             memset(&info, 0, sizeof(info));
@@ -578,44 +993,138 @@ void coap_if_send_state_req(void)
         }
     }
 
-    otMessage *mcast = build_state_req_msg();
+    otMessage *mcast = build_state_req_msg(zone_id);
     if (mcast) {
-        send_mcast(mcast);
+        send_mcast(mcast, zone_id, MC_STATE_REQ);
     }
 }
 
-void coap_if_send_state_rsp(uint32_t epoch,
-                            const otIp6Address *owner,
-                            uint32_t remaining_ms,
-                            bool active)
+static void tx_state_rsp(uint8_t zone_id,
+                         uint32_t epoch,
+                         const otIp6Address *owner,
+                         uint32_t remaining_ms,
+                         bool active)
 {
-    if (!s_ot) return;
-
     otMessage *m = new_post_msg();
     if (!m) return;
 
     char zid[8];
-    zone_id_str(zid, sizeof(zid));
+    zone_id_str(zone_id, zid, sizeof(zid));
 
     append_uri(m, "zone");
     append_uri(m, zid);
     append_uri(m, "state_rsp");
+    append_state_rsp_payload(m, epoch, owner, remaining_ms, active);
 
-    char owner_str[OT_IP6_ADDRESS_STRING_SIZE];
-    otIp6AddressToString(owner, owner_str, sizeof(owner_str));
+    send_mcast(m, zone_id, MC_STATE_RSP);
+}
 
-    char pl[200];
-    // e=..;a=..;r=..;o=....
-    snprintf(pl, sizeof(pl), "e=%lu;a=%u;r=%lu;o=%s",
-             (unsigned long)epoch,
-             active ? 1u : 0u,
-             (unsigned long)remaining_ms,
-             owner_str);
+// ctx: слот зоны << 16 | индекс наблюдателя << 8 | gen
+static void on_notify_ack(void *ctx, otMessage *msg, const otMessageInfo *info, otError result)
+{
+    (void)msg;
+    (void)info;
+    uintptr_t c = (uintptr_t)ctx;
+    coap_obs_t *o = &s_obs[(c >> 16) & 0xFF][(c >> 8) & 0xFF];
+    // OT_ERROR_ABORT — RST от наблюдателя, OT_ERROR_RESPONSE_TIMEOUT — ретрансмиссии без ACK
+    if (result != OT_ERROR_NONE && o->used && o->gen == (uint8_t)c) {
+        ESP_LOGI(TAG, "observer dropped: %s (err=%d)",
+                 result == OT_ERROR_ABORT ? "RST" : "no ACK", (int)result);
+        obs_drop(o);
+    }
+}
 
-    otCoapMessageSetPayloadMarker(m);
-    otMessageAppend(m, pl, (uint16_t)strlen(pl));
+// из outbox, lock OpenThread взят
+static void tx_notify(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                      uint32_t rem_ms, bool active, bool final)
+{
+    int slot = zone_slot(zone_id);
+    if (slot < 0) return;
+
+    s_obs_seq[slot] = (s_obs_seq[slot] + 1) & 0xFFFFFF;
+    for (int i = 0; i < COAP_OBS_MAX; i++) {
+        coap_obs_t *o = &s_obs[slot][i];
+        if (!o->used) {
+            continue;
+        }
+        otMessage *m = otCoapNewMessage(s_ot, NULL);
+        if (!m) {
+            // нет буферов: обычное уведомление уйдёт со следующим, а после final
+            // наблюдатели не должны остаться на узле, который уже не источник
+            if (!final) {
+                break;
+            }
+            obs_drop(o);
+            continue;
+        }
+        // свой счётчик у каждого наблюдателя: CON достаётся всем, мёртвый снимется
+        bool con = !final && (++o->sent % COAP_OBS_CON_EVERY) == 0;
+        otCoapMessageInit(m, con ? OT_COAP_TYPE_CONFIRMABLE : OT_COAP_TYPE_NON_CONFIRMABLE,
+                          OT_COAP_CODE_CONTENT);
+        otCoapMessageSetToken(m, o->token, o->token_len);
+        if (!final) {
+            (void)otCoapMessageAppendObserveOption(m, s_obs_seq[slot]);
+        }
+        append_state_rsp_payload(m, epoch, owner, rem_ms, active);
+
+        otMessageInfo info;
+        memset(&info, 0, sizeof(info));
+        info.mPeerAddr = o->addr;
+        info.mPeerPort = o->port;
+        uintptr_t ctx = ((uintptr_t)slot << 16) | ((uintptr_t)i << 8) | o->gen;
+        otError e = otCoapSendRequest(s_ot, m, &info, con ? on_notify_ack : NULL,
+                                      con ? (void *)ctx : NULL);
+        if (e != OT_ERROR_NONE) {
+            ESP_LOGW(TAG, "notify zone=%u err=%d", (unsigned)zone_id, (int)e);
+            otMessageFree(m);
+        }
+        if (final) {
+            obs_drop(o);
+        }
+    }
+}
 
-    send_mcast(m);
+static void on_state_get_rsp(void *ctx, otMessage *msg, const otMessageInfo *info, otError result)
+{
+    uint8_t zone_id = ctx_zone_id(ctx);
+    if (result != OT_ERROR_NONE || !msg) {
+        ESP_LOGW(TAG, "GET state zone=%u failed err=%d", (unsigned)zone_id, (int)result);
+        return;
+    }
+    if (otCoapMessageGetCode(msg) != OT_COAP_CODE_CONTENT) {
+        return;
+    }
+    logic_rx_stamp();
+    rust_parsed_t parsed = {0};
+    if (parse_payload(msg, COAP_BIN_STATE_RSP, &parsed)) {
+        (void)logic_post_parsed(LOGIC_PARSED_STATE_RSP, zone_id, &parsed, NULL, false);
+    }
+}
+
+// из outbox, lock OpenThread взят
+static void tx_state_get(uint8_t zone_id, const otIp6Address *dst)
+{
+    char zid[8];
+    zone_id_str(zone_id, zid, sizeof(zid));
+
+    otMessage *m = otCoapNewMessage(s_ot, NULL);
+    if (m) {
+        otCoapMessageInit(m, OT_COAP_TYPE_CONFIRMABLE, OT_COAP_CODE_GET);
+        otCoapMessageGenerateToken(m, 4);
+        append_uri(m, "zone");
+        append_uri(m, zid);
+        append_uri(m, "state");
+
+        otMessageInfo info;
+        memset(&info, 0, sizeof(info));
+        info.mPeerAddr = *dst;
+        info.mPeerPort = OT_DEFAULT_COAP_PORT;
+        otError e = otCoapSendRequest(s_ot, m, &info, on_state_get_rsp, (void *)(uintptr_t)zone_id);
+        if (e != OT_ERROR_NONE) {
+            ESP_LOGW(TAG, "GET state zone=%u err=%d", (unsigned)zone_id, (int)e);
+            otMessageFree(m);
+        }
+    }
 }
 
 // void coap_if_send_trigger(uint32_t epoch, uint32_t hold_ms)
@@ -642,76 +1151,308 @@ void coap_if_send_state_rsp(uint32_t epoch,
 //     send_mcast(m);
 // }
 
-void coap_if_send_trigger(uint32_t epoch, uint32_t rem_ms)
+static void tx_trigger(uint8_t zone_id, uint32_t epoch, uint32_t rem_ms)
 {
-    if (!coap_if_thread_ready()) {
-        ESP_LOGW(TAG, "TX trigger skipped: thread not ready");
-        return;
-    }
-
-    if (!s_ot) return;
-
     otMessage *m = new_post_msg();
     if (!m) return;
 
     char zid[8];
-    zone_id_str(zid, sizeof(zid));
+    zone_id_str(zone_id, zid, sizeof(zid));
 
     append_uri(m, "zone");
     append_uri(m, zid);
     append_uri(m, "trigger");
 
-    char pl[80];
-    // новый формат
-    snprintf(pl, sizeof(pl), "epoch=%lu&rem_ms=%lu",
-             (unsigned long)epoch, (unsigned long)rem_ms);
+#if COAP_TX_BINARY
+    coap_bin_msg_t bm = {.type = COAP_BIN_TRIGGER, .epoch = epoch, .rem_ms = rem_ms};
+    append_payload_bin(m, &bm);
+#else
+    rust_parsed_t p = {.has_epoch = 1, .epoch = epoch, .has_rem_ms = 1, .rem_ms = rem_ms};
+    append_payload_text(m, &p);
+#endif
 
-    otCoapMessageSetPayloadMarker(m);
-    otMessageAppend(m, pl, (uint16_t)strlen(pl));
-
-    send_mcast(m);
+    send_mcast(m, zone_id, MC_TRIGGER);
 }
 
 
-void coap_if_send_off(uint32_t epoch)
+static void tx_off(uint8_t zone_id, uint32_t epoch)
 {
-    if (!s_ot) return;
-
     otMessage *m = new_post_msg();
     if (!m) return;
 
     char zid[8];
-    zone_id_str(zid, sizeof(zid));
+    zone_id_str(zone_id, zid, sizeof(zid));
 
     append_uri(m, "zone");
     append_uri(m, zid);
     append_uri(m, "off");
 
-    char pl[48];
-    snprintf(pl, sizeof(pl), "e=%lu", (unsigned long)epoch);
+#if COAP_TX_BINARY
+    coap_bin_msg_t bm = {.type = COAP_BIN_OFF, .epoch = epoch};
+    append_payload_bin(m, &bm);
+#else
+    rust_parsed_t p = {.has_epoch = 1, .epoch = epoch};
+    append_payload_text(m, &p);
+#endif
 
-    otCoapMessageSetPayloadMarker(m);
-    otMessageAppend(m, pl, (uint16_t)strlen(pl));
+    send_mcast(m, zone_id, MC_OFF);
+}
 
-    send_mcast(m);
+// ---- outbox: logic task -> OpenThread ----
+// coap_if_send_*, coap_if_get_state и coap_if_notify_state только ставят сообщение в
+// очередь (без lock OpenThread); отправляет coap_if_outbox_flush() пачкой под одним lock
+// в порядке постановки, а без сети — при attach из coap_if_state_changed(). Сообщение зоны
+// заменяет устаревшее того же рода: новый trigger — прежний trigger и off старого epoch,
+// off — trigger своего и старых epoch'ов, state_rsp, GET state и уведомление Observe —
+// прежнее такое же. Trigger живёт, пока не истекло его удержание (rem_ms при отправке
+// уменьшается на время в очереди), остальные — COAP_OUTBOX_TTL_MS.
+
+typedef enum {
+    OB_STATE_REQ,
+    OB_STATE_RSP,
+    OB_TRIGGER,
+    OB_OFF,
+    OB_STATE_GET,   // owner — адрес, кого спросить
+    OB_NOTIFY,
+} ob_kind_t;
+
+typedef struct {
+    bool used;                // false — вытеснено, слот пропускается
+    uint8_t kind;
+    uint8_t zone_id;
+    bool active;
+    bool final;               // OB_NOTIFY
+    uint32_t epoch;
+    uint32_t rem_ms;
+    otIp6Address owner;
+    int64_t enq_us;
+    int64_t expire_us;
+} ob_item_t;
+
+typedef struct {
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t superseded;   // заменено более новым сообщением зоны
+    uint32_t expired;      // не дождалось сети
+    uint32_t dropped;      // вытеснено при полной очереди
+} ob_stats_t;
+
+static ob_item_t s_outbox[COAP_OUTBOX_SLOTS];
+static uint8_t s_ob_head;
+static uint8_t s_ob_count;
+static ob_stats_t s_ob_stats;
+static portMUX_TYPE s_ob_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void ob_supersede(const ob_item_t *n)
+{
+    for (uint8_t i = 0; i < s_ob_count; i++) {
+        ob_item_t *o = &s_outbox[(s_ob_head + i) % COAP_OUTBOX_SLOTS];
+        if (!o->used || o->zone_id != n->zone_id) {
+            continue;
+        }
+        bool stale = false;
+        switch ((ob_kind_t)n->kind) {
+            case OB_TRIGGER:
+                stale = o->kind == OB_TRIGGER || (o->kind == OB_OFF && o->epoch < n->epoch);
+                break;
+            case OB_OFF:
+                stale = o->kind == OB_TRIGGER && o->epoch <= n->epoch;
+                break;
+            case OB_STATE_RSP:
+            case OB_STATE_REQ:
+            case OB_STATE_GET:
+            case OB_NOTIFY:
+                stale = o->kind == n->kind;
+                break;
+        }
+        if (stale) {
+            o->used = false;
+            s_ob_stats.superseded++;
+        }
+    }
 }
 
-bool coap_if_get_my_meshlocal_eid(otIp6Address *out)
+static void ob_push(ob_item_t *n)
 {
-    if (!s_ot || !out) return false;
-    const otNetifAddress *a = otIp6GetUnicastAddresses(s_ot);
-    while (a) {
-        // берём первый mesh-local (обычно начинается с fd..)
-        *out = a->mAddress;
-        return true;
+    n->used = true;
+    n->enq_us = esp_timer_get_time();
+    if (!n->expire_us) {
+        n->expire_us = n->enq_us + (int64_t)COAP_OUTBOX_TTL_MS * 1000;
     }
-    return false;
+
+    taskENTER_CRITICAL(&s_ob_lock);
+    ob_supersede(n);
+    if (s_ob_count == COAP_OUTBOX_SLOTS) {
+        // полна: теряем самое старое
+        if (s_outbox[s_ob_head].used) {
+            s_ob_stats.dropped++;
+        }
+        s_ob_head = (uint8_t)((s_ob_head + 1) % COAP_OUTBOX_SLOTS);
+        s_ob_count--;
+    }
+    s_outbox[(s_ob_head + s_ob_count) % COAP_OUTBOX_SLOTS] = *n;
+    s_ob_count++;
+    s_ob_stats.queued++;
+    taskEXIT_CRITICAL(&s_ob_lock);
+}
+
+// снять первое живое сообщение; без сети (ready=false) — только выбросить просроченные
+static bool ob_pop(int64_t now, bool ready, ob_item_t *out)
+{
+    bool got = false;
+    taskENTER_CRITICAL(&s_ob_lock);
+    for (uint8_t i = 0; i < s_ob_count; i++) {
+        ob_item_t *o = &s_outbox[(s_ob_head + i) % COAP_OUTBOX_SLOTS];
+        if (o->used && now >= o->expire_us) {
+            o->used = false;
+            s_ob_stats.expired++;
+        }
+        if (o->used && ready && !got) {
+            *out = *o;
+            o->used = false;
+            got = true;
+        }
+    }
+    // вытесненные/снятые слоты по краям очереди освобождаем
+    while (s_ob_count && !s_outbox[s_ob_head].used) {
+        s_ob_head = (uint8_t)((s_ob_head + 1) % COAP_OUTBOX_SLOTS);
+        s_ob_count--;
+    }
+    while (s_ob_count && !s_outbox[(s_ob_head + s_ob_count - 1) % COAP_OUTBOX_SLOTS].used) {
+        s_ob_count--;
+    }
+    taskEXIT_CRITICAL(&s_ob_lock);
+    return got;
+}
+
+// lock OpenThread взят
+static void outbox_drain_locked(void)
+{
+    int64_t now = esp_timer_get_time();
+    bool ready = coap_if_thread_ready();
+    ob_item_t it;
+    while (ob_pop(now, ready, &it)) {
+        uint32_t queued_ms = (uint32_t)((now - it.enq_us) / 1000);
+        uint32_t rem_ms = it.rem_ms > queued_ms ? it.rem_ms - queued_ms : 0;
+        switch ((ob_kind_t)it.kind) {
+            case OB_STATE_REQ:
+                tx_state_req(it.zone_id);
+                break;
+            case OB_STATE_RSP:
+                tx_state_rsp(it.zone_id, it.epoch, &it.owner, it.active ? rem_ms : 0, it.active);
+                break;
+            case OB_TRIGGER:
+                tx_trigger(it.zone_id, it.epoch, rem_ms);
+                break;
+            case OB_OFF:
+                tx_off(it.zone_id, it.epoch);
+                break;
+            case OB_STATE_GET:
+                tx_state_get(it.zone_id, &it.owner);
+                break;
+            case OB_NOTIFY:
+                tx_notify(it.zone_id, it.epoch, &it.owner, it.active ? rem_ms : 0, it.active,
+                          it.final);
+                break;
+        }
+        s_ob_stats.sent++;
+    }
+}
+
+void coap_if_outbox_flush(void)
+{
+    if (!s_ot || !s_ob_count) return;
+
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    outbox_drain_locked();
+    esp_openthread_lock_release();
+}
+
+void coap_if_cli_print_outbox(void)
+{
+    taskENTER_CRITICAL(&s_ob_lock);
+    ob_stats_t st = s_ob_stats;
+    uint8_t depth = s_ob_count;
+    taskEXIT_CRITICAL(&s_ob_lock);
+
+    otCliOutputFormat("outbox: depth=%u queued=%lu sent=%lu superseded=%lu expired=%lu dropped=%lu\r\n",
+                      (unsigned)depth, (unsigned long)st.queued, (unsigned long)st.sent,
+                      (unsigned long)st.superseded, (unsigned long)st.expired,
+                      (unsigned long)st.dropped);
+}
+
+void coap_if_state_changed(otChangedFlags flags)
+{
+    if (!s_ot || !(flags & (OT_CHANGED_THREAD_ROLE | OT_CHANGED_THREAD_ML_ADDR))) {
+        return;
+    }
+    bool was_ready = s_thread_ready;
+    net_refresh_locked();
+    if (s_thread_ready == was_ready) {
+        return;
+    }
+    ESP_LOGI(TAG, "thread %s", s_thread_ready ? "attached" : "detached");
+    if (s_thread_ready) {
+        outbox_drain_locked();   // контекст OpenThread: lock уже наш
+        logic_post_thread_up();
+    } else {
+        logic_post_thread_down();
+    }
+}
+
+void coap_if_send_state_req(uint8_t zone_id)
+{
+    ob_item_t n = {.kind = OB_STATE_REQ, .zone_id = zone_id};
+    ob_push(&n);
+}
+
+void coap_if_send_state_rsp(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                            uint32_t remaining_ms, bool active)
+{
+    ob_item_t n = {.kind = OB_STATE_RSP, .zone_id = zone_id, .epoch = epoch,
+                   .owner = *owner, .rem_ms = remaining_ms, .active = active};
+    ob_push(&n);
+}
+
+void coap_if_send_trigger(uint8_t zone_id, uint32_t epoch, uint32_t rem_ms)
+{
+    ob_item_t n = {.kind = OB_TRIGGER, .zone_id = zone_id, .epoch = epoch, .rem_ms = rem_ms,
+                   .expire_us = esp_timer_get_time() + (int64_t)rem_ms * 1000};
+    ob_push(&n);
+}
+
+void coap_if_send_off(uint8_t zone_id, uint32_t epoch)
+{
+    ob_item_t n = {.kind = OB_OFF, .zone_id = zone_id, .epoch = epoch};
+    ob_push(&n);
+}
+
+void coap_if_get_state(uint8_t zone_id, const otIp6Address *dst)
+{
+    ob_item_t n = {.kind = OB_STATE_GET, .zone_id = zone_id, .owner = *dst};
+    ob_push(&n);
+}
+
+void coap_if_notify_state(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                          uint32_t rem_ms, bool active, bool final)
+{
+    ob_item_t n = {.kind = OB_NOTIFY, .zone_id = zone_id, .epoch = epoch, .owner = *owner,
+                   .rem_ms = rem_ms, .active = active, .final = final};
+    ob_push(&n);
+}
+
+bool coap_if_get_my_meshlocal_eid(otIp6Address *out)
+{
+    if (!out) return false;
+    taskENTER_CRITICAL(&s_net_lock);
+    bool valid = s_ml_eid_valid;
+    *out = s_ml_eid;
+    taskEXIT_CRITICAL(&s_net_lock);
+    return valid;
 }
 
 
 bool coap_if_thread_ready(void)
 {
-    if (!s_ot) return false;
-    otDeviceRole r = otThreadGetDeviceRole(s_ot);
-    return (r != OT_DEVICE_ROLE_DISABLED && r != OT_DEVICE_ROLE_DETACHED);
+    return s_thread_ready;
 }
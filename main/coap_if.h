@@ -14,23 +14,62 @@ extern "C" {
 
 void coap_if_register(otInstance *ot);
 
-// multicast SEND
-void coap_if_send_state_req(void);
-void coap_if_send_state_rsp(uint32_t epoch,
+// send_state_req/state_rsp/trigger/off ниже только ставят сообщение в очередь (из задачи
+// логики, без lock OpenThread). Отправка — coap_if_outbox_flush(): всё накопленное под
+// одним esp_openthread_lock; без сети сообщения ждут attach (coap_if_state_changed)
+void coap_if_outbox_flush(void);
+// logic: глубина очереди и счётчики (отправлено, заменено, просрочено, потеряно)
+void coap_if_cli_print_outbox(void);
+
+// multicast SEND (zone_id — зона из таблицы logic_get_zone_ids())
+void coap_if_send_state_req(uint8_t zone_id);
+void coap_if_send_state_rsp(uint8_t zone_id,
+                            uint32_t epoch,
                             const otIp6Address *owner,
                             uint32_t remaining_ms,
                             bool active);
 
 // void coap_if_send_trigger(uint32_t epoch, uint32_t hold_ms);
-void coap_if_send_trigger(uint32_t epoch, uint32_t rem_ms);
+void coap_if_send_trigger(uint8_t zone_id, uint32_t epoch, uint32_t rem_ms);
 
-void coap_if_send_off(uint32_t epoch);
+void coap_if_send_off(uint8_t zone_id, uint32_t epoch);
 
-// утилита: получить свой Mesh-Local EID
+// свой Mesh-Local EID (otThreadGetMeshLocalEid, кэш); false — ещё не известен
 bool coap_if_get_my_meshlocal_eid(otIp6Address *out);
 
 bool coap_if_thread_ready(void);
 
+// изменение состояния OpenThread (ot_app.c, lock взят): обновить кэш роли и ML-EID
+// (их читают coap_if_thread_ready / coap_if_get_my_meshlocal_eid), при attach — отправить
+// очередь и logic_post_thread_up(), при detach — logic_post_thread_down()
+void coap_if_state_changed(otChangedFlags flags);
+
+// Observe zone/<id>/state: уведомить наблюдателей зоны (через outbox); final — узел больше
+// не источник состояния зоны (epoch перехватил другой owner): последнее уведомление без
+// Observe, наблюдатели снимаются и по owner из payload переходят к новому
+void coap_if_notify_state(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                          uint32_t rem_ms, bool active, bool final);
+
+// unicast CON GET zone/<id>/state к известному owner (strict restore, через outbox); ответ
+// приходит в логику как state_rsp, повторы — CoAP-ретрансмиссии, а не таймер логики.
+// Первая из них — через 2-3 с (ACK_TIMEOUT OpenThread), поэтому strict restore с GET ждёт
+// RESTORE_GET_WAIT_MS, а не RESTORE_WAIT_MS (logic_fsm.c)
+void coap_if_get_state(uint8_t zone_id, const otIp6Address *dst);
+
+// RX узла на уровне CoAP: foreign — запросы без своего ресурса (сообщения чужих зон,
+// дошедшие до CoAP), mc_group / mc_all — multicast своих зон через группу зоны / ff03::1
+void coap_if_get_rx_stats(uint32_t *foreign, uint32_t *mc_group, uint32_t *mc_all);
+
+// multicast по типам (trigger, off, state_req, state_rsp): hop limit отправки (0 = по
+// умолчанию стека) до перезагрузки; false — неизвестный тип
+bool coap_if_set_mcast_hops(const char *type, uint8_t hops);
+// logic mcast: hop limit, tx/rx, дубли и наименьший остаток hop limit при приёме по типам,
+// подписка на группы зон
+void coap_if_cli_print_mcast(void);
+// logic txbench [n]: текстовый state_rsp через snprintf и через rust_encode_payload —
+// длина, циклы на payload (n повторов) и стек
+void coap_if_cli_bench_tx(uint32_t n);
+
 
 void coap_if_send_mode_global(light_mode_t mode);
 void coap_if_send_mode_zone(uint8_t zone_id, light_mode_t mode);
@@ -20,6 +20,80 @@
 // ========== ЛОГИКА ==========
 #define ZONE_ID              1
 #define AUTO_HOLD_MS         300000    // 10 минут удержания при AUTO
+// повтор trigger от owner'а, пока человек стоит у сенсора (LOCAL_TRIGGER раз в 800 мс):
+// удержание продлевается молча, trigger уходит, только когда у зоны от последнего
+// разосланного осталось меньше TRIGGER_REFRESH_PCT % auto_hold_ms (и при новом epoch).
+// Цена: после ухода человека узлы зоны гаснут раньше owner'а — не позже чем через
+// (100 - TRIGGER_REFRESH_PCT) % удержания. 100 = trigger на каждое срабатывание.
+#define TRIGGER_REFRESH_PCT  50
+
+// ========== ЗОНЫ (один узел -> несколько зон) ==========
+#define LOGIC_MAX_ZONES      4     // ёмкость таблицы зон на узле
+// основная зона = cfg zone_id на PIN_RELAY; дополнительные — по порядку id/пин реле
+#define EXTRA_ZONE_COUNT     0
+#define EXTRA_ZONE_IDS       {2, 3, 4}
+#define EXTRA_ZONE_RELAY_PINS {10, 11, 18}
+
+// счётчики покрытия FSM (пары состояние/событие и фактические переходы), хост: 1
+#ifndef LOGIC_FSM_COVERAGE
+#define LOGIC_FSM_COVERAGE   0
+#endif
+
+// кольцо трассировки событий логики (logic trace), 16 байт на запись, степень двойки
+#define LOGIC_TRACE_LEN      128
+
+// ========== CoAP ==========
+// payload зоны: 1 = двоичный (coap_bin.h, Content-Format 65001), 0 = прежний текст.
+// Приём — оба формата всегда. Старые прошивки Content-Format не смотрят и разбирают
+// двоичный payload как текст, поэтому 1 — только когда обновлена вся сеть (после OTA)
+#define COAP_TX_BINARY       0
+// окно otMessageRead при потоковом разборе текстового payload (стек RX-обработчика)
+#define COAP_RX_WINDOW       16
+// multicast зоны: 1 = группа COAP_ZONE_MCAST_BASE + zone_id (последний байт), на неё
+// подписаны только узлы зоны — остальные отбрасывают сообщение в IPv6, до CoAP;
+// 0 = ff03::1. Приём на ff03::1 и подписка на группы своих зон — всегда. Старые прошивки
+// слушают только ff03::1, поэтому 1 — только когда обновлена вся сеть (после OTA)
+#define COAP_ZONE_MCAST      0
+#define COAP_ZONE_MCAST_BASE "ff03::5a7a:0"
+// hop limit multicast по типу сообщения (0 = по умолчанию стека, 64): MPL пересылает копию,
+// пока hop limit не кончится, так что это радиус рассылки в хопах. Меняется в работе
+// командой `logic mcast <type> <hops>` (до перезагрузки). Trickle-параметры MPL
+// в OpenThread — только при сборке (OPENTHREAD_CONFIG_MPL_*), API для них нет.
+#define COAP_MCAST_HOPS_TRIGGER   0
+#define COAP_MCAST_HOPS_OFF       0
+#define COAP_MCAST_HOPS_STATE_REQ 0
+#define COAP_MCAST_HOPS_STATE_RSP 0
+// недавние (отправитель, CoAP Message ID) multicast: повтор считается дублем и отбрасывается
+#define COAP_MCAST_DUP_SLOTS      16
+// очередь исходящих multicast зоны (logic -> OpenThread), ждёт attach не дольше TTL
+// (trigger — пока не истекло его удержание)
+#define COAP_OUTBOX_SLOTS         16
+#define COAP_OUTBOX_TTL_MS        30000
+// ответ на state_req: multicast через случайную задержку в окне
+// STATE_RSP_SLOT_MS * (оценка числа узлов зоны), ограниченном MIN..MAX (MAX < 1200 мс
+// ожидания strict restore); услышали чужой state_rsp с epoch >= своего — свой не шлём
+#define STATE_RSP_SLOT_MS        15
+#define STATE_RSP_WINDOW_MIN_MS  100
+#define STATE_RSP_WINDOW_MAX_MS  1000
+// Observe (RFC 7641) на zone/<id>/state: наблюдателей держит узел, выдавший текущий epoch
+// зоны; уведомление — при смене epoch/active или сдвиге срока больше чем на
+// COAP_OBS_DEADLINE_STEP_MS (продления от сенсора каждые ~1 с не рассылаются)
+#define COAP_OBS_MAX              4       // наблюдателей на зону
+#define COAP_OBS_CON_EVERY        8       // каждое N-е уведомление CON: нет ACK — наблюдатель снят
+#define COAP_OBS_DEADLINE_STEP_MS 10000
+// состояние зоны в Thread Network Data (netdata_if.h): owner публикует запись
+// (zone, epoch, active, rem_ms) как service entry, узел в PendingRestore берёт её из своей
+// копии Network Data сразу после attach. Каждое изменение записи рассылается лидером всей
+// сети, поэтому: не чаще NETDATA_MIN_INTERVAL_MS на зону, не больше NETDATA_MAX_RECORDS
+// записей с узла, в записи — только смена epoch/active (продление удержания не публикуется).
+// Network Data — не больше 254 байт на всю сеть, там же префиксы и маршруты; запись зоны
+// (service TLV + server TLV со state_rsp) ~25-30 байт. Новая запись не публикуется, если
+// Network Data с ней вырастет больше NETDATA_BUDGET_BYTES (повтор — через интервал)
+#define NETDATA_ENTERPRISE_NUMBER 32473   // PEN из RFC 5612 (для документации) — замените своим
+#define NETDATA_SVC_TAG           0x5a    // service data = {tag, zone_id}
+#define NETDATA_MIN_INTERVAL_MS   15000
+#define NETDATA_MAX_RECORDS       2
+#define NETDATA_BUDGET_BYTES      160
 
 // ========== DATASET Thread (дефолты) ==========
 #define OT_CHANNEL           15
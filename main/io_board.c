@@ -4,12 +4,33 @@
 #include "driver/gpio.h"
 #include "esp_err.h"
 
-static bool s_relay_on = false;
+#define IO_RELAY_CH_COUNT (1 + EXTRA_ZONE_COUNT)
+
+#if EXTRA_ZONE_COUNT
+static const uint8_t s_extra_relay_pins[] = EXTRA_ZONE_RELAY_PINS;
+_Static_assert(sizeof(s_extra_relay_pins) >= EXTRA_ZONE_COUNT, "EXTRA_ZONE_RELAY_PINS too short");
+#endif
+
+static bool s_relay_on[IO_RELAY_CH_COUNT];
+
+static int relay_pin(uint8_t ch)
+{
+#if EXTRA_ZONE_COUNT
+    if (ch > 0) {
+        return s_extra_relay_pins[ch - 1];
+    }
+#endif
+    return PIN_RELAY;
+}
 
 esp_err_t io_board_init(void)
 {
+    uint64_t relay_mask = 0;
+    for (uint8_t ch = 0; ch < IO_RELAY_CH_COUNT; ch++) {
+        relay_mask |= (1ULL << relay_pin(ch));
+    }
     gpio_config_t out = {
-        .pin_bit_mask = (1ULL << PIN_RELAY),
+        .pin_bit_mask = relay_mask,
         .mode = GPIO_MODE_OUTPUT,
     };
     esp_err_t err = gpio_config(&out);
@@ -32,15 +53,28 @@ esp_err_t io_board_init(void)
     return ESP_OK;
 }
 
+void io_board_set_relay_ch(uint8_t ch, bool on)
+{
+    if (ch >= IO_RELAY_CH_COUNT) {
+        return;
+    }
+    s_relay_on[ch] = on;
+    gpio_set_level(relay_pin(ch), on ? 1 : 0);
+}
+
+bool io_board_get_relay_ch(uint8_t ch)
+{
+    return (ch < IO_RELAY_CH_COUNT) ? s_relay_on[ch] : false;
+}
+
 void io_board_set_relay(bool on)
 {
-    s_relay_on = on;
-    gpio_set_level(PIN_RELAY, on ? 1 : 0);
+    io_board_set_relay_ch(0, on);
 }
 
 bool io_board_get_relay(void)
 {
-    return s_relay_on;
+    return io_board_get_relay_ch(0);
 }
 
 light_mode_t io_board_read_mode_switch(void)
@@ -18,6 +18,10 @@ esp_err_t io_board_init(void);
 void io_board_set_relay(bool on);
 bool io_board_get_relay(void);
 
+// реле зоны: канал 0 = PIN_RELAY, 1.. = EXTRA_ZONE_RELAY_PINS
+void io_board_set_relay_ch(uint8_t ch, bool on);
+bool io_board_get_relay_ch(uint8_t ch);
+
 light_mode_t io_board_read_mode_switch(void);
 
 #ifdef __cplusplus
@@ -1,4 +1,8 @@
 #include "logic.h"
+#include "logic_fsm.h"
+#include "logic_mailbox.h"
+#include "logic_trace.h"
+#include "logic_lat.h"
 #include "config.h"
 #include "io_board.h"
 #include "rgb_led.h"
@@ -11,281 +15,261 @@
 #include "freertos/task.h"
 #include "esp_timer.h"
 #include "esp_log.h"
-#include "nvs.h"
 
 #include <string.h>
 
 #include "esp_system.h"   // esp_reset_reason()
 
-#include "freertos/queue.h"
 #include "openthread/cli.h"
 
 
 static const char *TAG = "logic";
-typedef enum {
-    FSM_AUTO_IDLE = 0,
-    FSM_AUTO_ACTIVE,
-    FSM_MANUAL_ON,
-    FSM_MANUAL_OFF,
-    FSM_PENDING_RESTORE,
-} fsm_state_t;
 
-typedef struct {
-    zone_state_t zone;
-    fsm_state_t fsm;
-
-    bool global_mode_valid;
-    light_mode_t global_mode;
-
-    bool zone_mode_valid;
-    uint8_t zone_mode_zone;
-    light_mode_t zone_mode;
-
-    bool node_mode_valid;
-    light_mode_t node_mode;
-
-    int64_t restore_deadline_us;
-    int64_t next_state_req_us;
-    int64_t last_local_trigger_us;
-    bool nvs_dirty;
-    uint64_t nvs_next_flush_us;
-    bool last_trigger_valid;
-    uint32_t last_trigger_epoch;
-    otIp6Address last_trigger_addr;
-    uint32_t last_trigger_rem_ms;
-    int64_t last_trigger_time_us;
-    bool last_state_rsp_valid;
-    uint32_t last_state_rsp_epoch;
-    otIp6Address last_state_rsp_addr;
-    uint32_t last_state_rsp_rem_ms;
-    int64_t last_state_rsp_time_us;
-} logic_state_t;
+// input task: период опроса TFmini/тумблера (события идут в очередь логики); прежний
+// цикл logic_task опрашивал их раз в 50 мс, 100 мс — вдвое меньше пробуждений input task,
+// задержка срабатывания по датчику до 100 мс (против LOCAL_TRIGGER_MIN_INTERVAL_US не видна)
+#define LOGIC_SENSOR_SAMPLE_MS 100
+// верхняя граница сна logic_task при наличии дедлайна
+#define LOGIC_MAX_WAIT_MS (60 * 60 * 1000)
 
 static logic_state_t s_state;
 
+// кольцо трассировки шагов FSM (пишет logic_task, читает CLI `logic trace`)
+static logic_trace_t s_trace;
 
+_Static_assert(1 + EXTRA_ZONE_COUNT <= LOGIC_MAX_ZONES, "EXTRA_ZONE_COUNT exceeds LOGIC_MAX_ZONES");
 
+// события CoAP / input task -> logic_task (полосы HIGH/NORMAL, см. logic_mailbox.h)
+static logic_mailbox_t s_mb;
+static portMUX_TYPE s_mb_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_logic_task;
 
-typedef enum {
-    EVT_STATE_RSP,
-    EVT_TRIGGER_RX,
-    EVT_OFF_RX,
-
-    EVT_MODE_SET_GLOBAL,
-    EVT_MODE_SET_ZONE,
-    EVT_MODE_SET_NODE,
-    EVT_MODE_CLR_GLOBAL,
-    EVT_MODE_CLR_ZONE,
-    EVT_MODE_CLR_NODE,
-    EVT_LOCAL_MODE_SET,
-    EVT_LOCAL_TRIGGER,
-    EVT_TICK,
-    EVT_ENTER_PENDING_RESTORE,
-    EVT_COLD_BOOT,
+// гистограммы задержек (logic lat): RX_ENQ пишет задача CoAP, остальные — logic_task
+static logic_lat_hist_t s_lat[LOGIC_LAT_STAGE_COUNT];
+static portMUX_TYPE s_lat_lock = portMUX_INITIALIZER_UNLOCKED;
+// отметка приёма текущего обработчика CoAP (logic_rx_stamp), забирает первый post
+static int64_t s_rx_us;
+static TaskHandle_t s_rx_task;
+// приём события, сменившего состояние зоны, до переключения её реле (RX_RELAY)
+static int64_t s_relay_rx_us[LOGIC_MAX_ZONES];
 
-} logic_evt_type_t;
+static void lat_note(logic_lat_stage_t stage, int64_t us)
+{
+    taskENTER_CRITICAL(&s_lat_lock);
+    logic_lat_record(&s_lat[stage], us);
+    taskEXIT_CRITICAL(&s_lat_lock);
+}
 
-typedef struct {
-    logic_evt_type_t type;
-    uint32_t epoch;
-    otIp6Address addr;
-    uint32_t u32;
-    bool b;
-} logic_evt_t;
+// события, которые приходят из обработчиков CoAP
+static bool is_rx_event(logic_evt_type_t type)
+{
+    switch (type) {
+        case EVT_STATE_RSP:
+        case EVT_TRIGGER_RX:
+        case EVT_OFF_RX:
+        case EVT_MODE_SET_GLOBAL:
+        case EVT_MODE_SET_ZONE:
+        case EVT_MODE_SET_NODE:
+        case EVT_MODE_CLR_GLOBAL:
+        case EVT_MODE_CLR_ZONE:
+        case EVT_MODE_CLR_NODE:
+            return true;
+        default:
+            return false;
+    }
+}
 
-static QueueHandle_t s_logic_q;
+void logic_rx_stamp(void)
+{
+    s_rx_task = xTaskGetCurrentTaskHandle();
+    s_rx_us = esp_timer_get_time();
+}
 
 static void logic_queue_send(const logic_evt_t *e)
 {
-    if (!s_logic_q || !e) {
+    if (!e) {
         return;
     }
-    if (xQueueSend(s_logic_q, e, 0) != pdTRUE) {
-        ESP_LOGW(TAG, "logic queue full, drop evt=%d", (int)e->type);
+    int64_t now = esp_timer_get_time();
+    logic_evt_t ev = *e;
+    if (s_rx_us && is_rx_event(ev.type) && s_rx_task == xTaskGetCurrentTaskHandle()) {
+        ev.rx_us = s_rx_us;
+        s_rx_us = 0;
+        lat_note(LOGIC_LAT_RX_ENQ, now - ev.rx_us);
     }
-}
 
+    taskENTER_CRITICAL(&s_mb_lock);
+    bool ok = logic_mb_post(&s_mb, &ev, now);
+    taskEXIT_CRITICAL(&s_mb_lock);
 
-// ===== NVS keys =====
-#define NVS_NS           "app"
-#define NVS_K_MODE       "mode"
-#define NVS_K_EPOCH      "epoch"
-#define NVS_K_ACTIVE     "active"
-#define NVS_K_DEADLINE   "deadline_us"
-#define NVS_K_OWNER_OK   "owner_ok"
-#define NVS_K_OWNER_ADDR "owner_addr"
-
-#define RESTORE_WAIT_MS  1200  // ждать state_rsp после ребута (strict)
-#define RESTORE_RETRY_INTERVAL_US (3 * 1000 * 1000)
-#define RESTORE_COLD_BOOT_TIMEOUT_US (3 * 60 * 1000 * 1000)
-#define NVS_DEBOUNCE_US  (5 * 1000 * 1000)
-#define RX_DEDUP_WINDOW_US (2 * 1000 * 1000)
-#define RX_DEDUP_MIN_DIFF_MS 300
-
-// ===== NVS keys for MODE overrides (persistent) =====
-#define NVS_K_GMODE_VALID  "g_valid"
-#define NVS_K_GMODE        "g_mode"
-
-#define NVS_K_ZMODE_VALID  "z_valid"
-#define NVS_K_ZMODE_ZONE   "z_zone"
-#define NVS_K_ZMODE        "z_mode"
-
-#define NVS_K_NMODE_VALID  "n_valid"
-#define NVS_K_NMODE        "n_mode"
-
-
-static void set_relay(logic_state_t *state, bool on)
-{
-    io_board_set_relay(on);
-    state->zone.relay_on = on;
+    if (!ok) {
+        ESP_LOGW(TAG, "logic mailbox %s lane full, drop evt=%d",
+                 logic_mb_lane_name(logic_mb_lane_of(e->type)), (int)e->type);
+        return;
+    }
+    if (s_logic_task) {
+        xTaskNotifyGive(s_logic_task);
+    }
 }
 
-static void state_clear_active(logic_state_t *state)
+static bool logic_queue_recv(logic_evt_t *out)
 {
-    state->zone.active = false;
-    state->zone.deadline_us = 0;
-    state->zone.owner_valid = false;
-    memset(&state->zone.owner_addr, 0, sizeof(state->zone.owner_addr));
-    state->zone.pending_restore = false;
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_mb_lock);
+    bool got = logic_mb_pop(&s_mb, out, now);
+    taskEXIT_CRITICAL(&s_mb_lock);
+    return got;
 }
 
-static void clear_active(void)
+static bool logic_queue_empty(void)
 {
-    state_clear_active(&s_state);
+    taskENTER_CRITICAL(&s_mb_lock);
+    bool empty = logic_mb_empty(&s_mb);
+    taskEXIT_CRITICAL(&s_mb_lock);
+    return empty;
 }
 
-static bool addr_eq(const otIp6Address *a, const otIp6Address *b)
+void logic_cli_print_mailbox(void)
 {
-    return memcmp(a->mFields.m8, b->mFields.m8, 16) == 0;
+    logic_mb_lane_stats_t st[LOGIC_MB_LANE_COUNT];
+    taskENTER_CRITICAL(&s_mb_lock);
+    memcpy(st, s_mb.stats, sizeof(st));
+    taskEXIT_CRITICAL(&s_mb_lock);
+
+    for (int lane = 0; lane < LOGIC_MB_LANE_COUNT; lane++) {
+        uint32_t wait_avg_us = st[lane].popped ? (uint32_t)(st[lane].wait_sum_us / st[lane].popped) : 0;
+        otCliOutputFormat("mailbox %s: depth=%u max=%u posted=%lu merged=%lu dropped=%lu "
+                          "wait_avg_us=%lu wait_max_us=%lu\r\n",
+                          logic_mb_lane_name((logic_mb_lane_t)lane),
+                          (unsigned)st[lane].depth, (unsigned)st[lane].depth_max,
+                          (unsigned long)st[lane].posted, (unsigned long)st[lane].merged,
+                          (unsigned long)st[lane].dropped,
+                          (unsigned long)wait_avg_us, (unsigned long)st[lane].wait_max_us);
+    }
 }
 
-bool logic_is_owner(void)
+void logic_cli_print_trace(uint32_t n)
 {
-    if (!s_state.zone.owner_valid) return false;
-    otIp6Address me;
-    if (!coap_if_get_my_meshlocal_eid(&me)) return false;
-    return addr_eq(&me, &s_state.zone.owner_addr);
+    uint32_t head = logic_trace_head(&s_trace);
+    uint32_t avail = head < LOGIC_TRACE_LEN ? head : LOGIC_TRACE_LEN;
+    if (n == 0 || n > avail) {
+        n = avail;
+    }
+    otCliOutputFormat("trace: %lu of %lu records\r\n", (unsigned long)n, (unsigned long)head);
+
+    char line[128];
+    for (uint32_t seq = head - n; seq != head; seq++) {
+        logic_trace_rec_t r;
+        if (!logic_trace_get(&s_trace, seq, &r)) {
+            continue;   // перезаписана, пока печатали
+        }
+        logic_trace_format(&r, line, sizeof(line));
+        otCliOutputFormat("%s\r\n", line);
+    }
 }
 
-static void nvs_save_all(void)
+void logic_cli_print_latency(bool reset)
 {
-    nvs_handle_t h;
-    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
-
-    nvs_set_u8(h, NVS_K_MODE, (uint8_t)s_state.zone.mode);
-    nvs_set_u32(h, NVS_K_EPOCH, (uint32_t)s_state.zone.epoch);
-    nvs_set_u8(h, NVS_K_ACTIVE, (uint8_t)(s_state.zone.active ? 1 : 0));
-    nvs_set_i64(h, NVS_K_DEADLINE, (int64_t)s_state.zone.deadline_us);
-    nvs_set_u8(h, NVS_K_OWNER_OK, (uint8_t)(s_state.zone.owner_valid ? 1 : 0));
-    if (s_state.zone.owner_valid) {
-        nvs_set_blob(h, NVS_K_OWNER_ADDR, s_state.zone.owner_addr.mFields.m8, 16);
-    } else {
-        uint8_t z[16] = {0};
-        nvs_set_blob(h, NVS_K_OWNER_ADDR, z, 16);
+    logic_lat_hist_t lat[LOGIC_LAT_STAGE_COUNT];
+    taskENTER_CRITICAL(&s_lat_lock);
+    memcpy(lat, s_lat, sizeof(lat));
+    if (reset) {
+        for (int s = 0; s < LOGIC_LAT_STAGE_COUNT; s++) {
+            logic_lat_reset(&s_lat[s]);
+        }
+    }
+    taskEXIT_CRITICAL(&s_lat_lock);
+
+    for (int s = 0; s < LOGIC_LAT_STAGE_COUNT; s++) {
+        const logic_lat_hist_t *h = &lat[s];
+        uint32_t avg = h->count ? (uint32_t)(h->sum_us / h->count) : 0;
+        otCliOutputFormat("lat %s: n=%lu avg=%luus p50<=%lu p90<=%lu p99<=%lu max=%luus\r\n",
+                          logic_lat_stage_name((logic_lat_stage_t)s), (unsigned long)h->count,
+                          (unsigned long)avg,
+                          (unsigned long)logic_lat_percentile_us(h, 50),
+                          (unsigned long)logic_lat_percentile_us(h, 90),
+                          (unsigned long)logic_lat_percentile_us(h, 99),
+                          (unsigned long)h->max_us);
+        if (h->count == 0) {
+            continue;
+        }
+        // ненулевые корзины: "<верхняя граница:число", последняя — ">=нижняя"
+        otCliOutputFormat(" ");
+        for (uint8_t b = 0; b < LOGIC_LAT_BUCKETS; b++) {
+            if (h->bucket[b] == 0) {
+                continue;
+            }
+            if (b == LOGIC_LAT_BUCKETS - 1) {
+                otCliOutputFormat(" >=%lu:%lu", (unsigned long)logic_lat_bucket_upper_us(b - 1),
+                                  (unsigned long)h->bucket[b]);
+            } else {
+                otCliOutputFormat(" <%lu:%lu", (unsigned long)logic_lat_bucket_upper_us(b),
+                                  (unsigned long)h->bucket[b]);
+            }
+        }
+        otCliOutputFormat("\r\n");
+    }
+    if (reset) {
+        otCliOutputFormat("lat: reset\r\n");
     }
-
-    // --- persist overrides ---
-    nvs_set_u8(h, NVS_K_GMODE_VALID, (uint8_t)(s_state.global_mode_valid ? 1 : 0));
-    nvs_set_u8(h, NVS_K_GMODE,       (uint8_t)s_state.global_mode);
-
-    nvs_set_u8(h, NVS_K_ZMODE_VALID, (uint8_t)(s_state.zone_mode_valid ? 1 : 0));
-    nvs_set_u8(h, NVS_K_ZMODE_ZONE,  (uint8_t)s_state.zone_mode_zone);
-    nvs_set_u8(h, NVS_K_ZMODE,       (uint8_t)s_state.zone_mode);
-
-    nvs_set_u8(h, NVS_K_NMODE_VALID, (uint8_t)(s_state.node_mode_valid ? 1 : 0));
-    nvs_set_u8(h, NVS_K_NMODE,       (uint8_t)s_state.node_mode);
-
-
-    nvs_commit(h);
-    nvs_close(h);
 }
 
-static light_mode_t effective_mode(const logic_state_t *state)
+
+uint8_t logic_get_zone_ids(uint8_t *out, uint8_t max)
 {
-#if ROLE_CONTROLLER
-    return io_board_read_mode_switch();   // контроллер главный
-#else
-    if (state->node_mode_valid) return state->node_mode;
-    if (state->zone_mode_valid && state->zone_mode_zone == config_store_get()->zone_id) return state->zone_mode;
-    if (state->global_mode_valid) return state->global_mode;
-    return state->zone.mode;                  // локальный режим (NVS/CLI)
+    uint8_t n = 0;
+    if (max == 0) {
+        return 0;
+    }
+    out[n++] = config_store_get()->zone_id;
+#if EXTRA_ZONE_COUNT
+    static const uint8_t extra[] = EXTRA_ZONE_IDS;
+    for (uint8_t i = 0; i < EXTRA_ZONE_COUNT && n < max; i++) {
+        out[n++] = extra[i];
+    }
 #endif
+    return n;
 }
 
-typedef struct {
-    bool set_relay;
-    bool relay_on;
-    bool update_led;
-    bool save_nvs;
-    bool send_state_req;
-    bool send_trigger;
-    uint32_t trigger_rem_ms;
-    bool send_off;
-    uint32_t off_epoch;
-    bool log_transition;
-    bool flush_nvs_now;
-    fsm_state_t from_state;
-    fsm_state_t to_state;
-    logic_evt_type_t event;
-} fsm_actions_t;
-
-static const char *fsm_state_name(fsm_state_t state)
+static uint8_t primary_zone_id(void)
 {
-    switch (state) {
-        case FSM_AUTO_IDLE: return "AutoIdle";
-        case FSM_AUTO_ACTIVE: return "AutoActive";
-        case FSM_MANUAL_ON: return "ManualOn";
-        case FSM_MANUAL_OFF: return "ManualOff";
-        case FSM_PENDING_RESTORE: return "PendingRestore";
-        default: return "Unknown";
-    }
+    return config_store_get()->zone_id;
 }
 
-static const char *event_name(logic_evt_type_t event)
+bool logic_is_owner(void)
 {
-    switch (event) {
-        case EVT_STATE_RSP: return "STATE_RSP";
-        case EVT_TRIGGER_RX: return "TRIGGER_RX";
-        case EVT_OFF_RX: return "OFF_RX";
-        case EVT_MODE_SET_GLOBAL: return "MODE_SET_GLOBAL";
-        case EVT_MODE_SET_ZONE: return "MODE_SET_ZONE";
-        case EVT_MODE_SET_NODE: return "MODE_SET_NODE";
-        case EVT_MODE_CLR_GLOBAL: return "MODE_CLR_GLOBAL";
-        case EVT_MODE_CLR_ZONE: return "MODE_CLR_ZONE";
-        case EVT_MODE_CLR_NODE: return "MODE_CLR_NODE";
-        case EVT_LOCAL_MODE_SET: return "LOCAL_MODE_SET";
-        case EVT_LOCAL_TRIGGER: return "LOCAL_TRIGGER";
-        case EVT_TICK: return "TICK";
-        case EVT_ENTER_PENDING_RESTORE: return "ENTER_PENDING_RESTORE";
-        case EVT_COLD_BOOT: return "COLD_BOOT";
-        default: return "UNKNOWN";
-    }
+    return logic_fsm_is_owner(&s_state.zones[0]);
 }
 
 void logic_cli_print_state(void)
 {
-    uint32_t epoch = 0;
-    uint32_t rem_ms = 0;
-    bool active = false;
-    otIp6Address owner;
-    logic_build_state(&epoch, &owner, &rem_ms, &active);
-
-    char owner_str[OT_IP6_ADDRESS_STRING_SIZE];
-    otIp6AddressToString(&owner, owner_str, sizeof(owner_str));
-
-    light_mode_t mode = effective_mode(&s_state);
-    const char *fsm = fsm_state_name(s_state.fsm);
-
-    otCliOutputFormat("epoch=%lu active=%u rem_ms=%lu fsm=%s mode=%u owner=%s\r\n",
-                      (unsigned long)epoch,
-                      active ? 1u : 0u,
-                      (unsigned long)rem_ms,
-                      fsm,
-                      (unsigned)mode,
-                      owner_str);
+    for (uint8_t i = 0; i < s_state.zone_count; i++) {
+        const logic_zone_t *z = &s_state.zones[i];
+        uint32_t epoch = 0;
+        uint32_t rem_ms = 0;
+        bool active = false;
+        otIp6Address owner;
+        logic_build_zone_state(z->zone_id, &epoch, &owner, &rem_ms, &active);
+
+        char owner_str[OT_IP6_ADDRESS_STRING_SIZE];
+        otIp6AddressToString(&owner, owner_str, sizeof(owner_str));
+
+        light_mode_t mode = logic_fsm_effective_mode(&s_state, z);
+        const char *fsm = logic_fsm_state_name(z->fsm);
+
+        otCliOutputFormat("zone=%u epoch=%lu active=%u rem_ms=%lu fsm=%s mode=%u owner=%s\r\n",
+                          (unsigned)z->zone_id,
+                          (unsigned long)epoch,
+                          active ? 1u : 0u,
+                          (unsigned long)rem_ms,
+                          fsm,
+                          (unsigned)mode,
+                          owner_str);
+    }
 }
 
 bool logic_post_parsed(logic_parsed_kind_t kind,
+                       uint8_t zone_id,
                        const rust_parsed_t *parsed,
                        const otIp6Address *peer_addr,
                        bool is_multicast)
@@ -310,10 +294,10 @@ bool logic_post_parsed(logic_parsed_kind_t kind,
             uint32_t remaining_ms = parsed->has_rem_ms ? parsed->rem_ms : 0;
             bool is_active = (parsed->active != 0);
             otIp6Address owner = {0};
-            if (peer_addr) {
-                owner = *peer_addr;
+            if (parsed->has_owner) {
+                memcpy(owner.mFields.m8, parsed->owner, sizeof(owner.mFields.m8));
             }
-            logic_post_state_response(parsed->epoch, &owner, remaining_ms, is_active);
+            logic_post_state_response(zone_id, parsed->epoch, &owner, remaining_ms, is_active);
             return true;
         }
         case LOGIC_PARSED_TRIGGER: {
@@ -325,14 +309,14 @@ bool logic_post_parsed(logic_parsed_kind_t kind,
             if (peer_addr) {
                 src = *peer_addr;
             }
-            logic_post_trigger_rx(parsed->epoch, &src, rem);
+            logic_post_trigger_rx(zone_id, parsed->epoch, &src, rem);
             return true;
         }
         case LOGIC_PARSED_OFF: {
             if (!parsed->has_epoch) {
                 return false;
             }
-            logic_post_off_rx(parsed->epoch);
+            logic_post_off_rx(zone_id, parsed->epoch);
             return true;
         }
         case LOGIC_PARSED_MODE: {
@@ -368,406 +352,6 @@ bool logic_post_parsed(logic_parsed_kind_t kind,
     }
 }
 
-static fsm_state_t fsm_from_state(const logic_state_t *state, int64_t now)
-{
-    light_mode_t mode = effective_mode(state);
-    if (mode == MODE_OFF) {
-        return FSM_MANUAL_OFF;
-    }
-    if (mode == MODE_ON) {
-        return FSM_MANUAL_ON;
-    }
-    if (state->zone.pending_restore) {
-        return FSM_PENDING_RESTORE;
-    }
-    if (state->zone.active && state->zone.deadline_us > now) {
-        return FSM_AUTO_ACTIVE;
-    }
-    return FSM_AUTO_IDLE;
-}
-
-static void fsm_sync(logic_state_t *state, int64_t now)
-{
-    light_mode_t mode = effective_mode(state);
-    if (mode == MODE_OFF || mode == MODE_ON) {
-        state_clear_active(state);
-    }
-    state->fsm = fsm_from_state(state, now);
-}
-
-static void set_transition_action(fsm_actions_t *actions,
-                                  fsm_state_t from_state,
-                                  fsm_state_t to_state,
-                                  logic_evt_type_t event)
-{
-    if (from_state == to_state) {
-        return;
-    }
-    actions->log_transition = true;
-    actions->from_state = from_state;
-    actions->to_state = to_state;
-    actions->event = event;
-}
-
-static fsm_actions_t step(logic_state_t *state, const logic_evt_t *event, int64_t now)
-{
-    fsm_actions_t actions = {0};
-    fsm_state_t prev_state = state->fsm;
-
-    switch (event->type) {
-        case EVT_MODE_SET_GLOBAL:
-            state->global_mode_valid = true;
-            state->global_mode = (light_mode_t)(event->u32 & 0xFF);
-            actions.update_led = true;
-            actions.save_nvs = true;
-            fsm_sync(state, now);
-            break;
-
-        case EVT_MODE_SET_ZONE: {
-            uint8_t zone = (uint8_t)((event->u32 >> 8) & 0xFF);
-            light_mode_t mode = (light_mode_t)(event->u32 & 0xFF);
-            state->zone_mode_valid = true;
-            state->zone_mode_zone = zone;
-            state->zone_mode = mode;
-            actions.update_led = true;
-            actions.save_nvs = true;
-            fsm_sync(state, now);
-        } break;
-
-        case EVT_MODE_SET_NODE:
-            state->node_mode_valid = true;
-            state->node_mode = (light_mode_t)(event->u32 & 0xFF);
-            actions.update_led = true;
-            actions.save_nvs = true;
-            fsm_sync(state, now);
-            break;
-
-        case EVT_MODE_CLR_GLOBAL:
-            state->global_mode_valid = false;
-            actions.update_led = true;
-            actions.save_nvs = true;
-            fsm_sync(state, now);
-            break;
-
-        case EVT_MODE_CLR_ZONE: {
-            uint8_t zone = (uint8_t)(event->u32 & 0xFF);
-            if (state->zone_mode_valid && state->zone_mode_zone == zone) {
-                state->zone_mode_valid = false;
-                actions.update_led = true;
-                actions.save_nvs = true;
-                fsm_sync(state, now);
-            }
-        } break;
-
-        case EVT_MODE_CLR_NODE:
-            state->node_mode_valid = false;
-            actions.update_led = true;
-            actions.save_nvs = true;
-            fsm_sync(state, now);
-            break;
-
-        case EVT_LOCAL_MODE_SET: {
-            light_mode_t mode = (light_mode_t)(event->u32 & 0xFF);
-            if (mode > MODE_AUTO) {
-                mode = MODE_AUTO;
-            }
-            if (state->zone.mode == mode) {
-                break;
-            }
-            state->zone.mode = mode;
-            actions.update_led = true;
-            actions.save_nvs = true;
-            if (mode != MODE_AUTO) {
-                state_clear_active(state);
-            } else {
-                actions.send_state_req = true;
-            }
-            fsm_sync(state, now);
-        } break;
-
-        case EVT_STATE_RSP: {
-            int64_t delta_us = now - state->last_state_rsp_time_us;
-            if (state->last_state_rsp_valid &&
-                event->epoch == state->last_state_rsp_epoch &&
-                addr_eq(&event->addr, &state->last_state_rsp_addr) &&
-                delta_us >= 0 && delta_us < RX_DEDUP_WINDOW_US) {
-                uint32_t last_rem = state->last_state_rsp_rem_ms;
-                uint32_t rem = event->u32;
-                uint32_t diff = (last_rem > rem) ? (last_rem - rem) : (rem - last_rem);
-                if (diff < RX_DEDUP_MIN_DIFF_MS) {
-                    ESP_LOGD(TAG, "RX state_rsp duplicate ignored epoch=%lu rem_ms=%lu",
-                             (unsigned long)event->epoch, (unsigned long)event->u32);
-                    return actions;
-                }
-            }
-
-            if (event->epoch < state->zone.epoch && !state->zone.pending_restore) {
-                break;
-            }
-            if (event->epoch == state->zone.epoch && state->zone.owner_valid) {
-                if (!addr_eq(&event->addr, &state->zone.owner_addr)) {
-                    break;
-                }
-            }
-
-            int64_t cand_deadline_us = 0;
-            if (event->b && event->u32 > 0) {
-                cand_deadline_us = now + (int64_t)event->u32 * 1000;
-            }
-
-            bool accept = false;
-            if (event->epoch > state->zone.epoch) {
-                accept = true;
-            } else {
-                if (state->zone.pending_restore) {
-                    accept = true;
-                } else {
-                    if (event->b && event->u32 > 0) {
-                        if (!state->zone.active) {
-                            accept = true;
-                        } else {
-                            if (cand_deadline_us < state->zone.deadline_us - 300 * 1000) {
-                                accept = true;
-                            } else {
-                                break;
-                            }
-                        }
-                    } else {
-                        break;
-                    }
-                }
-            }
-
-            if (!accept) {
-                break;
-            }
-
-            state->zone.epoch = event->epoch;
-            state->zone.owner_addr = event->addr;
-            state->zone.owner_valid = true;
-
-            if (event->b && event->u32 > 0) {
-                state->zone.active = true;
-                state->zone.deadline_us = cand_deadline_us;
-                state->zone.pending_restore = false;
-            } else {
-                state_clear_active(state);
-            }
-
-            actions.save_nvs = true;
-            state->last_state_rsp_valid = true;
-            state->last_state_rsp_epoch = event->epoch;
-            state->last_state_rsp_addr = event->addr;
-            state->last_state_rsp_rem_ms = event->u32;
-            state->last_state_rsp_time_us = now;
-            fsm_sync(state, now);
-        } break;
-
-        case EVT_TRIGGER_RX: {
-            int64_t delta_us = now - state->last_trigger_time_us;
-            if (state->last_trigger_valid &&
-                event->epoch == state->last_trigger_epoch &&
-                addr_eq(&event->addr, &state->last_trigger_addr) &&
-                delta_us >= 0 && delta_us < RX_DEDUP_WINDOW_US) {
-                uint32_t last_rem = state->last_trigger_rem_ms;
-                uint32_t rem = event->u32;
-                uint32_t diff = (last_rem > rem) ? (last_rem - rem) : (rem - last_rem);
-                if (diff < RX_DEDUP_MIN_DIFF_MS) {
-                    ESP_LOGD(TAG, "RX trigger duplicate ignored epoch=%lu rem_ms=%lu",
-                             (unsigned long)event->epoch, (unsigned long)event->u32);
-                    return actions;
-                }
-            }
-
-            if (event->epoch < state->zone.epoch && !state->zone.pending_restore) {
-                break;
-            }
-            if (event->epoch == state->zone.epoch && state->zone.owner_valid) {
-                if (memcmp(&event->addr, &state->zone.owner_addr, sizeof(event->addr)) != 0) {
-                    break;
-                }
-            }
-
-            int64_t new_deadline_us = now + (int64_t)event->u32 * 1000;
-            if (event->epoch == state->zone.epoch && state->zone.active) {
-                if (new_deadline_us >= state->zone.deadline_us) {
-                    break;
-                }
-                if ((state->zone.deadline_us - new_deadline_us) < 300 * 1000) {
-                    break;
-                }
-            }
-
-            state->zone.epoch = event->epoch;
-            state->zone.owner_addr = event->addr;
-            state->zone.owner_valid = true;
-            state->zone.active = true;
-            state->zone.deadline_us = new_deadline_us;
-            state->zone.pending_restore = false;
-            actions.save_nvs = true;
-            state->last_trigger_valid = true;
-            state->last_trigger_epoch = event->epoch;
-            state->last_trigger_addr = event->addr;
-            state->last_trigger_rem_ms = event->u32;
-            state->last_trigger_time_us = now;
-            fsm_sync(state, now);
-        } break;
-
-        case EVT_OFF_RX:
-            if (event->epoch != state->zone.epoch) {
-                break;
-            }
-            state_clear_active(state);
-            actions.save_nvs = true;
-            fsm_sync(state, now);
-            break;
-
-        case EVT_LOCAL_TRIGGER: {
-            if (now - state->last_local_trigger_us < 800 * 1000) {
-                break;
-            }
-            state->last_local_trigger_us = now;
-
-            otIp6Address me;
-            if (!coap_if_get_my_meshlocal_eid(&me)) {
-                break;
-            }
-
-            bool force_new_owner = event->b;
-            if (force_new_owner || !state->zone.active || !state->zone.owner_valid ||
-                !addr_eq(&me, &state->zone.owner_addr)) {
-                state->zone.epoch += 1;
-                state->zone.owner_addr = me;
-                state->zone.owner_valid = true;
-            }
-
-            state->zone.active = true;
-            state->zone.pending_restore = false;
-            state->zone.last_motion_us = now;
-            state->zone.deadline_us = now + (int64_t)config_store_get()->auto_hold_ms * 1000;
-            actions.save_nvs = true;
-
-            if (state->zone.deadline_us > now) {
-                actions.send_trigger = true;
-                actions.trigger_rem_ms = (uint32_t)((state->zone.deadline_us - now) / 1000);
-            }
-
-            fsm_sync(state, now);
-        } break;
-
-        case EVT_ENTER_PENDING_RESTORE:
-            state->zone.pending_restore = true;
-            state->restore_deadline_us = now + (int64_t)RESTORE_WAIT_MS * 1000;
-            state->next_state_req_us = now;
-            fsm_sync(state, now);
-            break;
-
-        case EVT_COLD_BOOT:
-            state_clear_active(state);
-            state->zone.owner_valid = false;
-            state->zone.pending_restore = true;
-            state->restore_deadline_us = now + RESTORE_COLD_BOOT_TIMEOUT_US;
-            state->next_state_req_us = now;
-            actions.flush_nvs_now = true;
-            fsm_sync(state, now);
-            break;
-
-        case EVT_TICK: {
-            if (state->zone.pending_restore) {
-                if (now >= state->next_state_req_us) {
-                    actions.send_state_req = true;
-                    state->next_state_req_us = now + RESTORE_RETRY_INTERVAL_US;
-                }
-                if (state->restore_deadline_us && now > state->restore_deadline_us) {
-                    state_clear_active(state);
-                    state->zone.pending_restore = false;
-                    actions.flush_nvs_now = true;
-                    fsm_sync(state, now);
-                }
-            }
-
-            if (state->fsm == FSM_AUTO_ACTIVE && state->zone.active &&
-                state->zone.deadline_us && now > state->zone.deadline_us) {
-                if (logic_is_owner()) {
-                    actions.send_off = true;
-                    actions.off_epoch = state->zone.epoch;
-                }
-                state_clear_active(state);
-                actions.save_nvs = true;
-                fsm_sync(state, now);
-            }
-
-            if (state->nvs_dirty && state->nvs_next_flush_us &&
-                (uint64_t)now >= state->nvs_next_flush_us) {
-                actions.flush_nvs_now = true;
-            }
-
-            actions.set_relay = true;
-            switch (state->fsm) {
-                case FSM_MANUAL_OFF:
-                case FSM_AUTO_IDLE:
-                case FSM_PENDING_RESTORE:
-                    actions.relay_on = false;
-                    break;
-                case FSM_MANUAL_ON:
-                case FSM_AUTO_ACTIVE:
-                    actions.relay_on = true;
-                    break;
-                default:
-                    actions.relay_on = false;
-                    break;
-            }
-        } break;
-    }
-
-    set_transition_action(&actions, prev_state, state->fsm, event->type);
-    return actions;
-}
-
-static void apply_actions(logic_state_t *state, const fsm_actions_t *actions)
-{
-    uint64_t now_us = (uint64_t)esp_timer_get_time();
-
-    if (actions->update_led) {
-        rgb_set_mode_color(effective_mode(state));
-    }
-    if (actions->set_relay) {
-        set_relay(state, actions->relay_on);
-    }
-    if (actions->send_state_req) {
-        if (coap_if_thread_ready()) {
-            coap_if_send_state_req();
-        }
-    }
-    if (actions->send_trigger) {
-        coap_if_send_trigger(state->zone.epoch, actions->trigger_rem_ms);
-    }
-    if (actions->send_off) {
-        coap_if_send_off(actions->off_epoch);
-    }
-    if (actions->flush_nvs_now) {
-        ESP_LOGI(TAG, "NVS flush");
-        nvs_save_all();
-        state->nvs_dirty = false;
-        state->nvs_next_flush_us = 0;
-    } else if (actions->save_nvs) {
-        if (!state->nvs_dirty) {
-            state->nvs_dirty = true;
-            state->nvs_next_flush_us = now_us + NVS_DEBOUNCE_US;
-            ESP_LOGI(TAG, "NVS dirty, schedule flush in %lu ms",
-                     (unsigned long)(NVS_DEBOUNCE_US / 1000));
-        } else {
-            state->nvs_next_flush_us = now_us + NVS_DEBOUNCE_US;
-        }
-    }
-    if (actions->log_transition) {
-        ESP_LOGI(TAG, "FSM %s -> %s on %s",
-                 fsm_state_name(actions->from_state),
-                 fsm_state_name(actions->to_state),
-                 event_name(actions->event));
-    }
-}
-
 
 
 void logic_post_mode_cmd_global(light_mode_t mode)
@@ -855,84 +439,6 @@ void logic_post_mode_clear_node(void)
 //              (unsigned long)epoch);
 // }
 
-static void nvs_load_all(light_mode_t def_mode)
-{
-    nvs_handle_t h;
-    if (nvs_open(NVS_NS, NVS_READONLY, &h) != ESP_OK) {
-        // defaults
-        s_state.zone.mode = def_mode;
-        s_state.zone.epoch = 0;
-        clear_active();
-        ESP_LOGI(TAG, "NVS empty -> defaults");
-        return;
-    }
-
-    uint8_t mode = (uint8_t)def_mode;
-    uint32_t epoch = 0;
-    uint8_t active = 0;
-    int64_t deadline_us = 0;
-    uint8_t owner_ok = 0;
-    uint8_t owner[16] = {0};
-    size_t sz = sizeof(owner);
-
-    uint8_t g_valid = 0, g_mode = (uint8_t)MODE_AUTO;
-    uint8_t z_valid = 0, z_zone = 0, z_mode = (uint8_t)MODE_AUTO;
-    uint8_t n_valid = 0, n_mode = (uint8_t)MODE_AUTO;
-
-
-    (void)nvs_get_u8(h, NVS_K_MODE, &mode);
-    (void)nvs_get_u32(h, NVS_K_EPOCH, &epoch);
-    (void)nvs_get_u8(h, NVS_K_ACTIVE, &active);
-    (void)nvs_get_i64(h, NVS_K_DEADLINE, &deadline_us);
-    (void)nvs_get_u8(h, NVS_K_OWNER_OK, &owner_ok);
-    (void)nvs_get_blob(h, NVS_K_OWNER_ADDR, owner, &sz);
-
-    (void)nvs_get_u8(h, NVS_K_GMODE_VALID, &g_valid);
-    (void)nvs_get_u8(h, NVS_K_GMODE, &g_mode);
-
-    (void)nvs_get_u8(h, NVS_K_ZMODE_VALID, &z_valid);
-    (void)nvs_get_u8(h, NVS_K_ZMODE_ZONE,  &z_zone);
-    (void)nvs_get_u8(h, NVS_K_ZMODE, &z_mode);
-
-    (void)nvs_get_u8(h, NVS_K_NMODE_VALID, &n_valid);
-    (void)nvs_get_u8(h, NVS_K_NMODE, &n_mode);
-
-
-    nvs_close(h);
-
-    // apply loaded overrides (with sanity)
-    s_state.global_mode_valid = (g_valid != 0);
-    s_state.global_mode = (light_mode_t)g_mode;
-    if (s_state.global_mode > MODE_AUTO) { s_state.global_mode = MODE_AUTO; s_state.global_mode_valid = false; }
-
-    s_state.zone_mode_valid = (z_valid != 0);
-    s_state.zone_mode_zone  = z_zone;
-    s_state.zone_mode = (light_mode_t)z_mode;
-    if (s_state.zone_mode > MODE_AUTO) { s_state.zone_mode = MODE_AUTO; s_state.zone_mode_valid = false; }
-
-    s_state.node_mode_valid = (n_valid != 0);
-    s_state.node_mode = (light_mode_t)n_mode;
-    if (s_state.node_mode > MODE_AUTO) { s_state.node_mode = MODE_AUTO; s_state.node_mode_valid = false; }
-
-
-    if (mode > MODE_AUTO) mode = (uint8_t)def_mode;
-
-    s_state.zone.mode = (light_mode_t)mode;
-    s_state.zone.epoch = epoch;
-    s_state.zone.active = (active != 0);
-    s_state.zone.deadline_us = deadline_us;
-    s_state.zone.owner_valid = (owner_ok != 0);
-    memcpy(s_state.zone.owner_addr.mFields.m8, owner, 16);
-    s_state.zone.pending_restore = false;
-
-    ESP_LOGI(TAG, "NVS: mode=%u active=%u deadline_us=%lld owner_ok=%u epoch=%lu",
-             (unsigned)mode,
-             (unsigned)active,
-             (long long)deadline_us,
-             (unsigned)owner_ok,
-             (unsigned long)epoch);
-
-}
 
 
 // void logic_build_state(uint32_t *epoch,
@@ -960,32 +466,24 @@ static void nvs_load_all(light_mode_t def_mode)
 //     if (active) *active = (s_state.active && rem > 0);
 // }
 
-void logic_build_state(uint32_t *epoch, otIp6Address *owner, uint32_t *rem_ms, bool *active)
+bool logic_build_zone_state(uint8_t zone_id, uint32_t *epoch, otIp6Address *owner,
+                            uint32_t *rem_ms, bool *active)
 {
-    int64_t now = esp_timer_get_time();
-
-    *epoch = s_state.zone.epoch;
-    if (s_state.zone.owner_valid) {
-        *owner = s_state.zone.owner_addr;
-    } else {
+    const logic_zone_t *z = logic_fsm_zone(&s_state, zone_id);
+    if (!z) {
+        *epoch = 0;
         memset(owner, 0, sizeof(*owner));
-    }
-
-    // если мы в strict-restore режиме — не утверждаем active наружу
-    if (s_state.zone.pending_restore) {
-        *active = false;
         *rem_ms = 0;
-        return;
+        *active = false;
+        return false;
     }
+    logic_fsm_zone_report(z, logic_fsm_now_us(), epoch, owner, rem_ms, active);
+    return true;
+}
 
-    *active = s_state.zone.active;
-
-    if (s_state.zone.active && s_state.zone.deadline_us > now) {
-        int64_t left_us = s_state.zone.deadline_us - now;
-        *rem_ms = (uint32_t)(left_us / 1000);
-    } else {
-        *rem_ms = 0;
-    }
+void logic_build_state(uint32_t *epoch, otIp6Address *owner, uint32_t *rem_ms, bool *active)
+{
+    (void)logic_build_zone_state(primary_zone_id(), epoch, owner, rem_ms, active);
 }
 
 
@@ -994,7 +492,7 @@ void logic_on_state_response(uint32_t epoch,
                              uint32_t remaining_ms,
                              bool active)
 {
-    logic_post_state_response(epoch, owner, remaining_ms, active);
+    logic_post_state_response(primary_zone_id(), epoch, owner, remaining_ms, active);
 }
 
 
@@ -1067,13 +565,13 @@ void logic_on_trigger_rx(uint32_t epoch,
                          const otIp6Address *src,
                          uint32_t hold_ms)   // по смыслу: rem_ms
 {
-    logic_post_trigger_rx(epoch, src, hold_ms);
+    logic_post_trigger_rx(primary_zone_id(), epoch, src, hold_ms);
 }
 
 
 void logic_on_off_rx(uint32_t epoch)
 {
-    logic_post_off_rx(epoch);
+    logic_post_off_rx(primary_zone_id(), epoch);
 }
 
 
@@ -1150,7 +648,7 @@ void logic_on_off_rx(uint32_t epoch)
 //                 case EVT_MODE_SET_GLOBAL: {
 //                     s_global_mode_valid = true;
 //                     s_global_mode = (light_mode_t)(e.u32 & 0xFF);
-//                     apply_effective_mode(effective_mode());
+//                     apply_effective_mode(logic_fsm_effective_mode());
 //                     nvs_save_all();
 //                 } break;
 
@@ -1160,20 +658,20 @@ void logic_on_off_rx(uint32_t epoch)
 //                     s_zone_mode_valid = true;
 //                     s_zone_mode_zone = zone;
 //                     s_zone_mode = mode;
-//                     apply_effective_mode(effective_mode());
+//                     apply_effective_mode(logic_fsm_effective_mode());
 //                     nvs_save_all();
 //                 } break;
 
 //                 case EVT_MODE_SET_NODE: {
 //                     s_node_mode_valid = true;
 //                     s_node_mode = (light_mode_t)(e.u32 & 0xFF);
-//                     apply_effective_mode(effective_mode());
+//                     apply_effective_mode(logic_fsm_effective_mode());
 //                     nvs_save_all();
 //                 } break;
 
 //                 case EVT_MODE_CLR_GLOBAL:
 //                     s_global_mode_valid = false;
-//                     apply_effective_mode(effective_mode());
+//                     apply_effective_mode(logic_fsm_effective_mode());
 //                     nvs_save_all();
 //                     break;
 
@@ -1181,14 +679,14 @@ void logic_on_off_rx(uint32_t epoch)
 //                     uint8_t zone = (uint8_t)(e.u32 & 0xFF);
 //                     if (s_zone_mode_valid && s_zone_mode_zone == zone) {
 //                         s_zone_mode_valid = false;
-//                         apply_effective_mode(effective_mode());
+//                         apply_effective_mode(logic_fsm_effective_mode());
 //                         nvs_save_all();
 //                     }
 //                 } break;
 
 //                 case EVT_MODE_CLR_NODE:
 //                     s_node_mode_valid = false;
-//                     apply_effective_mode(effective_mode());
+//                     apply_effective_mode(logic_fsm_effective_mode());
 //                     nvs_save_all();
 //                     break;
 
@@ -1272,7 +770,7 @@ void logic_on_off_rx(uint32_t epoch)
 //             }
 //         }
 // #endif
-//         light_mode_t m = effective_mode();
+//         light_mode_t m = logic_fsm_effective_mode();
 //         // apply modes
 //         // if (s_state.mode == MODE_OFF) {
 //         if (m == MODE_OFF) {
@@ -1308,10 +806,136 @@ void logic_on_off_rx(uint32_t epoch)
 // }
 
 
+typedef struct {
+    uint32_t total;
+    uint32_t window_count;
+    int64_t window_start_us;
+    uint32_t per_sec_x100;      // за последнее полное окно (>= 1 с)
+} logic_wakeup_stats_t;
+
+// пробуждения logic_task и input task (опрос датчиков) — CPU будят обе
+static logic_wakeup_stats_t s_wake;
+static logic_wakeup_stats_t s_wake_in;
+
+static void note_wakeup(logic_wakeup_stats_t *w, int64_t now)
+{
+    w->total++;
+    w->window_count++;
+    int64_t elapsed_us = now - w->window_start_us;
+    if (elapsed_us >= 1000 * 1000) {
+        w->per_sec_x100 = (uint32_t)(((uint64_t)w->window_count * 100 * 1000 * 1000) /
+                                     (uint64_t)elapsed_us);
+        w->window_count = 0;
+        w->window_start_us = now;
+    }
+}
+
+static void wakeup_stats_get(const logic_wakeup_stats_t *w, uint32_t *per_sec_x100, uint32_t *total)
+{
+    uint32_t rate = w->per_sec_x100;
+    int64_t elapsed_us = esp_timer_get_time() - w->window_start_us;
+    // долгий сон: окно ещё не закрыто, считаем по нему
+    if (elapsed_us >= 2 * 1000 * 1000) {
+        rate = (uint32_t)(((uint64_t)w->window_count * 100 * 1000 * 1000) /
+                          (uint64_t)elapsed_us);
+    }
+    if (per_sec_x100) *per_sec_x100 = rate;
+    if (total) *total = w->total;
+}
+
+void logic_get_wakeup_stats(uint32_t *per_sec_x100, uint32_t *total)
+{
+    wakeup_stats_get(&s_wake, per_sec_x100, total);
+}
+
+void logic_get_input_wakeup_stats(uint32_t *per_sec_x100, uint32_t *total)
+{
+    // без input task (нет ни тумблера, ни TFmini) — нули
+    wakeup_stats_get(&s_wake_in, per_sec_x100, total);
+}
+
+void logic_get_dedup_stats(uint32_t *lookups, uint32_t *hits, uint32_t *evictions)
+{
+    // счётчики пишет только logic_task, 32-битное чтение атомарно
+    const logic_dedup_stats_t *st = &s_state.dedup.stats;
+    if (lookups) *lookups = st->lookups;
+    if (hits) *hits = st->hits;
+    if (evictions) *evictions = st->evictions;
+}
+
+void logic_get_state_rsp_stats(uint32_t *requests, uint32_t *sent, uint32_t *suppressed)
+{
+    const logic_state_rsp_stats_t *st = &s_state.rsp_stats;
+    if (requests) *requests = st->requests;
+    if (sent) *sent = st->sent;
+    if (suppressed) *suppressed = st->suppressed;
+}
+
+
+static TickType_t wait_ticks_until(int64_t deadline_us, int64_t now)
+{
+    if (deadline_us == 0) {
+        return portMAX_DELAY;
+    }
+    if (deadline_us < now) {
+        return 0;
+    }
+    // срок колеса кратен его тику; +1 мс и +1 тик — чтобы не проснуться раньше
+    int64_t ms = (deadline_us - now) / 1000 + 1;
+    if (ms > LOGIC_MAX_WAIT_MS) {
+        ms = LOGIC_MAX_WAIT_MS;
+    }
+    return pdMS_TO_TICKS(ms) + 1;
+}
+
+
+// шаг FSM: запись в кольцо трассировки до применения (смена реле видна по relay_on),
+// задержки этапов — кроме EVT_TICK (он на каждом пробуждении), реле — по RX_RELAY
+static void logic_run_event(const logic_evt_t *e, int64_t now)
+{
+    int64_t t0 = esp_timer_get_time();
+    if (e->enq_us) {
+        lat_note(LOGIC_LAT_QUEUE, t0 - e->enq_us);
+    }
+    fsm_actions_t actions = logic_fsm_step(&s_state, e, now);
+    int64_t t1 = esp_timer_get_time();
+
+    logic_trace_step(&s_trace, &s_state, e, &actions, now);
+    bool relay_changed[LOGIC_MAX_ZONES];
+    for (uint8_t i = 0; i < s_state.zone_count; i++) {
+        const fsm_zone_actions_t *za = &actions.zone[i];
+        if (e->rx_us && za->log_transition && !s_relay_rx_us[i]) {
+            s_relay_rx_us[i] = e->rx_us;
+        }
+        relay_changed[i] = za->set_relay && za->relay_on != s_state.zones[i].zone.relay_on;
+    }
+
+    int64_t t2 = esp_timer_get_time();
+    logic_fsm_apply_actions(&s_state, &actions);
+    int64_t t3 = esp_timer_get_time();
+
+    if (e->type != EVT_TICK) {
+        lat_note(LOGIC_LAT_STEP, t1 - t0);
+        lat_note(LOGIC_LAT_APPLY, t3 - t2);
+    }
+    for (uint8_t i = 0; i < s_state.zone_count; i++) {
+        if (relay_changed[i] && s_relay_rx_us[i]) {
+            lat_note(LOGIC_LAT_RX_RELAY, t3 - s_relay_rx_us[i]);
+            s_relay_rx_us[i] = 0;
+        }
+    }
+    if (e->type == EVT_TICK) {
+        // реле выставлено; переход без смены реле следующую смену не ждёт
+        memset(s_relay_rx_us, 0, sizeof(s_relay_rx_us));
+    }
+}
+
 static void logic_task(void *arg)
 {
     (void)arg;
 
+    s_logic_task = xTaskGetCurrentTaskHandle();
+
 #if ROLE_CONTROLLER
     light_mode_t def_mode = io_board_read_mode_switch();
 #else
@@ -1320,137 +944,173 @@ static void logic_task(void *arg)
 
     // init defaults
     memset(&s_state, 0, sizeof(s_state));
-    nvs_load_all(def_mode);
-
-    s_state.fsm = FSM_AUTO_IDLE;
-
-    // Ждём пока Thread реально "в сети" (иначе multicast часто дропается)
+    uint8_t zone_ids[LOGIC_MAX_ZONES];
+    uint8_t zone_count = logic_get_zone_ids(zone_ids, LOGIC_MAX_ZONES);
+    logic_fsm_init_zones(&s_state, zone_ids, NULL, zone_count);
+    logic_fsm_nvs_load(&s_state, def_mode);
+
+    // Ждём attach (не дольше 5 с): строгому restore нужен state_rsp за RESTORE_WAIT_MS.
+    // Будит THREAD_UP из coap_if_state_changed (само событие остаётся в mailbox);
+    // state_req шлёт FSM при входе в PendingRestore, без сети — по THREAD_UP
     int64_t wait_until = esp_timer_get_time() + 5000 * 1000; // 5 сек
-    while (!coap_if_thread_ready() && esp_timer_get_time() < wait_until) {
-        vTaskDelay(pdMS_TO_TICKS(100));
-    }
-
-    ESP_LOGI(TAG, "boot: send state_req (thread_ready=%d)", coap_if_thread_ready());
-    if (coap_if_thread_ready()) {
-        coap_if_send_state_req();
-    } else {
-        ESP_LOGW(TAG, "boot: thread not ready -> defer state_req");
+    while (!coap_if_thread_ready()) {
+        int64_t t = esp_timer_get_time();
+        if (t >= wait_until) {
+            break;
+        }
+        (void)ulTaskNotifyTake(pdTRUE, wait_ticks_until(wait_until, t));
     }
+    ESP_LOGI(TAG, "boot: thread_ready=%d", coap_if_thread_ready());
 
     // cold boot handling (do not reset epoch)
     int64_t now = esp_timer_get_time();
     esp_reset_reason_t rr = esp_reset_reason();
-    if (rr == ESP_RST_POWERON || rr == ESP_RST_BROWNOUT) {
-        logic_evt_t cold = {.type = EVT_COLD_BOOT};
-        fsm_actions_t cold_actions = step(&s_state, &cold, now);
-        apply_actions(&s_state, &cold_actions);
-    }
+    logic_fsm_boot(&s_state, rr == ESP_RST_POWERON || rr == ESP_RST_BROWNOUT, now);
 
-    // strict restore: если думали что active — не включаем, ждём state_rsp
-    // ВАЖНО: проверяем по effective_mode(), а не по s_state.mode
-    if (effective_mode(&s_state) == MODE_AUTO &&
-        s_state.zone.active &&
-        s_state.zone.deadline_us > now) {
-
-        logic_evt_t enter = {.type = EVT_ENTER_PENDING_RESTORE};
-        fsm_actions_t enter_actions = step(&s_state, &enter, now);
-        apply_actions(&s_state, &enter_actions);
-        ESP_LOGI(TAG, "restore(strict): state_req sent, stay OFF until state_rsp");
-    } else {
-        if (s_state.zone.active) {
-            ESP_LOGI(TAG, "restore: invalid stored active -> clear");
-            clear_active();
-            fsm_actions_t flush_actions = {.flush_nvs_now = true};
-            apply_actions(&s_state, &flush_actions);
-        }
-    }
+    for (;;) {
+        now = esp_timer_get_time();
 
-    s_state.fsm = fsm_from_state(&s_state, now);
-    {
-        fsm_actions_t init_actions = {.update_led = true};
-        apply_actions(&s_state, &init_actions);
-    }
+        // 1) Sleep until the next event or the nearest deadline
+        //    (события, пришедшие до s_logic_task, без уведомления — не спим)
+        TickType_t wait = wait_ticks_until(logic_fsm_next_deadline_us(&s_state), now);
+        if (!logic_queue_empty()) {
+            wait = 0;
+        }
+        (void)ulTaskNotifyTake(pdTRUE, wait);
 
-    for (;;) {
         now = esp_timer_get_time();
+        note_wakeup(&s_wake, now);
 
-        // 1) Drain logic events queue (CoAP -> logic)
+        // 2) Drain logic mailbox (CoAP / input task -> logic)
         logic_evt_t e;
-        while (s_logic_q && xQueueReceive(s_logic_q, &e, 0) == pdTRUE) {
-            fsm_actions_t actions = step(&s_state, &e, now);
-            apply_actions(&s_state, &actions);
+        while (logic_queue_recv(&e)) {
+            logic_run_event(&e, now);
+        }
+
+        // 3) Expired timers (deadlines, restore retry/timeout, NVS flush)
+        while (logic_fsm_pop_timer(&s_state, now, &e)) {
+            logic_run_event(&e, now);
         }
 
+        // 4) Tick: relay
+        logic_evt_t tick = {.type = EVT_TICK};
+        logic_run_event(&tick, now);
+
+        // 5) Исходящие CoAP этого прохода — одной пачкой под lock OpenThread
+        coap_if_outbox_flush();
+    }
+}
+
+#if ROLE_CONTROLLER || HAS_TFMINI
+// Опрос тумблера и TFmini вынесен из logic_task: в логику приходят только события.
+static void logic_input_task(void *arg)
+{
+    (void)arg;
+
+#if ROLE_CONTROLLER
+    int last_sw = -1;
+#endif
+#if HAS_TFMINI
+    int64_t last_presence_us = 0;
+#endif
+
+    for (;;) {
+        note_wakeup(&s_wake_in, esp_timer_get_time());
+
 #if ROLE_CONTROLLER
-        // 2) Controller switch updates local mode (controller strongest anyway via effective_mode())
         light_mode_t sw = io_board_read_mode_switch();
-        if (sw != s_state.zone.mode) {
+        if ((int)sw != last_sw) {
+            last_sw = (int)sw;
             logic_evt_t ev = {.type = EVT_LOCAL_MODE_SET, .u32 = (uint32_t)sw};
-            fsm_actions_t actions = step(&s_state, &ev, now);
-            apply_actions(&s_state, &actions);
+            logic_queue_send(&ev);
         }
 #endif
 
-        // 4) Local sensor (allow triggers even during pending_restore)
 #if HAS_TFMINI
-        if (effective_mode(&s_state) == MODE_AUTO) {
-            uint16_t dist = 0;
-            if (tfmini_poll_once(&dist)) {
-                s_state.zone.dist_cm = dist;
-
-                // (опционально) лог раз в N, иначе заспамит
-                // ESP_LOGI(TAG, "TFMINI: dist=%u cm thr=%u", dist, TFMINI_TRIGGER_CM);
-
-                if (dist > 0 && dist <= config_store_get()->tfmini_trigger_cm) {
-                    bool force_new_owner = s_state.zone.pending_restore;
-                    logic_evt_t ev = {.type = EVT_LOCAL_TRIGGER, .b = force_new_owner};
-                    fsm_actions_t actions = step(&s_state, &ev, now);
-                    apply_actions(&s_state, &actions);
-                }
+        uint16_t dist = 0;
+        if (tfmini_poll_once(&dist) &&
+            dist > 0 && dist <= config_store_get()->tfmini_trigger_cm) {
+            int64_t now = esp_timer_get_time();
+            if (last_presence_us == 0 ||
+                now - last_presence_us >= LOCAL_TRIGGER_MIN_INTERVAL_US) {
+                last_presence_us = now;
+                // датчик относится к основной зоне
+                logic_evt_t ev = {.type = EVT_LOCAL_TRIGGER, .zone = primary_zone_id(), .u32 = dist};
+                logic_queue_send(&ev);
             }
         }
 #endif
 
-        // 5) Tick: deadlines, pending restore, relay
-        logic_evt_t tick = {.type = EVT_TICK};
-        fsm_actions_t tick_actions = step(&s_state, &tick, now);
-        apply_actions(&s_state, &tick_actions);
-
-        vTaskDelay(pdMS_TO_TICKS(50));
+        vTaskDelay(pdMS_TO_TICKS(LOGIC_SENSOR_SAMPLE_MS));
     }
 }
+#endif
 
 
 void logic_start(void)
 {
     // xTaskCreate(logic_task, "logic", 4096, NULL, 5, NULL);
-    s_logic_q = xQueueCreate(16, sizeof(logic_evt_t));
+    logic_mb_init(&s_mb);
+    logic_trace_init(&s_trace);
     xTaskCreate(logic_task, "logic", 4096, NULL, 5, NULL);
+#if ROLE_CONTROLLER || HAS_TFMINI
+    xTaskCreate(logic_input_task, "logic_in", 3072, NULL, 5, NULL);
+#endif
 }
 
 
-void logic_post_state_response(uint32_t epoch, const otIp6Address *owner, uint32_t remaining_ms, bool active)
+void logic_post_state_response(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner, uint32_t remaining_ms, bool active)
 {
-    logic_evt_t e = {.type=EVT_STATE_RSP, .epoch=epoch, .addr=*owner, .u32=remaining_ms, .b=active};
+    logic_evt_t e = {.type=EVT_STATE_RSP, .zone=zone_id, .epoch=epoch, .addr=*owner, .u32=remaining_ms, .b=active};
     logic_queue_send(&e);
 }
 
-void logic_post_trigger_rx(uint32_t epoch, const otIp6Address *src, uint32_t hold_ms)
+void logic_post_trigger_rx(uint8_t zone_id, uint32_t epoch, const otIp6Address *src, uint32_t hold_ms)
 {
-    logic_evt_t e = {.type=EVT_TRIGGER_RX, .epoch=epoch, .addr=*src, .u32=hold_ms};
+    logic_evt_t e = {.type=EVT_TRIGGER_RX, .zone=zone_id, .epoch=epoch, .addr=*src, .u32=hold_ms};
     logic_queue_send(&e);
 }
 
-void logic_post_off_rx(uint32_t epoch)
+void logic_post_off_rx(uint8_t zone_id, uint32_t epoch)
 {
-    logic_evt_t e = {.type=EVT_OFF_RX, .epoch=epoch};
+    logic_evt_t e = {.type=EVT_OFF_RX, .zone=zone_id, .epoch=epoch};
     logic_queue_send(&e);
 }
 
+void logic_post_state_req_rx(uint8_t zone_id, const otIp6Address *src)
+{
+    logic_evt_t e = {.type=EVT_STATE_REQ_RX, .zone=zone_id, .addr=*src};
+    logic_queue_send(&e);
+}
+
+void logic_post_netdata_state(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner, uint32_t remaining_ms, bool active)
+{
+    logic_evt_t e = {.type=EVT_NETDATA_STATE, .zone=zone_id, .epoch=epoch, .addr=*owner, .u32=remaining_ms, .b=active};
+    logic_queue_send(&e);
+}
+
+
+void logic_post_thread_up(void)
+{
+    logic_evt_t e = {.type=EVT_THREAD_UP};
+    logic_queue_send(&e);
+}
+
+void logic_post_thread_down(void)
+{
+    logic_evt_t e = {.type=EVT_THREAD_DOWN};
+    logic_queue_send(&e);
+}
+
+bool logic_zone_observable(uint8_t zone_id)
+{
+    const logic_zone_t *z = logic_fsm_zone(&s_state, zone_id);
+    return z && z->obs_source;
+}
 
 const zone_state_t *logic_get_state(void)
 {
-    return &s_state.zone;
+    return &s_state.zones[0].zone;
 }
 
 void logic_set_mode(light_mode_t mode)
@@ -31,17 +31,44 @@ typedef struct {
 // старт логики
 void logic_start(void);
 
-// состояние для /status
+// состояние основной зоны для /status
 const zone_state_t *logic_get_state(void);
 
+// зоны узла: основная (cfg zone_id) + EXTRA_ZONE_IDS; возвращает количество
+uint8_t logic_get_zone_ids(uint8_t *out, uint8_t max);
+
 // смена режима OFF/ON/AUTO (через CoAP /mode или тумблер)
 void logic_set_mode(light_mode_t mode);
 
-// true если текущий узел = owner (по owner_addr)
+// true если текущий узел = owner основной зоны (по owner_addr)
 bool logic_is_owner(void);
 
 void logic_cli_print_state(void);
 
+// пробуждения logic_task: скорость (x100, в секунду) и общее число
+void logic_get_wakeup_stats(uint32_t *per_sec_x100, uint32_t *total);
+// то же для input task (опрос тумблера/TFmini раз в 100 мс), без неё — нули
+void logic_get_input_wakeup_stats(uint32_t *per_sec_x100, uint32_t *total);
+
+// кэш повторов trigger/state_rsp: проверено / отброшено как повтор / вытеснено живых
+void logic_get_dedup_stats(uint32_t *lookups, uint32_t *hits, uint32_t *evictions);
+
+// ответы на state_req: принято запросов / отправлено / подавлено чужим ответом
+void logic_get_state_rsp_stats(uint32_t *requests, uint32_t *sent, uint32_t *suppressed);
+
+// почтовый ящик логики: по полосам глубина / слито / отброшено / ожидание в очереди
+void logic_cli_print_mailbox(void);
+
+// кольцо трассировки: последние n записей (0 = все), старые первыми
+void logic_cli_print_trace(uint32_t n);
+
+// гистограммы задержек CoAP RX -> реле по этапам (logic_lat.h); reset — обнулить после вывода
+void logic_cli_print_latency(bool reset);
+
+// отметка времени приёма: вызывать в начале обработчика CoAP, событие, отправленное
+// им в логику, несёт её в rx_us (этапы RX_ENQ и RX_RELAY)
+void logic_rx_stamp(void);
+
 typedef enum {
     LOGIC_PARSED_STATE_RSP,
     LOGIC_PARSED_TRIGGER,
@@ -49,17 +76,26 @@ typedef enum {
     LOGIC_PARSED_MODE,
 } logic_parsed_kind_t;
 
+// peer_addr — отправитель (источник trigger); owner state_rsp — из parsed->owner
 bool logic_post_parsed(logic_parsed_kind_t kind,
+                       uint8_t zone_id,
                        const rust_parsed_t *parsed,
                        const otIp6Address *peer_addr,
                        bool is_multicast);
 
-// собрать состояние зоны для ответов state_rsp
+// собрать состояние основной зоны для ответов state_rsp
 void logic_build_state(uint32_t *epoch,
                        otIp6Address *owner,
                        uint32_t *remaining_ms,
                        bool *active);
 
+// то же для любой зоны узла; false если зона не наша
+bool logic_build_zone_state(uint8_t zone_id,
+                            uint32_t *epoch,
+                            otIp6Address *owner,
+                            uint32_t *remaining_ms,
+                            bool *active);
+
 // принять state_rsp (multicast)
 void logic_on_state_response(uint32_t epoch,
                              const otIp6Address *owner,
@@ -80,11 +116,25 @@ void logic_on_trigger_rx(uint32_t epoch,
 void logic_on_off_rx(uint32_t epoch);
 
 
-void logic_post_state_response(uint32_t epoch, const otIp6Address *owner, uint32_t remaining_ms, bool active);
+void logic_post_state_response(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner, uint32_t remaining_ms, bool active);
+
+void logic_post_trigger_rx(uint8_t zone_id, uint32_t epoch, const otIp6Address *src, uint32_t hold_ms);
+
+void logic_post_off_rx(uint8_t zone_id, uint32_t epoch);
+
+// state_req от src: ответ state_rsp уйдёт отложенно (или будет подавлен), см. STATE_RSP_*
+void logic_post_state_req_rx(uint8_t zone_id, const otIp6Address *src);
+
+// запись зоны из Thread Network Data (netdata_if.c), поля как у state_rsp
+void logic_post_netdata_state(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner, uint32_t remaining_ms, bool active);
 
-void logic_post_trigger_rx(uint32_t epoch, const otIp6Address *src, uint32_t hold_ms);
+// узел в сети Thread (роль child/router) / вне сети (detached): в PENDING_RESTORE
+// запрос состояния, не ушедший из-за отсутствия сети, повторяется при attach
+void logic_post_thread_up(void);
+void logic_post_thread_down(void);
 
-void logic_post_off_rx(uint32_t epoch);
+// источник состояния зоны для наблюдателей zone/<id>/state (Observe)
+bool logic_zone_observable(uint8_t zone_id);
 
 
 void logic_post_mode_cmd_global(light_mode_t mode);
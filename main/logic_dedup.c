@@ -0,0 +1,99 @@
+#include "logic_dedup.h"
+
+#include <string.h>
+
+
+void logic_dedup_init(logic_dedup_t *d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+static uint32_t key_hash(uint8_t kind, uint8_t zone, uint32_t epoch, const otIp6Address *peer)
+{
+    // FNV-1a по IID (младшие 8 байт адреса — различаются у пиров одной mesh-local сети)
+    uint32_t h = 2166136261u;
+    for (int i = 8; i < 16; i++) {
+        h = (h ^ peer->mFields.m8[i]) * 16777619u;
+    }
+    h = (h ^ epoch) * 16777619u;
+    h = (h ^ ((uint32_t)zone << 8 | kind)) * 16777619u;
+    return h ^ (h >> 16);
+}
+
+static bool key_eq(const logic_dedup_entry_t *e, uint8_t kind, uint8_t zone, uint32_t epoch,
+                   const otIp6Address *peer)
+{
+    return e->valid && e->kind == kind && e->zone == zone && e->epoch == epoch &&
+           memcmp(e->peer.mFields.m8, peer->mFields.m8, 16) == 0;
+}
+
+static bool in_window(const logic_dedup_entry_t *e, int64_t now)
+{
+    int64_t delta_us = now - e->t_us;
+    return delta_us >= 0 && delta_us < LOGIC_DEDUP_WINDOW_US;
+}
+
+static logic_dedup_entry_t *find(logic_dedup_t *d, uint8_t kind, uint8_t zone, uint32_t epoch,
+                                 const otIp6Address *peer)
+{
+    logic_dedup_entry_t *set = d->sets[key_hash(kind, zone, epoch, peer) & (LOGIC_DEDUP_SETS - 1)];
+    for (int w = 0; w < LOGIC_DEDUP_WAYS; w++) {
+        if (key_eq(&set[w], kind, zone, epoch, peer)) {
+            return &set[w];
+        }
+    }
+    return NULL;
+}
+
+bool logic_dedup_is_duplicate(logic_dedup_t *d, logic_dedup_kind_t kind, uint8_t zone,
+                              uint32_t epoch, const otIp6Address *peer,
+                              uint32_t rem_ms, int64_t now)
+{
+    d->stats.lookups++;
+
+    logic_dedup_entry_t *e = find(d, (uint8_t)kind, zone, epoch, peer);
+    if (!e || !in_window(e, now)) {
+        return false;
+    }
+    uint32_t diff = (e->rem_ms > rem_ms) ? (e->rem_ms - rem_ms) : (rem_ms - e->rem_ms);
+    if (diff >= LOGIC_DEDUP_MIN_DIFF_MS) {
+        return false;
+    }
+    e->used = ++d->clock;
+    d->stats.hits++;
+    return true;
+}
+
+void logic_dedup_note(logic_dedup_t *d, logic_dedup_kind_t kind, uint8_t zone,
+                      uint32_t epoch, const otIp6Address *peer,
+                      uint32_t rem_ms, int64_t now)
+{
+    logic_dedup_entry_t *e = find(d, (uint8_t)kind, zone, epoch, peer);
+    if (!e) {
+        // свободная или вышедшая из окна запись, иначе — самая старая по LRU
+        logic_dedup_entry_t *set = d->sets[key_hash((uint8_t)kind, zone, epoch, peer) &
+                                           (LOGIC_DEDUP_SETS - 1)];
+        e = &set[0];
+        for (int w = 0; w < LOGIC_DEDUP_WAYS; w++) {
+            if (!set[w].valid || !in_window(&set[w], now)) {
+                e = &set[w];
+                break;
+            }
+            if ((int32_t)(set[w].used - e->used) < 0) {
+                e = &set[w];
+            }
+        }
+        if (e->valid && in_window(e, now)) {
+            d->stats.evictions++;
+        }
+        e->valid = true;
+        e->kind = (uint8_t)kind;
+        e->zone = zone;
+        e->epoch = epoch;
+        e->peer = *peer;
+        d->stats.inserts++;
+    }
+    e->rem_ms = rem_ms;
+    e->t_us = now;
+    e->used = ++d->clock;
+}
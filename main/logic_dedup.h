@@ -0,0 +1,68 @@
+#pragma once
+
+// Кэш дедупликации TRIGGER_RX / STATE_RSP по (kind, zone, epoch, peer).
+// Набор-ассоциативный LRU: хэш ключа -> набор из LOGIC_DEDUP_WAYS записей,
+// вытесняется давно не использованная (или уже вышедшая из окна) запись.
+// Правила те же, что у прежних слотов last_*: повтор = тот же ключ в пределах
+// окна LOGIC_DEDUP_WINDOW_US и rem_ms отличается меньше чем на LOGIC_DEDUP_MIN_DIFF_MS.
+// Без FreeRTOS и блокировок — кэш принадлежит logic_task.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <openthread/ip6.h>   // otIp6Address
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOGIC_DEDUP_WINDOW_US   (2 * 1000 * 1000)
+#define LOGIC_DEDUP_MIN_DIFF_MS 300
+
+#define LOGIC_DEDUP_SETS  8     // степень двойки
+#define LOGIC_DEDUP_WAYS  4
+
+typedef enum {
+    LOGIC_DEDUP_TRIGGER = 0,
+    LOGIC_DEDUP_STATE_RSP,
+} logic_dedup_kind_t;
+
+typedef struct {
+    otIp6Address peer;
+    uint32_t epoch;
+    uint32_t rem_ms;
+    int64_t t_us;
+    uint32_t used;        // отметка LRU
+    uint8_t kind;
+    uint8_t zone;
+    bool valid;
+} logic_dedup_entry_t;
+
+typedef struct {
+    uint32_t lookups;
+    uint32_t hits;        // отброшенные повторы
+    uint32_t inserts;
+    uint32_t evictions;   // вытеснена живая (в окне) запись
+} logic_dedup_stats_t;
+
+typedef struct {
+    logic_dedup_entry_t sets[LOGIC_DEDUP_SETS][LOGIC_DEDUP_WAYS];
+    uint32_t clock;
+    logic_dedup_stats_t stats;
+} logic_dedup_t;
+
+void logic_dedup_init(logic_dedup_t *d);
+
+// true = повтор уже принятого сообщения, его можно отбросить
+bool logic_dedup_is_duplicate(logic_dedup_t *d, logic_dedup_kind_t kind, uint8_t zone,
+                              uint32_t epoch, const otIp6Address *peer,
+                              uint32_t rem_ms, int64_t now);
+
+// запомнить принятое сообщение
+void logic_dedup_note(logic_dedup_t *d, logic_dedup_kind_t kind, uint8_t zone,
+                      uint32_t epoch, const otIp6Address *peer,
+                      uint32_t rem_ms, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
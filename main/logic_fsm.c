@@ -0,0 +1,1272 @@
+#include "logic_fsm.h"
+#include "config.h"
+#include "io_board.h"
+#include "rgb_led.h"
+#include "coap_if.h"
+#include "netdata_if.h"
+#include "config_store.h"
+
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static const char *TAG = "logic";
+
+// ===== NVS keys =====
+#define NVS_NS           "app"
+#define NVS_K_MODE       "mode"
+#define NVS_K_EPOCH      "epoch"
+#define NVS_K_ACTIVE     "active"
+#define NVS_K_DEADLINE   "deadline_us"
+#define NVS_K_OWNER_OK   "owner_ok"
+#define NVS_K_OWNER_ADDR "owner_addr"
+
+#define RESTORE_WAIT_MS  1200  // ждать state_rsp после ребута (strict)
+// то же, когда owner известен и спрашиваем его GET (CON): первая CoAP-ретрансмиссия —
+// через ACK_TIMEOUT 2 с * ACK_RANDOM_FACTOR до 1.5, ответ на неё должен успеть до таймаута,
+// иначе зона уйдёт в AutoIdle и поздний ответ снова включит реле
+#define RESTORE_GET_WAIT_MS 3500
+#define RESTORE_COLD_BOOT_TIMEOUT_US (3 * 60 * 1000 * 1000)
+#define NVS_DEBOUNCE_US  (5 * 1000 * 1000)
+
+// ===== NVS keys for MODE overrides (persistent) =====
+#define NVS_K_GMODE_VALID  "g_valid"
+#define NVS_K_GMODE        "g_mode"
+
+#define NVS_K_ZMODE_VALID  "z_valid"
+#define NVS_K_ZMODE_ZONE   "z_zone"
+#define NVS_K_ZMODE        "z_mode"
+
+#define NVS_K_NMODE_VALID  "n_valid"
+#define NVS_K_NMODE        "n_mode"
+
+
+static logic_clock_fn_t s_clock = esp_timer_get_time;
+
+void logic_fsm_set_clock(logic_clock_fn_t fn)
+{
+    s_clock = fn ? fn : esp_timer_get_time;
+}
+
+int64_t logic_fsm_now_us(void)
+{
+    return s_clock();
+}
+
+void logic_fsm_init_zones(logic_state_t *state, const uint8_t *zone_ids,
+                          const uint8_t *relay_ch, uint8_t count)
+{
+    state->zone_count = 0;
+    memset(state->zone_slot, 0, sizeof(state->zone_slot));
+    logic_tw_init(&state->timers, logic_fsm_now_us());
+    logic_timer_init(&state->t_nvs_flush, LOGIC_TMR_NVS_FLUSH, 0);
+    logic_dedup_init(&state->dedup);
+    memset(&state->rsp_stats, 0, sizeof(state->rsp_stats));
+    state->trigger_refresh_pct = TRIGGER_REFRESH_PCT;
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (state->zone_count >= LOGIC_MAX_ZONES) {
+            ESP_LOGW(TAG, "zone table full, skip zone %u", (unsigned)zone_ids[i]);
+            continue;
+        }
+        if (state->zone_slot[zone_ids[i]]) {
+            ESP_LOGW(TAG, "duplicate zone %u ignored", (unsigned)zone_ids[i]);
+            continue;
+        }
+        logic_zone_t *z = &state->zones[state->zone_count];
+        memset(z, 0, sizeof(*z));
+        z->zone_id = zone_ids[i];
+        z->relay_ch = relay_ch ? relay_ch[i] : i;
+        z->fsm = FSM_AUTO_IDLE;
+        logic_timer_init(&z->t_deadline, LOGIC_TMR_ZONE_DEADLINE, z->zone_id);
+        logic_timer_init(&z->t_restore_timeout, LOGIC_TMR_RESTORE_TIMEOUT, z->zone_id);
+        logic_timer_init(&z->t_state_rsp, LOGIC_TMR_STATE_RSP, z->zone_id);
+        logic_timer_init(&z->t_netdata, LOGIC_TMR_NETDATA, z->zone_id);
+        state->zone_count++;
+        state->zone_slot[z->zone_id] = state->zone_count;
+    }
+}
+
+logic_zone_t *logic_fsm_zone(logic_state_t *state, uint8_t zone_id)
+{
+    uint8_t slot = state->zone_slot[zone_id];
+    return slot ? &state->zones[slot - 1] : NULL;
+}
+
+static void set_relay(logic_zone_t *z, bool on)
+{
+    io_board_set_relay_ch(z->relay_ch, on);
+    z->zone.relay_on = on;
+}
+
+void logic_fsm_clear_active(logic_zone_t *z)
+{
+    z->zone.active = false;
+    z->zone.deadline_us = 0;
+    z->zone.owner_valid = false;
+    memset(&z->zone.owner_addr, 0, sizeof(z->zone.owner_addr));
+    z->zone.pending_restore = false;
+}
+
+static bool addr_eq(const otIp6Address *a, const otIp6Address *b)
+{
+    return memcmp(a->mFields.m8, b->mFields.m8, 16) == 0;
+}
+
+void logic_fsm_zone_report(const logic_zone_t *z, int64_t now, uint32_t *epoch,
+                           otIp6Address *owner, uint32_t *rem_ms, bool *active)
+{
+    *epoch = z->zone.epoch;
+    if (z->zone.owner_valid) {
+        *owner = z->zone.owner_addr;
+    } else {
+        memset(owner, 0, sizeof(*owner));
+    }
+
+    // если мы в strict-restore режиме — не утверждаем active наружу
+    if (z->zone.pending_restore) {
+        *active = false;
+        *rem_ms = 0;
+        return;
+    }
+
+    *active = z->zone.active;
+    if (z->zone.active && z->zone.deadline_us > now) {
+        *rem_ms = (uint32_t)((z->zone.deadline_us - now) / 1000);
+    } else {
+        *rem_ms = 0;
+    }
+}
+
+bool logic_fsm_is_owner(const logic_zone_t *z)
+{
+    if (!z->zone.owner_valid) return false;
+    otIp6Address me;
+    if (!coap_if_get_my_meshlocal_eid(&me)) return false;
+    return addr_eq(&me, &z->zone.owner_addr);
+}
+
+// доп. зоны хранятся одним blob на зону ("zone<id>"), основная — в старых ключах
+typedef struct {
+    uint32_t epoch;
+    int64_t deadline_us;
+    uint8_t owner[16];
+    uint8_t mode;
+    uint8_t active;
+    uint8_t owner_ok;
+    uint8_t z_valid;
+    uint8_t z_mode;
+} zone_nvs_rec_t;
+
+static void zone_nvs_key(const logic_zone_t *z, char *out, size_t n)
+{
+    snprintf(out, n, "zone%u", (unsigned)z->zone_id);
+}
+
+static void nvs_save_all(const logic_state_t *state)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+
+    const logic_zone_t *z0 = &state->zones[0];
+    nvs_set_u8(h, NVS_K_MODE, (uint8_t)z0->zone.mode);
+    nvs_set_u32(h, NVS_K_EPOCH, (uint32_t)z0->zone.epoch);
+    nvs_set_u8(h, NVS_K_ACTIVE, (uint8_t)(z0->zone.active ? 1 : 0));
+    nvs_set_i64(h, NVS_K_DEADLINE, (int64_t)z0->zone.deadline_us);
+    nvs_set_u8(h, NVS_K_OWNER_OK, (uint8_t)(z0->zone.owner_valid ? 1 : 0));
+    if (z0->zone.owner_valid) {
+        nvs_set_blob(h, NVS_K_OWNER_ADDR, z0->zone.owner_addr.mFields.m8, 16);
+    } else {
+        uint8_t z[16] = {0};
+        nvs_set_blob(h, NVS_K_OWNER_ADDR, z, 16);
+    }
+
+    // --- persist overrides ---
+    nvs_set_u8(h, NVS_K_GMODE_VALID, (uint8_t)(state->global_mode_valid ? 1 : 0));
+    nvs_set_u8(h, NVS_K_GMODE,       (uint8_t)state->global_mode);
+
+    nvs_set_u8(h, NVS_K_ZMODE_VALID, (uint8_t)(z0->zone_mode_valid ? 1 : 0));
+    nvs_set_u8(h, NVS_K_ZMODE_ZONE,  (uint8_t)z0->zone_id);
+    nvs_set_u8(h, NVS_K_ZMODE,       (uint8_t)z0->zone_mode);
+
+    nvs_set_u8(h, NVS_K_NMODE_VALID, (uint8_t)(state->node_mode_valid ? 1 : 0));
+    nvs_set_u8(h, NVS_K_NMODE,       (uint8_t)state->node_mode);
+
+    for (uint8_t i = 1; i < state->zone_count; i++) {
+        const logic_zone_t *z = &state->zones[i];
+        zone_nvs_rec_t rec = {
+            .epoch = z->zone.epoch,
+            .deadline_us = z->zone.deadline_us,
+            .mode = (uint8_t)z->zone.mode,
+            .active = z->zone.active ? 1 : 0,
+            .owner_ok = z->zone.owner_valid ? 1 : 0,
+            .z_valid = z->zone_mode_valid ? 1 : 0,
+            .z_mode = (uint8_t)z->zone_mode,
+        };
+        if (z->zone.owner_valid) {
+            memcpy(rec.owner, z->zone.owner_addr.mFields.m8, 16);
+        }
+        char key[12];
+        zone_nvs_key(z, key, sizeof(key));
+        nvs_set_blob(h, key, &rec, sizeof(rec));
+    }
+
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+light_mode_t logic_fsm_effective_mode(const logic_state_t *state, const logic_zone_t *z)
+{
+#if ROLE_CONTROLLER
+    (void)state;
+    (void)z;
+    return io_board_read_mode_switch();   // контроллер главный
+#else
+    if (state->node_mode_valid) return state->node_mode;
+    if (z->zone_mode_valid) return z->zone_mode;
+    if (state->global_mode_valid) return state->global_mode;
+    return z->zone.mode;                      // локальный режим (NVS/CLI)
+#endif
+}
+
+#define STATE_NAME(id, name) [id] = name,
+static const char *const s_state_names[FSM_STATE_COUNT] = {
+    LOGIC_FSM_STATES(STATE_NAME)
+};
+
+#define EVENT_NAME(a, id, name, scope, node_fn, zone_fn, states) [id] = name,
+static const char *const s_event_names[EVT_COUNT] = {
+    LOGIC_FSM_EVENTS(EVENT_NAME, _)
+};
+
+const char *logic_fsm_state_name(fsm_state_t state)
+{
+    return ((unsigned)state < FSM_STATE_COUNT) ? s_state_names[state] : "Unknown";
+}
+
+const char *logic_fsm_event_name(logic_evt_type_t event)
+{
+    return ((unsigned)event < EVT_COUNT) ? s_event_names[event] : "UNKNOWN";
+}
+
+fsm_state_t logic_fsm_from_state(const logic_state_t *state, const logic_zone_t *z, int64_t now)
+{
+    light_mode_t mode = logic_fsm_effective_mode(state, z);
+    if (mode == MODE_OFF) {
+        return FSM_MANUAL_OFF;
+    }
+    if (mode == MODE_ON) {
+        return FSM_MANUAL_ON;
+    }
+    if (z->zone.pending_restore) {
+        return FSM_PENDING_RESTORE;
+    }
+    if (z->zone.active && z->zone.deadline_us > now) {
+        return FSM_AUTO_ACTIVE;
+    }
+    return FSM_AUTO_IDLE;
+}
+
+static void fsm_sync(const logic_state_t *state, logic_zone_t *z, int64_t now)
+{
+    light_mode_t mode = logic_fsm_effective_mode(state, z);
+    if (mode == MODE_OFF || mode == MODE_ON) {
+        logic_fsm_clear_active(z);
+    }
+    z->fsm = logic_fsm_from_state(state, z, now);
+}
+
+// взвести/снять таймер; перевзвод только если срок изменился
+static void timer_arm(logic_tw_t *tw, logic_timer_t *t, bool want, int64_t at_us)
+{
+    if (!want || at_us <= 0) {
+        logic_tw_cancel(tw, t);
+        return;
+    }
+    if (t->armed && t->expires_us == at_us) {
+        return;
+    }
+    logic_tw_add(tw, t, at_us);
+}
+
+// Таймеры зоны повторяют её поля; сроки "строго больше" (now > deadline) -> +1 us.
+static void zone_timers_sync(logic_state_t *state, logic_zone_t *z)
+{
+    bool pending = z->zone.pending_restore;
+    timer_arm(&state->timers, &z->t_deadline,
+              z->fsm == FSM_AUTO_ACTIVE && z->zone.active && z->zone.deadline_us,
+              z->zone.deadline_us + 1);
+    timer_arm(&state->timers, &z->t_restore_timeout, pending && z->restore_deadline_us,
+              z->restore_deadline_us + 1);
+    timer_arm(&state->timers, &z->t_state_rsp, z->state_rsp_due_us != 0, z->state_rsp_due_us);
+    timer_arm(&state->timers, &z->t_netdata, z->nd_due_us != 0, z->nd_due_us);
+}
+
+static void zone_timers_sync_all(logic_state_t *state)
+{
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        zone_timers_sync(state, &state->zones[i]);
+    }
+}
+
+static void set_transition_action(fsm_zone_actions_t *za,
+                                  fsm_state_t from_state,
+                                  fsm_state_t to_state)
+{
+    if (from_state == to_state) {
+        return;
+    }
+    za->log_transition = true;
+    za->from_state = from_state;
+    za->to_state = to_state;
+}
+
+static bool rx_duplicate(logic_state_t *state, logic_dedup_kind_t kind, const logic_zone_t *z,
+                         const logic_evt_t *event, int64_t now)
+{
+    return logic_dedup_is_duplicate(&state->dedup, kind, z->zone_id, event->epoch,
+                                    &event->addr, event->u32, now);
+}
+
+static void rx_note(logic_state_t *state, logic_dedup_kind_t kind, const logic_zone_t *z,
+                    const logic_evt_t *event, int64_t now)
+{
+    logic_dedup_note(&state->dedup, kind, z->zone_id, event->epoch, &event->addr, event->u32, now);
+}
+
+// ===== обработчики зоны (таблица s_dispatch) и узла (s_event_spec) =====
+
+typedef void (*fsm_zone_fn_t)(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                              int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions);
+// false = событие поглощено на уровне узла, зоны не обрабатываются
+typedef bool (*fsm_node_fn_t)(logic_state_t *state, const logic_evt_t *event, int64_t now,
+                              fsm_actions_t *actions);
+
+// Размер зоны — линейный счёт (linear counting) по 64 битам: пир ставит бит хэша своего
+// адреса, n ~ -64 * ln(доля нулевых бит). Пиры — отправители state_req и trigger.
+static void zone_note_peer(logic_zone_t *z, const otIp6Address *peer)
+{
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (int i = 0; i < 16; i++) {
+        h = (h ^ peer->mFields.m8[i]) * 16777619u;
+    }
+    z->peer_bits |= 1ull << ((h ^ (h >> 16)) & 63);
+}
+
+static uint32_t zone_peers_est(const logic_zone_t *z)
+{
+    int zeros = 64 - __builtin_popcountll(z->peer_bits);
+    if (zeros == 0) {
+        return UINT32_MAX;   // насыщено — окно упрётся в STATE_RSP_WINDOW_MAX_MS
+    }
+    return (uint32_t)lroundf(64.0f * logf(64.0f / (float)zeros));
+}
+
+static uint32_t state_rsp_window_ms(const logic_zone_t *z)
+{
+    uint32_t peers = zone_peers_est(z);
+    uint32_t window = (peers >= STATE_RSP_WINDOW_MAX_MS / STATE_RSP_SLOT_MS)
+                          ? STATE_RSP_WINDOW_MAX_MS
+                          : (peers + 1) * STATE_RSP_SLOT_MS;   // + сам узел
+    return window < STATE_RSP_WINDOW_MIN_MS ? STATE_RSP_WINDOW_MIN_MS : window;
+}
+
+// state_req: ответ не сразу, а через случайную задержку в окне по размеру зоны, чтобы
+// после общего включения питания зона не отвечала хором. Зона в PendingRestore сама
+// ждёт state_rsp — её состоянию верить нельзя, не отвечает.
+static void h_state_req_rx(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                           int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    zone_note_peer(z, &event->addr);
+    state->rsp_stats.requests++;
+    if (z->zone.pending_restore || z->state_rsp_due_us) {
+        return;
+    }
+    uint32_t delay_ms = esp_random() % state_rsp_window_ms(z);
+    z->state_rsp_due_us = now + (int64_t)delay_ms * 1000 + 1;
+}
+
+static void h_state_rsp(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                        int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    // чужой ответ не старее нашего уже услышали все — свой отложенный не нужен
+    // (как подавление MLD report); сравнение до того, как примем его epoch
+    if (z->state_rsp_due_us && event->epoch >= z->zone.epoch) {
+        z->state_rsp_due_us = 0;
+        state->rsp_stats.suppressed++;
+    }
+
+    if (rx_duplicate(state, LOGIC_DEDUP_STATE_RSP, z, event, now)) {
+        ESP_LOGD(TAG, "RX state_rsp duplicate ignored zone=%u epoch=%lu rem_ms=%lu",
+                 (unsigned)z->zone_id, (unsigned long)event->epoch, (unsigned long)event->u32);
+        return;
+    }
+
+    if (event->epoch < z->zone.epoch && !z->zone.pending_restore) {
+        return;
+    }
+    if (event->epoch == z->zone.epoch && z->zone.owner_valid) {
+        if (!addr_eq(&event->addr, &z->zone.owner_addr)) {
+            return;
+        }
+    }
+
+    int64_t cand_deadline_us = 0;
+    if (event->b && event->u32 > 0) {
+        cand_deadline_us = now + (int64_t)event->u32 * 1000;
+    }
+
+    bool accept = false;
+    if (event->epoch > z->zone.epoch) {
+        accept = true;
+    } else if (z->zone.pending_restore) {
+        accept = true;
+    } else if (event->b && event->u32 > 0) {
+        if (!z->zone.active) {
+            accept = true;
+        } else if (cand_deadline_us < z->zone.deadline_us - 300 * 1000) {
+            accept = true;
+        }
+    }
+    if (!accept) {
+        return;
+    }
+
+    z->zone.epoch = event->epoch;
+    z->zone.owner_addr = event->addr;
+    z->zone.owner_valid = true;
+
+    if (event->b && event->u32 > 0) {
+        z->zone.active = true;
+        z->zone.deadline_us = cand_deadline_us;
+        z->zone.pending_restore = false;
+    } else {
+        logic_fsm_clear_active(z);
+    }
+
+    actions->save_nvs = true;
+    rx_note(state, LOGIC_DEDUP_STATE_RSP, z, event, now);
+    fsm_sync(state, z, now);
+}
+
+// Запись зоны из Network Data. В PendingRestore — как state_rsp: состояние есть сразу
+// после attach, без state_req. Вне restore живой трафик зоны новее записи (её обновляют
+// не чаще NETDATA_MIN_INTERVAL_MS), из неё берём только снятие: owner опубликовал
+// active=0 для нашего epoch, а его off до нас не дошёл.
+static void h_netdata_state(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                            int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    if (z->zone.pending_restore) {
+        h_state_rsp(state, z, event, now, za, actions);
+        return;
+    }
+    if (event->b || !z->zone.active || event->epoch != z->zone.epoch ||
+        !z->zone.owner_valid || !addr_eq(&event->addr, &z->zone.owner_addr)) {
+        return;
+    }
+    logic_fsm_clear_active(z);
+    actions->save_nvs = true;
+    fsm_sync(state, z, now);
+}
+
+static void h_trigger_rx(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                         int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    zone_note_peer(z, &event->addr);
+
+    if (rx_duplicate(state, LOGIC_DEDUP_TRIGGER, z, event, now)) {
+        ESP_LOGD(TAG, "RX trigger duplicate ignored zone=%u epoch=%lu rem_ms=%lu",
+                 (unsigned)z->zone_id, (unsigned long)event->epoch, (unsigned long)event->u32);
+        return;
+    }
+
+    if (event->epoch < z->zone.epoch && !z->zone.pending_restore) {
+        return;
+    }
+    if (event->epoch == z->zone.epoch && z->zone.owner_valid) {
+        if (!addr_eq(&event->addr, &z->zone.owner_addr)) {
+            return;
+        }
+    }
+
+    // тот же epoch: повтор (сдвиг меньше 300 мс) не трогаем; продление от owner'а
+    // (trigger_refresh_pct) и укорочение принимаем
+    int64_t new_deadline_us = now + (int64_t)event->u32 * 1000;
+    if (event->epoch == z->zone.epoch && z->zone.active) {
+        int64_t shift = new_deadline_us - z->zone.deadline_us;
+        if (shift < 300 * 1000 && shift > -300 * 1000) {
+            return;
+        }
+    }
+
+    z->zone.epoch = event->epoch;
+    z->zone.owner_addr = event->addr;
+    z->zone.owner_valid = true;
+    z->zone.active = true;
+    z->zone.deadline_us = new_deadline_us;
+    z->zone.pending_restore = false;
+    actions->save_nvs = true;
+    rx_note(state, LOGIC_DEDUP_TRIGGER, z, event, now);
+    fsm_sync(state, z, now);
+}
+
+static void h_local_trigger(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                            int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    // частоту ограничивает input task (LOCAL_TRIGGER_MIN_INTERVAL_US);
+    // ручные состояния отсекает таблица, здесь — контроллер (тумблер читается вживую)
+    if (logic_fsm_effective_mode(state, z) != MODE_AUTO) {
+        return;
+    }
+    if (event->u32) {
+        z->zone.dist_cm = (uint16_t)event->u32;
+    }
+
+    otIp6Address me;
+    if (!coap_if_get_my_meshlocal_eid(&me)) {
+        return;
+    }
+
+    // в pending_restore локальный сенсор "истина": становимся owner
+    bool force_new_owner = event->b || z->zone.pending_restore;
+    bool new_epoch = false;
+    if (force_new_owner || !z->zone.active || !z->zone.owner_valid ||
+        !addr_eq(&me, &z->zone.owner_addr)) {
+        z->zone.epoch += 1;
+        z->zone.owner_addr = me;
+        z->zone.owner_valid = true;
+        new_epoch = true;
+    }
+
+    int64_t hold_us = (int64_t)config_store_get()->auto_hold_ms * 1000;
+    z->zone.active = true;
+    z->zone.pending_restore = false;
+    z->zone.last_motion_us = now;
+    z->zone.deadline_us = now + hold_us;
+    actions->save_nvs = true;
+
+    // продление — молча, пока у узлов зоны от разосланного удержания остаётся не меньше
+    // trigger_refresh_pct % (TRIGGER_REFRESH_PCT)
+    int64_t sent_rem_us = z->trig_sent_deadline_us - now;
+    if (z->zone.deadline_us > now &&
+        (new_epoch || sent_rem_us * 100 < hold_us * state->trigger_refresh_pct)) {
+        za->send_trigger = true;
+        za->trigger_rem_ms = (uint32_t)((z->zone.deadline_us - now) / 1000);
+        z->trig_sent_deadline_us = z->zone.deadline_us;
+    }
+
+    fsm_sync(state, z, now);
+}
+
+static void zone_relay(const logic_zone_t *z, fsm_zone_actions_t *za)
+{
+    za->set_relay = true;
+    switch (z->fsm) {
+        case FSM_MANUAL_ON:
+        case FSM_AUTO_ACTIVE:
+            za->relay_on = true;
+            break;
+        case FSM_MANUAL_OFF:
+        case FSM_AUTO_IDLE:
+        case FSM_PENDING_RESTORE:
+        default:
+            za->relay_on = false;
+            break;
+    }
+}
+
+static void h_relay(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                    int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    zone_relay(z, za);
+}
+
+static void h_timer(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                    int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    switch ((logic_timer_kind_t)event->u32) {
+        case LOGIC_TMR_RESTORE_TIMEOUT:
+            if (z->zone.pending_restore && z->restore_deadline_us &&
+                now > z->restore_deadline_us) {
+                logic_fsm_clear_active(z);
+                z->zone.pending_restore = false;
+                actions->flush_nvs_now = true;
+                fsm_sync(state, z, now);
+            }
+            break;
+
+        case LOGIC_TMR_ZONE_DEADLINE:
+            if (z->fsm == FSM_AUTO_ACTIVE && z->zone.active &&
+                z->zone.deadline_us && now > z->zone.deadline_us) {
+                if (logic_fsm_is_owner(z)) {
+                    za->send_off = true;
+                    za->off_epoch = z->zone.epoch;
+                }
+                logic_fsm_clear_active(z);
+                actions->save_nvs = true;
+                fsm_sync(state, z, now);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    zone_relay(z, za);
+}
+
+static void h_off_rx(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                     int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    if (event->epoch != z->zone.epoch) {
+        return;
+    }
+    logic_fsm_clear_active(z);
+    actions->save_nvs = true;
+    fsm_sync(state, z, now);
+}
+
+static void h_mode_sync(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                        int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    fsm_sync(state, z, now);
+}
+
+static void h_mode_set_zone(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                            int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    z->zone_mode_valid = true;
+    z->zone_mode = (light_mode_t)(event->u32 & 0xFF);
+    actions->update_led = true;
+    actions->save_nvs = true;
+    fsm_sync(state, z, now);
+}
+
+static void h_mode_clr_zone(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                            int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    if (!z->zone_mode_valid) {
+        return;
+    }
+    z->zone_mode_valid = false;
+    actions->update_led = true;
+    actions->save_nvs = true;
+    fsm_sync(state, z, now);
+}
+
+static void h_local_mode(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                         int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    light_mode_t mode = (light_mode_t)(event->u32 & 0xFF);
+    if (mode > MODE_AUTO) {
+        mode = MODE_AUTO;
+    }
+    if (z->zone.mode == mode) {
+        return;
+    }
+    z->zone.mode = mode;
+    actions->update_led = true;
+    actions->save_nvs = true;
+    if (mode != MODE_AUTO) {
+        logic_fsm_clear_active(z);
+    } else {
+        za->send_state_req = true;
+    }
+    fsm_sync(state, z, now);
+}
+
+// strict restore спрашивает owner напрямую (GET state), если он известен и это не мы
+static bool restore_via_get(const logic_zone_t *z)
+{
+    otIp6Address me;
+    return z->zone.pending_restore && z->zone.owner_valid &&
+           !(coap_if_get_my_meshlocal_eid(&me) &&
+             memcmp(&me, &z->zone.owner_addr, sizeof(me)) == 0);
+}
+
+static void h_enter_pending(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                            int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    z->zone.pending_restore = true;
+    z->restore_deadline_us = now + (int64_t)(restore_via_get(z) ? RESTORE_GET_WAIT_MS
+                                                                 : RESTORE_WAIT_MS) * 1000;
+    za->send_state_req = true;
+    fsm_sync(state, z, now);
+}
+
+static void h_cold_boot(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                        int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    logic_fsm_clear_active(z);
+    z->zone.pending_restore = true;
+    z->restore_deadline_us = now + RESTORE_COLD_BOOT_TIMEOUT_US;
+    za->send_state_req = true;
+    fsm_sync(state, z, now);
+}
+
+// запрос state_req не повторяется по таймеру (GET — CON с ретрансмиссией CoAP, multicast
+// state_req отвечают все знающие); повтор — когда узел снова в сети, если прежний запрос
+// не ушёл (нет сети при входе) или сеть пропадала, пока ждали ответа
+static void h_thread_up(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                        int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    if (z->req_on_attach) {
+        za->send_state_req = true;
+    }
+}
+
+static void h_thread_down(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                          int64_t now, fsm_zone_actions_t *za, fsm_actions_t *actions)
+{
+    z->req_on_attach = true;
+}
+
+static bool n_mode_set_global(logic_state_t *state, const logic_evt_t *event, int64_t now,
+                              fsm_actions_t *actions)
+{
+    state->global_mode_valid = true;
+    state->global_mode = (light_mode_t)(event->u32 & 0xFF);
+    actions->update_led = true;
+    actions->save_nvs = true;
+    return true;
+}
+
+static bool n_mode_set_node(logic_state_t *state, const logic_evt_t *event, int64_t now,
+                            fsm_actions_t *actions)
+{
+    state->node_mode_valid = true;
+    state->node_mode = (light_mode_t)(event->u32 & 0xFF);
+    actions->update_led = true;
+    actions->save_nvs = true;
+    return true;
+}
+
+static bool n_mode_clr_global(logic_state_t *state, const logic_evt_t *event, int64_t now,
+                              fsm_actions_t *actions)
+{
+    state->global_mode_valid = false;
+    actions->update_led = true;
+    actions->save_nvs = true;
+    return true;
+}
+
+static bool n_mode_clr_node(logic_state_t *state, const logic_evt_t *event, int64_t now,
+                            fsm_actions_t *actions)
+{
+    state->node_mode_valid = false;
+    actions->update_led = true;
+    actions->save_nvs = true;
+    return true;
+}
+
+static bool n_cold_boot(logic_state_t *state, const logic_evt_t *event, int64_t now,
+                        fsm_actions_t *actions)
+{
+    actions->flush_nvs_now = true;
+    return true;
+}
+
+// таймер записи NVS — на весь узел, таймеры зон (кроме state_rsp и netdata) идут в таблицу
+static bool n_timer(logic_state_t *state, const logic_evt_t *event, int64_t now,
+                    fsm_actions_t *actions)
+{
+    // ответ на state_req — в любом состоянии зоны, мимо таблицы
+    if (event->u32 == LOGIC_TMR_STATE_RSP) {
+        logic_zone_t *z = logic_fsm_zone(state, event->zone);
+        if (z && z->state_rsp_due_us && now >= z->state_rsp_due_us) {
+            z->state_rsp_due_us = 0;
+            actions->zone[z - state->zones].send_state_rsp = true;
+            state->rsp_stats.sent++;
+        }
+        return false;
+    }
+    // обновление Network Data планирует netdata_plan_all() в конце шага
+    if (event->u32 == LOGIC_TMR_NETDATA) {
+        return false;
+    }
+    if (event->u32 != LOGIC_TMR_NVS_FLUSH) {
+        return true;
+    }
+    if (state->nvs_dirty && state->nvs_next_flush_us &&
+        (uint64_t)now >= state->nvs_next_flush_us) {
+        actions->flush_nvs_now = true;
+    }
+    return false;
+}
+
+// Своя запись зоны в Network Data: active=1, пока зона AutoActive и owner — мы; после
+// снятия — active=0 с тем же epoch (restore увидит, что зона погасла), пока зону не
+// перехватит новый epoch, тогда запись снимается. Продление удержания (тот же epoch) не
+// публикуется. Каждое изменение лидер рассылает всей сети, поэтому не чаще
+// NETDATA_MIN_INTERVAL_MS на зону (иначе — отложенно, LOGIC_TMR_NETDATA) и не больше
+// NETDATA_MAX_RECORDS записей с узла (лишние зоны restore получат через state_req).
+static void netdata_plan(logic_zone_t *z, int64_t now, fsm_zone_actions_t *za, uint8_t *records)
+{
+    bool active = z->fsm == FSM_AUTO_ACTIVE && logic_fsm_is_owner(z);
+    bool want = active || (z->nd_published && z->zone.epoch == z->nd_epoch);
+    bool same = want ? (z->nd_published && z->nd_epoch == z->zone.epoch && z->nd_active == active)
+                     : !z->nd_published;
+
+    z->nd_due_us = 0;
+    if (same) {
+        return;
+    }
+    if (want && !z->nd_published && *records >= NETDATA_MAX_RECORDS) {
+        return;
+    }
+    if (now < z->nd_next_us) {
+        z->nd_due_us = z->nd_next_us;
+        return;
+    }
+    if (want && !z->nd_published) {
+        (*records)++;
+    }
+    za->netdata_update = true;
+    za->netdata_publish = want;
+    za->netdata_active = active;
+}
+
+static void netdata_plan_all(logic_state_t *state, int64_t now, fsm_actions_t *actions)
+{
+    uint8_t records = 0;
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        records += state->zones[i].nd_published ? 1 : 0;
+    }
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        netdata_plan(&state->zones[i], now, &actions->zone[i], &records);
+    }
+}
+
+// Наблюдатели zone/<id>/state (RFC 7641) — у источника состояния зоны: owner своего
+// epoch'а, и после снятия/ручного режима, пока epoch тот же. Уведомление — при смене
+// epoch/active и при сдвиге deadline не меньше чем на COAP_OBS_DEADLINE_STEP_MS (мелкие
+// продления наблюдатель досчитает по rem_ms). Чужой новый epoch или PendingRestore —
+// последнее уведомление без Observe, наблюдатели уходят к новому owner'у.
+static void observe_plan(logic_zone_t *z, fsm_zone_actions_t *za)
+{
+    bool source = !z->zone.pending_restore &&
+                  (logic_fsm_is_owner(z) || (z->obs_source && z->zone.epoch == z->obs_epoch));
+    if (!source) {
+        if (z->obs_source) {
+            z->obs_source = false;
+            za->notify_state = true;
+            za->notify_final = true;
+        }
+        return;
+    }
+
+    int64_t step = (int64_t)COAP_OBS_DEADLINE_STEP_MS * 1000;
+    int64_t moved = z->zone.deadline_us - z->obs_deadline_us;
+    if (z->obs_source && z->obs_epoch == z->zone.epoch && z->obs_active == z->zone.active &&
+        moved < step && moved > -step) {
+        return;
+    }
+    z->obs_source = true;
+    z->obs_epoch = z->zone.epoch;
+    z->obs_active = z->zone.active;
+    z->obs_deadline_us = z->zone.deadline_us;
+    za->notify_state = true;
+}
+
+static void netdata_apply(logic_state_t *state, logic_zone_t *z, const fsm_zone_actions_t *za,
+                          int64_t now)
+{
+    bool ok;
+    if (za->netdata_publish) {
+        // публикует только owner epoch'а; после снятия owner_valid сброшен, а в записи
+        // active=0 он нужен, чтобы зоны сверили, чей это epoch
+        uint32_t epoch = 0;
+        uint32_t rem_ms = 0;
+        bool active = false;
+        otIp6Address owner;
+        otIp6Address me;
+        logic_fsm_zone_report(z, now, &epoch, &owner, &rem_ms, &active);
+        ok = coap_if_get_my_meshlocal_eid(&me) &&
+             netdata_if_publish(z->zone_id, epoch, &me, za->netdata_active ? rem_ms : 0,
+                                za->netdata_active);
+    } else {
+        ok = netdata_if_withdraw(z->zone_id);
+    }
+
+    // netdata_if_* — синхронно под своим lock OpenThread, мимо outbox (см. netdata_if.h)
+    // неудача (Thread не готов, нет места) считается попыткой: повтор через интервал
+    z->nd_next_us = now + (int64_t)NETDATA_MIN_INTERVAL_MS * 1000;
+    if (ok) {
+        z->nd_published = za->netdata_publish;
+        z->nd_epoch = z->zone.epoch;
+        z->nd_active = za->netdata_active;
+    } else {
+        z->nd_due_us = z->nd_next_us;
+    }
+    timer_arm(&state->timers, &z->t_netdata, z->nd_due_us != 0, z->nd_due_us);
+}
+
+// ===== таблицы из logic_fsm_spec.h =====
+
+typedef enum {
+    FSM_SCOPE_ZONE,
+    FSM_SCOPE_MODE_ZONE,
+    FSM_SCOPE_NODE,
+} fsm_scope_t;
+
+typedef struct {
+    fsm_scope_t scope;
+    fsm_node_fn_t node_fn;
+} fsm_event_spec_t;
+
+#define EVENT_SPEC(a, id, name, scope, node_fn, zone_fn, states) \
+    [id] = {FSM_SCOPE_##scope, node_fn},
+static const fsm_event_spec_t s_event_spec[EVT_COUNT] = {
+    LOGIC_FSM_EVENTS(EVENT_SPEC, _)
+};
+
+#define DISPATCH_CELL(s, id, name, scope, node_fn, zone_fn, states) \
+    [id] = (((states) & FSM_S(s)) ? zone_fn : NULL),
+#define DISPATCH_ROW(s, name) [s] = { LOGIC_FSM_EVENTS(DISPATCH_CELL, s) },
+static const fsm_zone_fn_t s_dispatch[FSM_STATE_COUNT][EVT_COUNT] = {
+    LOGIC_FSM_STATES(DISPATCH_ROW)
+};
+
+#define SPEC_TO(from, ev, to) [from][ev] = (uint8_t)(to),
+static const uint8_t s_spec_to[FSM_STATE_COUNT][EVT_COUNT] = {
+    LOGIC_FSM_TRANSITIONS(SPEC_TO)
+};
+
+#if LOGIC_FSM_COVERAGE
+static uint32_t s_cov_hits[FSM_STATE_COUNT][EVT_COUNT];
+static uint8_t s_cov_to[FSM_STATE_COUNT][EVT_COUNT];
+
+void logic_fsm_coverage_reset(void)
+{
+    memset(s_cov_hits, 0, sizeof(s_cov_hits));
+    memset(s_cov_to, 0, sizeof(s_cov_to));
+}
+
+uint32_t logic_fsm_coverage_hits(fsm_state_t from, logic_evt_type_t event)
+{
+    return s_cov_hits[from][event];
+}
+
+uint8_t logic_fsm_coverage_to(fsm_state_t from, logic_evt_type_t event)
+{
+    return s_cov_to[from][event];
+}
+#endif
+
+bool logic_fsm_spec_handled(fsm_state_t from, logic_evt_type_t event)
+{
+    return s_dispatch[from][event] != NULL;
+}
+
+uint8_t logic_fsm_spec_to(fsm_state_t from, logic_evt_type_t event)
+{
+    return s_spec_to[from][event];
+}
+
+// MODE_SET_ZONE: u32 = zone << 8 | mode; MODE_CLR_ZONE: u32 = zone
+static uint8_t mode_zone_id(const logic_evt_t *event)
+{
+    return (event->type == EVT_MODE_SET_ZONE) ? (uint8_t)((event->u32 >> 8) & 0xFF)
+                                              : (uint8_t)(event->u32 & 0xFF);
+}
+
+static void dispatch_zone(logic_state_t *state, logic_zone_t *z, const logic_evt_t *event,
+                          int64_t now, fsm_actions_t *actions)
+{
+    fsm_state_t from = z->fsm;
+    fsm_zone_fn_t fn = s_dispatch[from][event->type];
+    if (!fn) {
+        return;
+    }
+    fn(state, z, event, now, &actions->zone[z - state->zones], actions);
+#if LOGIC_FSM_COVERAGE
+    s_cov_hits[from][event->type]++;
+    s_cov_to[from][event->type] |= (uint8_t)FSM_S(z->fsm);
+#endif
+}
+
+fsm_actions_t logic_fsm_step(logic_state_t *state, const logic_evt_t *event, int64_t now)
+{
+    fsm_actions_t actions = {0};
+    fsm_state_t prev_state[LOGIC_MAX_ZONES];
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        prev_state[i] = state->zones[i].fsm;
+    }
+    actions.event = event->type;
+    if ((unsigned)event->type >= EVT_COUNT) {
+        return actions;
+    }
+
+    const fsm_event_spec_t *es = &s_event_spec[event->type];
+    if (!es->node_fn || es->node_fn(state, event, now, &actions)) {
+        if (es->scope == FSM_SCOPE_NODE) {
+            for (uint8_t i = 0; i < state->zone_count; i++) {
+                dispatch_zone(state, &state->zones[i], event, now, &actions);
+            }
+        } else {
+            uint8_t zone_id = (es->scope == FSM_SCOPE_MODE_ZONE) ? mode_zone_id(event) : event->zone;
+            logic_zone_t *z = logic_fsm_zone(state, zone_id);
+            if (z) {
+                dispatch_zone(state, z, event, now, &actions);
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        set_transition_action(&actions.zone[i], prev_state[i], state->zones[i].fsm);
+    }
+    netdata_plan_all(state, now, &actions);
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        observe_plan(&state->zones[i], &actions.zone[i]);
+    }
+    zone_timers_sync_all(state);
+    return actions;
+}
+
+void logic_fsm_apply_actions(logic_state_t *state, const fsm_actions_t *actions)
+{
+    uint64_t now_us = (uint64_t)logic_fsm_now_us();
+
+    if (actions->update_led) {
+        rgb_set_mode_color(logic_fsm_effective_mode(state, &state->zones[0]));
+    }
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        logic_zone_t *z = &state->zones[i];
+        const fsm_zone_actions_t *za = &actions->zone[i];
+
+        if (za->set_relay) {
+            set_relay(z, za->relay_on);
+        }
+        if (za->send_state_req) {
+            z->req_on_attach = !coap_if_thread_ready();
+        }
+        if (za->send_state_req && coap_if_thread_ready()) {
+            // strict restore: owner из NVS известен — спросить его напрямую (GET state, CON)
+            if (restore_via_get(z)) {
+                coap_if_get_state(z->zone_id, &z->zone.owner_addr);
+            } else {
+                coap_if_send_state_req(z->zone_id);
+            }
+        }
+        if (za->send_state_rsp && coap_if_thread_ready()) {
+            uint32_t epoch = 0;
+            uint32_t rem_ms = 0;
+            bool active = false;
+            otIp6Address owner;
+            logic_fsm_zone_report(z, (int64_t)now_us, &epoch, &owner, &rem_ms, &active);
+            coap_if_send_state_rsp(z->zone_id, epoch, &owner, rem_ms, active);
+        }
+        if (za->send_trigger) {
+            coap_if_send_trigger(z->zone_id, z->zone.epoch, za->trigger_rem_ms);
+        }
+        if (za->send_off) {
+            coap_if_send_off(z->zone_id, za->off_epoch);
+        }
+        if (za->netdata_update) {
+            netdata_apply(state, z, za, (int64_t)now_us);
+        }
+        if (za->notify_state) {
+            uint32_t epoch = 0;
+            uint32_t rem_ms = 0;
+            bool active = false;
+            otIp6Address owner;
+            logic_fsm_zone_report(z, (int64_t)now_us, &epoch, &owner, &rem_ms, &active);
+            coap_if_notify_state(z->zone_id, epoch, &owner, rem_ms, active, za->notify_final);
+        }
+        if (za->log_transition) {
+            ESP_LOGI(TAG, "FSM zone %u %s -> %s on %s",
+                     (unsigned)z->zone_id,
+                     logic_fsm_state_name(za->from_state),
+                     logic_fsm_state_name(za->to_state),
+                     logic_fsm_event_name(actions->event));
+        }
+    }
+    if (actions->flush_nvs_now) {
+        ESP_LOGI(TAG, "NVS flush");
+        nvs_save_all(state);
+        state->nvs_dirty = false;
+        state->nvs_next_flush_us = 0;
+    } else if (actions->save_nvs) {
+        if (!state->nvs_dirty) {
+            state->nvs_dirty = true;
+            state->nvs_next_flush_us = now_us + NVS_DEBOUNCE_US;
+            ESP_LOGI(TAG, "NVS dirty, schedule flush in %lu ms",
+                     (unsigned long)(NVS_DEBOUNCE_US / 1000));
+        } else {
+            state->nvs_next_flush_us = now_us + NVS_DEBOUNCE_US;
+        }
+    }
+    timer_arm(&state->timers, &state->t_nvs_flush, state->nvs_dirty,
+              (int64_t)state->nvs_next_flush_us);
+}
+
+static void zone_apply_loaded(logic_zone_t *z, uint8_t mode, uint32_t epoch, uint8_t active,
+                              int64_t deadline_us, uint8_t owner_ok, const uint8_t *owner,
+                              light_mode_t def_mode)
+{
+    if (mode > MODE_AUTO) mode = (uint8_t)def_mode;
+
+    z->zone.mode = (light_mode_t)mode;
+    z->zone.epoch = epoch;
+    z->zone.active = (active != 0);
+    z->zone.deadline_us = deadline_us;
+    z->zone.owner_valid = (owner_ok != 0);
+    memcpy(z->zone.owner_addr.mFields.m8, owner, 16);
+    z->zone.pending_restore = false;
+
+    ESP_LOGI(TAG, "NVS: zone=%u mode=%u active=%u deadline_us=%lld owner_ok=%u epoch=%lu",
+             (unsigned)z->zone_id,
+             (unsigned)mode,
+             (unsigned)active,
+             (long long)deadline_us,
+             (unsigned)owner_ok,
+             (unsigned long)epoch);
+}
+
+void logic_fsm_nvs_load(logic_state_t *state, light_mode_t def_mode)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) != ESP_OK) {
+        // defaults
+        for (uint8_t i = 0; i < state->zone_count; i++) {
+            state->zones[i].zone.mode = def_mode;
+            state->zones[i].zone.epoch = 0;
+            logic_fsm_clear_active(&state->zones[i]);
+        }
+        ESP_LOGI(TAG, "NVS empty -> defaults");
+        return;
+    }
+
+    uint8_t mode = (uint8_t)def_mode;
+    uint32_t epoch = 0;
+    uint8_t active = 0;
+    int64_t deadline_us = 0;
+    uint8_t owner_ok = 0;
+    uint8_t owner[16] = {0};
+    size_t sz = sizeof(owner);
+
+    uint8_t g_valid = 0, g_mode = (uint8_t)MODE_AUTO;
+    uint8_t z_valid = 0, z_zone = 0, z_mode = (uint8_t)MODE_AUTO;
+    uint8_t n_valid = 0, n_mode = (uint8_t)MODE_AUTO;
+
+
+    (void)nvs_get_u8(h, NVS_K_MODE, &mode);
+    (void)nvs_get_u32(h, NVS_K_EPOCH, &epoch);
+    (void)nvs_get_u8(h, NVS_K_ACTIVE, &active);
+    (void)nvs_get_i64(h, NVS_K_DEADLINE, &deadline_us);
+    (void)nvs_get_u8(h, NVS_K_OWNER_OK, &owner_ok);
+    (void)nvs_get_blob(h, NVS_K_OWNER_ADDR, owner, &sz);
+
+    (void)nvs_get_u8(h, NVS_K_GMODE_VALID, &g_valid);
+    (void)nvs_get_u8(h, NVS_K_GMODE, &g_mode);
+
+    (void)nvs_get_u8(h, NVS_K_ZMODE_VALID, &z_valid);
+    (void)nvs_get_u8(h, NVS_K_ZMODE_ZONE,  &z_zone);
+    (void)nvs_get_u8(h, NVS_K_ZMODE, &z_mode);
+
+    (void)nvs_get_u8(h, NVS_K_NMODE_VALID, &n_valid);
+    (void)nvs_get_u8(h, NVS_K_NMODE, &n_mode);
+
+    // apply loaded overrides (with sanity)
+    state->global_mode_valid = (g_valid != 0);
+    state->global_mode = (light_mode_t)g_mode;
+    if (state->global_mode > MODE_AUTO) { state->global_mode = MODE_AUTO; state->global_mode_valid = false; }
+
+    state->node_mode_valid = (n_valid != 0);
+    state->node_mode = (light_mode_t)n_mode;
+    if (state->node_mode > MODE_AUTO) { state->node_mode = MODE_AUTO; state->node_mode_valid = false; }
+
+    logic_zone_t *z0 = &state->zones[0];
+    z0->zone_mode_valid = (z_valid != 0) && (z_zone == z0->zone_id);
+    z0->zone_mode = (light_mode_t)z_mode;
+    if (z0->zone_mode > MODE_AUTO) { z0->zone_mode = MODE_AUTO; z0->zone_mode_valid = false; }
+
+    zone_apply_loaded(z0, mode, epoch, active, deadline_us, owner_ok, owner, def_mode);
+
+    for (uint8_t i = 1; i < state->zone_count; i++) {
+        logic_zone_t *z = &state->zones[i];
+        zone_nvs_rec_t rec = {.mode = (uint8_t)def_mode, .z_mode = (uint8_t)MODE_AUTO};
+        size_t len = sizeof(rec);
+        char key[12];
+        zone_nvs_key(z, key, sizeof(key));
+        if (nvs_get_blob(h, key, &rec, &len) != ESP_OK || len != sizeof(rec)) {
+            memset(&rec, 0, sizeof(rec));
+            rec.mode = (uint8_t)def_mode;
+            rec.z_mode = (uint8_t)MODE_AUTO;
+        }
+        z->zone_mode_valid = (rec.z_valid != 0) && (rec.z_mode <= MODE_AUTO);
+        z->zone_mode = (rec.z_mode <= MODE_AUTO) ? (light_mode_t)rec.z_mode : MODE_AUTO;
+        zone_apply_loaded(z, rec.mode, rec.epoch, rec.active, rec.deadline_us,
+                          rec.owner_ok, rec.owner, def_mode);
+    }
+
+    nvs_close(h);
+}
+
+void logic_fsm_boot(logic_state_t *state, bool cold_boot, int64_t now)
+{
+    // cold boot handling (do not reset epoch)
+    if (cold_boot) {
+        logic_evt_t cold = {.type = EVT_COLD_BOOT};
+        fsm_actions_t cold_actions = logic_fsm_step(state, &cold, now);
+        logic_fsm_apply_actions(state, &cold_actions);
+    }
+
+    bool flush = false;
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        logic_zone_t *z = &state->zones[i];
+
+        // strict restore: если думали что active — не включаем, ждём state_rsp
+        // ВАЖНО: проверяем по logic_fsm_effective_mode(), а не по zone.mode
+        if (logic_fsm_effective_mode(state, z) == MODE_AUTO &&
+            z->zone.active &&
+            z->zone.deadline_us > now) {
+
+            logic_evt_t enter = {.type = EVT_ENTER_PENDING_RESTORE, .zone = z->zone_id};
+            fsm_actions_t enter_actions = logic_fsm_step(state, &enter, now);
+            logic_fsm_apply_actions(state, &enter_actions);
+            ESP_LOGI(TAG, "restore(strict) zone %u: state_req sent, stay OFF until state_rsp",
+                     (unsigned)z->zone_id);
+        } else if (z->zone.active) {
+            ESP_LOGI(TAG, "restore zone %u: invalid stored active -> clear", (unsigned)z->zone_id);
+            logic_fsm_clear_active(z);
+            flush = true;
+        }
+
+        z->fsm = logic_fsm_from_state(state, z, now);
+    }
+
+    if (flush) {
+        fsm_actions_t flush_actions = {.flush_nvs_now = true};
+        logic_fsm_apply_actions(state, &flush_actions);
+    }
+    {
+        fsm_actions_t init_actions = {.update_led = true};
+        logic_fsm_apply_actions(state, &init_actions);
+    }
+    zone_timers_sync_all(state);
+}
+
+int64_t logic_fsm_next_deadline_us(const logic_state_t *state)
+{
+    return logic_tw_next_expiry_us(&state->timers);
+}
+
+bool logic_fsm_pop_timer(logic_state_t *state, int64_t now, logic_evt_t *out)
+{
+    logic_timer_t *t = logic_tw_pop_expired(&state->timers, now);
+    if (!t) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+    out->type = EVT_TIMER;
+    out->zone = t->zone;
+    out->u32 = t->kind;
+    return true;
+}
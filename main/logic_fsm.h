@@ -0,0 +1,198 @@
+#pragma once
+
+// Ядро логики зоны (FSM) без FreeRTOS: состояние, события, step()/apply_actions().
+// Собирается и на устройстве (logic.c), и на хосте (host/) со стабами бэкендов.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"           // LOGIC_MAX_ZONES
+#include "logic.h"            // zone_state_t
+#include "logic_timer.h"      // logic_tw_t
+#include "logic_dedup.h"      // logic_dedup_t
+#include "logic_fsm_spec.h"   // состояния / события / переходы
+#include "rgb_led.h"          // light_mode_t
+#include <openthread/ip6.h>   // otIp6Address
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOCAL_TRIGGER_MIN_INTERVAL_US (800 * 1000)
+
+#define LOGIC_FSM_STATE_ENUM(id, name) id,
+typedef enum {
+    LOGIC_FSM_STATES(LOGIC_FSM_STATE_ENUM)
+    FSM_STATE_COUNT,
+} fsm_state_t;
+
+// таймеры колеса (logic_timer_t.kind), срабатывание приходит как EVT_TIMER
+typedef enum {
+    LOGIC_TMR_ZONE_DEADLINE = 0,   // конец удержания AUTO_ACTIVE
+    LOGIC_TMR_RESTORE_TIMEOUT,     // не дождались state_rsp
+    LOGIC_TMR_NVS_FLUSH,           // отложенная запись NVS (на узел)
+    LOGIC_TMR_STATE_RSP,           // отложенный ответ на state_req
+    LOGIC_TMR_NETDATA,             // отложенное обновление записи в Network Data
+} logic_timer_kind_t;
+
+// одна зона, которую обслуживает узел (слот таблицы зон)
+typedef struct {
+    uint8_t zone_id;
+    uint8_t relay_ch;             // канал реле io_board (0 = PIN_RELAY)
+    zone_state_t zone;
+    fsm_state_t fsm;
+
+    bool zone_mode_valid;         // override через /zone/<id>/mode (z=<id>)
+    light_mode_t zone_mode;
+
+    int64_t restore_deadline_us;
+    int64_t state_rsp_due_us;     // отложенный ответ на state_req (0 = нет)
+    int64_t trig_sent_deadline_us; // deadline из последнего своего trigger (его видят узлы зоны)
+    bool req_on_attach;           // запрос состояния не ушёл (нет сети) — повторить по THREAD_UP
+    uint64_t peer_bits;           // пиры зоны: бит = хэш адреса (оценка размера зоны)
+
+    // своя запись зоны в Network Data (netdata_if.h): что опубликовано и когда можно снова
+    bool nd_published;
+    bool nd_active;
+    uint32_t nd_epoch;
+    int64_t nd_next_us;           // раньше не обновлять (NETDATA_MIN_INTERVAL_MS)
+    int64_t nd_due_us;            // отложенное обновление (0 = нет)
+
+    // источник состояния для наблюдателей zone/<id>/state: что им последним отправлено
+    bool obs_source;
+    bool obs_active;
+    uint32_t obs_epoch;
+    int64_t obs_deadline_us;
+
+    // зеркала deadline_us / restore_deadline_us / state_rsp_due_us / nd_due_us в колесе
+    logic_timer_t t_deadline;
+    logic_timer_t t_restore_timeout;
+    logic_timer_t t_state_rsp;
+    logic_timer_t t_netdata;
+} logic_zone_t;
+
+// ответы на state_req (на узел, все зоны)
+typedef struct {
+    uint32_t requests;     // принято state_req
+    uint32_t sent;         // отправлено отложенных state_rsp
+    uint32_t suppressed;   // отменено: раньше услышали чужой ответ не старее своего
+} logic_state_rsp_stats_t;
+
+typedef struct {
+    logic_zone_t zones[LOGIC_MAX_ZONES];   // zones[0] — основная зона (cfg zone_id)
+    uint8_t zone_count;
+    uint8_t zone_slot[256];                // zone_id -> индекс + 1 (0 = не наша зона)
+
+    bool global_mode_valid;
+    light_mode_t global_mode;
+
+    bool node_mode_valid;
+    light_mode_t node_mode;
+
+    bool nvs_dirty;
+    uint64_t nvs_next_flush_us;
+
+    logic_tw_t timers;
+    logic_timer_t t_nvs_flush;
+
+    logic_dedup_t dedup;                   // повторы trigger/state_rsp по пирам всех зон
+    uint8_t trigger_refresh_pct;           // TRIGGER_REFRESH_PCT (на хосте меняет replay)
+    logic_state_rsp_stats_t rsp_stats;
+} logic_state_t;
+
+// EVT_TIMER: zone + u32 = logic_timer_kind_t
+#define LOGIC_FSM_EVENT_ENUM(a, id, name, scope, node_fn, zone_fn, states) id,
+typedef enum {
+    LOGIC_FSM_EVENTS(LOGIC_FSM_EVENT_ENUM, _)
+    EVT_COUNT,
+} logic_evt_type_t;
+
+typedef struct {
+    logic_evt_type_t type;
+    uint8_t zone;          // zone_id для событий зоны (RSP/REQ/TRIGGER/OFF/LOCAL_TRIGGER/RESTORE)
+    uint32_t epoch;
+    otIp6Address addr;     // STATE_RSP / NETDATA_STATE: owner, TRIGGER_RX / STATE_REQ_RX: отправитель
+    uint32_t u32;
+    bool b;
+    int64_t rx_us;         // приём в обработчике CoAP (0 = не из сети), для гистограмм задержек
+    int64_t enq_us;        // постановка в mailbox (заполняет logic_mb_pop)
+} logic_evt_t;
+
+typedef struct {
+    bool set_relay;
+    bool relay_on;
+    bool send_state_req;
+    bool send_state_rsp;
+    bool send_trigger;
+    uint32_t trigger_rem_ms;
+    bool send_off;
+    uint32_t off_epoch;
+    bool netdata_update;          // опубликовать (netdata_publish) или снять запись зоны
+    bool netdata_publish;
+    bool netdata_active;
+    bool notify_state;            // уведомить наблюдателей (notify_final — последнее, без Observe)
+    bool notify_final;
+    bool log_transition;
+    fsm_state_t from_state;
+    fsm_state_t to_state;
+} fsm_zone_actions_t;
+
+typedef struct {
+    bool update_led;
+    bool save_nvs;
+    bool flush_nvs_now;
+    logic_evt_type_t event;
+    fsm_zone_actions_t zone[LOGIC_MAX_ZONES];   // по слотам state->zones
+} fsm_actions_t;
+
+// часы логики (по умолчанию esp_timer_get_time(); на хосте — виртуальные)
+typedef int64_t (*logic_clock_fn_t)(void);
+
+void logic_fsm_set_clock(logic_clock_fn_t fn);
+int64_t logic_fsm_now_us(void);
+
+// таблица зон: zone_ids[0] — основная, relay_ch[i] — канал реле зоны (NULL = по индексу)
+void logic_fsm_init_zones(logic_state_t *state, const uint8_t *zone_ids,
+                          const uint8_t *relay_ch, uint8_t count);
+// O(1) поиск слота по zone_id, NULL если узел эту зону не обслуживает
+logic_zone_t *logic_fsm_zone(logic_state_t *state, uint8_t zone_id);
+
+void logic_fsm_clear_active(logic_zone_t *z);
+// состояние зоны для state_rsp / CLI: в PendingRestore active наружу не утверждаем
+void logic_fsm_zone_report(const logic_zone_t *z, int64_t now, uint32_t *epoch,
+                           otIp6Address *owner, uint32_t *rem_ms, bool *active);
+bool logic_fsm_is_owner(const logic_zone_t *z);
+light_mode_t logic_fsm_effective_mode(const logic_state_t *state, const logic_zone_t *z);
+fsm_state_t logic_fsm_from_state(const logic_state_t *state, const logic_zone_t *z, int64_t now);
+
+const char *logic_fsm_state_name(fsm_state_t state);
+const char *logic_fsm_event_name(logic_evt_type_t event);
+
+fsm_actions_t logic_fsm_step(logic_state_t *state, const logic_evt_t *event, int64_t now);
+void logic_fsm_apply_actions(logic_state_t *state, const fsm_actions_t *actions);
+
+void logic_fsm_nvs_load(logic_state_t *state, light_mode_t def_mode);
+
+// стартовая последовательность после nvs_load: cold boot / strict restore / LED
+void logic_fsm_boot(logic_state_t *state, bool cold_boot, int64_t now);
+
+// покрытие спецификации (LOGIC_FSM_COVERAGE): сколько раз пара (from, event) дошла до
+// обработчика и в какие состояния (маска FSM_S) она фактически переводила зону
+#if LOGIC_FSM_COVERAGE
+void logic_fsm_coverage_reset(void);
+uint32_t logic_fsm_coverage_hits(fsm_state_t from, logic_evt_type_t event);
+uint8_t logic_fsm_coverage_to(fsm_state_t from, logic_evt_type_t event);
+#endif
+// из спецификации: есть ли обработчик пары и куда она может перевести зону
+bool logic_fsm_spec_handled(fsm_state_t from, logic_evt_type_t event);
+uint8_t logic_fsm_spec_to(fsm_state_t from, logic_evt_type_t event);
+
+// ближайший срок в колесе таймеров (0 = таймеров нет)
+int64_t logic_fsm_next_deadline_us(const logic_state_t *state);
+
+// очередной истёкший к now таймер как событие EVT_TIMER; false — больше нет
+bool logic_fsm_pop_timer(logic_state_t *state, int64_t now, logic_evt_t *out);
+
+#ifdef __cplusplus
+}
+#endif
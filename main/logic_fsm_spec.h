@@ -0,0 +1,87 @@
+#pragma once
+
+// Декларативная спецификация FSM зоны. Из этих списков (X-macro) строятся:
+//  - enum'ы fsm_state_t / logic_evt_type_t и таблицы имён;
+//  - плотная таблица диспетчеризации [состояние][событие] -> обработчик зоны;
+//  - маски допустимых переходов для отчёта о покрытии (logic_fsm_coverage_*).
+// Обработчики (h_*, n_*) — static-функции logic_fsm.c, раскрываются только там.
+
+// Состояния: X(id, name). Первое — начальное (0).
+#define LOGIC_FSM_STATES(X) \
+    X(FSM_AUTO_IDLE,       "AutoIdle")       \
+    X(FSM_AUTO_ACTIVE,     "AutoActive")     \
+    X(FSM_MANUAL_ON,       "ManualOn")       \
+    X(FSM_MANUAL_OFF,      "ManualOff")      \
+    X(FSM_PENDING_RESTORE, "PendingRestore")
+
+#define FSM_S(s)      (1u << (s))
+#define FSM_AUTO      (FSM_S(FSM_AUTO_IDLE) | FSM_S(FSM_AUTO_ACTIVE) | FSM_S(FSM_PENDING_RESTORE))
+#define FSM_MANUAL    (FSM_S(FSM_MANUAL_ON) | FSM_S(FSM_MANUAL_OFF))
+#define FSM_ANY       (FSM_AUTO | FSM_MANUAL)
+
+// События: X(a, id, name, scope, node_fn, zone_fn, states)
+//   scope   ZONE — зона из event->zone, MODE_ZONE — zone id в u32, NODE — все зоны
+//   node_fn часть события на уровне узла, до зон (NULL = нет; false = зоны не трогать)
+//   zone_fn обработчик зоны для состояний из маски states, в остальных событие игнорируется
+//   a       проброс аргумента вызывающего макроса
+#define LOGIC_FSM_EVENTS(X, a) \
+    X(a, EVT_STATE_RSP,             "STATE_RSP",             ZONE,      NULL,              h_state_rsp,     FSM_ANY)    \
+    X(a, EVT_TRIGGER_RX,            "TRIGGER_RX",            ZONE,      NULL,              h_trigger_rx,    FSM_ANY)    \
+    X(a, EVT_OFF_RX,                "OFF_RX",                ZONE,      NULL,              h_off_rx,        FSM_ANY)    \
+    X(a, EVT_STATE_REQ_RX,          "STATE_REQ_RX",          ZONE,      NULL,              h_state_req_rx,  FSM_ANY)    \
+    X(a, EVT_NETDATA_STATE,         "NETDATA_STATE",         ZONE,      NULL,              h_netdata_state, FSM_AUTO)   \
+    X(a, EVT_MODE_SET_GLOBAL,       "MODE_SET_GLOBAL",       NODE,      n_mode_set_global, h_mode_sync,     FSM_ANY)    \
+    X(a, EVT_MODE_SET_ZONE,         "MODE_SET_ZONE",         MODE_ZONE, NULL,              h_mode_set_zone, FSM_ANY)    \
+    X(a, EVT_MODE_SET_NODE,         "MODE_SET_NODE",         NODE,      n_mode_set_node,   h_mode_sync,     FSM_ANY)    \
+    X(a, EVT_MODE_CLR_GLOBAL,       "MODE_CLR_GLOBAL",       NODE,      n_mode_clr_global, h_mode_sync,     FSM_ANY)    \
+    X(a, EVT_MODE_CLR_ZONE,         "MODE_CLR_ZONE",         MODE_ZONE, NULL,              h_mode_clr_zone, FSM_ANY)    \
+    X(a, EVT_MODE_CLR_NODE,         "MODE_CLR_NODE",         NODE,      n_mode_clr_node,   h_mode_sync,     FSM_ANY)    \
+    X(a, EVT_LOCAL_MODE_SET,        "LOCAL_MODE_SET",        NODE,      NULL,              h_local_mode,    FSM_ANY)    \
+    X(a, EVT_LOCAL_TRIGGER,         "LOCAL_TRIGGER",         ZONE,      NULL,              h_local_trigger, FSM_AUTO)   \
+    X(a, EVT_TICK,                  "TICK",                  NODE,      NULL,              h_relay,         FSM_ANY)    \
+    X(a, EVT_TIMER,                 "TIMER",                 ZONE,      n_timer,           h_timer,         FSM_S(FSM_AUTO_ACTIVE) | FSM_S(FSM_PENDING_RESTORE)) \
+    X(a, EVT_ENTER_PENDING_RESTORE, "ENTER_PENDING_RESTORE", ZONE,      NULL,              h_enter_pending, FSM_AUTO)   \
+    X(a, EVT_COLD_BOOT,             "COLD_BOOT",             NODE,      n_cold_boot,       h_cold_boot,     FSM_ANY)    \
+    X(a, EVT_THREAD_UP,             "THREAD_UP",             NODE,      NULL,              h_thread_up,     FSM_S(FSM_PENDING_RESTORE)) \
+    X(a, EVT_THREAD_DOWN,           "THREAD_DOWN",           NODE,      NULL,              h_thread_down,   FSM_S(FSM_PENDING_RESTORE))
+
+// Режим (MODE_*, LOCAL_MODE_SET): из авто — в ручные, из ручного — в другой ручной
+// или обратно в AutoIdle (active/pending при входе в ручной режим сбрасываются).
+// auto_to — куда ещё может уйти зона из AutoActive/PendingRestore.
+#define LOGIC_FSM_MODE_ROWS_TO(X, ev, auto_to) \
+    X(FSM_AUTO_IDLE,       ev, FSM_MANUAL) \
+    X(FSM_AUTO_ACTIVE,     ev, FSM_MANUAL | (auto_to)) \
+    X(FSM_PENDING_RESTORE, ev, FSM_MANUAL | (auto_to)) \
+    X(FSM_MANUAL_ON,       ev, FSM_S(FSM_MANUAL_OFF) | FSM_S(FSM_AUTO_IDLE)) \
+    X(FSM_MANUAL_OFF,      ev, FSM_S(FSM_MANUAL_ON) | FSM_S(FSM_AUTO_IDLE))
+#define LOGIC_FSM_MODE_ROWS(X, ev) LOGIC_FSM_MODE_ROWS_TO(X, ev, 0)
+
+// Переходы: X(from, event, to) — в какие состояния событие может перевести зону
+// (без from). Пара (from, event) без строки состояние не меняет.
+#define LOGIC_FSM_TRANSITIONS(X) \
+    X(FSM_AUTO_IDLE,       EVT_STATE_RSP,             FSM_S(FSM_AUTO_ACTIVE))                          \
+    X(FSM_AUTO_ACTIVE,     EVT_STATE_RSP,             FSM_S(FSM_AUTO_IDLE))                            \
+    X(FSM_PENDING_RESTORE, EVT_STATE_RSP,             FSM_S(FSM_AUTO_ACTIVE) | FSM_S(FSM_AUTO_IDLE))   \
+    X(FSM_AUTO_IDLE,       EVT_TRIGGER_RX,            FSM_S(FSM_AUTO_ACTIVE))                          \
+    X(FSM_AUTO_ACTIVE,     EVT_TRIGGER_RX,            FSM_S(FSM_AUTO_IDLE))                            \
+    X(FSM_PENDING_RESTORE, EVT_TRIGGER_RX,            FSM_S(FSM_AUTO_ACTIVE) | FSM_S(FSM_AUTO_IDLE))   \
+    X(FSM_AUTO_ACTIVE,     EVT_OFF_RX,                FSM_S(FSM_AUTO_IDLE))                            \
+    X(FSM_PENDING_RESTORE, EVT_OFF_RX,                FSM_S(FSM_AUTO_IDLE))                            \
+    X(FSM_AUTO_ACTIVE,     EVT_NETDATA_STATE,         FSM_S(FSM_AUTO_IDLE))                            \
+    X(FSM_PENDING_RESTORE, EVT_NETDATA_STATE,         FSM_S(FSM_AUTO_ACTIVE) | FSM_S(FSM_AUTO_IDLE))   \
+    X(FSM_AUTO_IDLE,       EVT_LOCAL_TRIGGER,         FSM_S(FSM_AUTO_ACTIVE))                          \
+    X(FSM_PENDING_RESTORE, EVT_LOCAL_TRIGGER,         FSM_S(FSM_AUTO_ACTIVE))                          \
+    X(FSM_AUTO_ACTIVE,     EVT_TIMER,                 FSM_S(FSM_AUTO_IDLE))                            \
+    X(FSM_PENDING_RESTORE, EVT_TIMER,                 FSM_S(FSM_AUTO_IDLE))                            \
+    X(FSM_AUTO_IDLE,       EVT_ENTER_PENDING_RESTORE, FSM_S(FSM_PENDING_RESTORE))                      \
+    X(FSM_AUTO_ACTIVE,     EVT_ENTER_PENDING_RESTORE, FSM_S(FSM_PENDING_RESTORE))                      \
+    X(FSM_AUTO_IDLE,       EVT_COLD_BOOT,             FSM_S(FSM_PENDING_RESTORE))                      \
+    X(FSM_AUTO_ACTIVE,     EVT_COLD_BOOT,             FSM_S(FSM_PENDING_RESTORE))                      \
+    LOGIC_FSM_MODE_ROWS(X, EVT_MODE_SET_GLOBAL)                                                        \
+    LOGIC_FSM_MODE_ROWS(X, EVT_MODE_SET_ZONE)                                                          \
+    LOGIC_FSM_MODE_ROWS(X, EVT_MODE_SET_NODE)                                                          \
+    LOGIC_FSM_MODE_ROWS(X, EVT_MODE_CLR_GLOBAL)                                                        \
+    LOGIC_FSM_MODE_ROWS(X, EVT_MODE_CLR_ZONE)                                                          \
+    LOGIC_FSM_MODE_ROWS(X, EVT_MODE_CLR_NODE)                                                          \
+    /* локальный OFF/ON сбрасывает active/pending, даже если override держит AUTO */ \
+    LOGIC_FSM_MODE_ROWS_TO(X, EVT_LOCAL_MODE_SET, FSM_S(FSM_AUTO_IDLE))
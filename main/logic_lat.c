@@ -0,0 +1,71 @@
+#include "logic_lat.h"
+
+#include <string.h>
+
+
+void logic_lat_reset(logic_lat_hist_t *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+static uint8_t bucket_of(uint32_t us)
+{
+    if (us < 16) {
+        return 0;
+    }
+    uint8_t b = (uint8_t)(31 - __builtin_clz(us) - 3);   // floor(log2(us)) - 3
+    return b < LOGIC_LAT_BUCKETS ? b : LOGIC_LAT_BUCKETS - 1;
+}
+
+void logic_lat_record(logic_lat_hist_t *h, int64_t us)
+{
+    uint32_t v = (us <= 0) ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+    h->count++;
+    h->sum_us += v;
+    if (v > h->max_us) {
+        h->max_us = v;
+    }
+    h->bucket[bucket_of(v)]++;
+}
+
+uint32_t logic_lat_bucket_upper_us(uint8_t b)
+{
+    if (b >= LOGIC_LAT_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return 1u << (b + 4);
+}
+
+uint32_t logic_lat_percentile_us(const logic_lat_hist_t *h, uint8_t pct)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+    // ранг ceil(count * pct / 100), не меньше 1
+    uint64_t rank = ((uint64_t)h->count * pct + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (uint8_t b = 0; b < LOGIC_LAT_BUCKETS; b++) {
+        seen += h->bucket[b];
+        if (seen >= rank) {
+            uint32_t upper = logic_lat_bucket_upper_us(b);
+            // точнее границы корзины не знаем, но max известен
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+const char *logic_lat_stage_name(logic_lat_stage_t stage)
+{
+    switch (stage) {
+        case LOGIC_LAT_RX_ENQ:   return "rx_enq";
+        case LOGIC_LAT_QUEUE:    return "queue";
+        case LOGIC_LAT_STEP:     return "step";
+        case LOGIC_LAT_APPLY:    return "apply";
+        case LOGIC_LAT_RX_RELAY: return "rx_relay";
+        default:                 return "?";
+    }
+}
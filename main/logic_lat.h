@@ -0,0 +1,49 @@
+#pragma once
+
+// Гистограммы задержек срабатывания (мкс) по этапам пути CoAP RX -> реле:
+//   RX_ENQ   приём в обработчике CoAP -> постановка в mailbox (разбор payload)
+//   QUEUE    ожидание в mailbox до выборки logic_task
+//   STEP     logic_fsm_step()
+//   APPLY    logic_fsm_apply_actions() (CoAP TX, GPIO реле, NVS)
+//   RX_RELAY приём CoAP -> переключение реле его зоны (сквозная, основная метрика)
+// Корзины фиксированные, по степеням двойки: 0 — < 16 мкс, b — [2^(b+3), 2^(b+4)),
+// последняя — всё, что дольше. Без блокировок — их делает вызывающий.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOGIC_LAT_BUCKETS 20   // последняя корзина: >= 2^22 мкс (~4.2 с)
+
+typedef enum {
+    LOGIC_LAT_RX_ENQ = 0,
+    LOGIC_LAT_QUEUE,
+    LOGIC_LAT_STEP,
+    LOGIC_LAT_APPLY,
+    LOGIC_LAT_RX_RELAY,
+    LOGIC_LAT_STAGE_COUNT,
+} logic_lat_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t bucket[LOGIC_LAT_BUCKETS];
+} logic_lat_hist_t;
+
+void logic_lat_reset(logic_lat_hist_t *h);
+void logic_lat_record(logic_lat_hist_t *h, int64_t us);
+
+// верхняя граница корзины b (мкс); для последней — UINT32_MAX
+uint32_t logic_lat_bucket_upper_us(uint8_t b);
+
+// верхняя граница корзины, в которую попадает перцентиль pct (1..100); 0 — пусто
+uint32_t logic_lat_percentile_us(const logic_lat_hist_t *h, uint8_t pct);
+
+const char *logic_lat_stage_name(logic_lat_stage_t stage);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,216 @@
+#include "logic_mailbox.h"
+
+#include <string.h>
+
+
+void logic_mb_init(logic_mailbox_t *mb)
+{
+    memset(mb, 0, sizeof(*mb));
+}
+
+logic_mb_lane_t logic_mb_lane_of(logic_evt_type_t type)
+{
+    switch (type) {
+        case EVT_MODE_SET_GLOBAL:
+        case EVT_MODE_SET_ZONE:
+        case EVT_MODE_SET_NODE:
+        case EVT_MODE_CLR_GLOBAL:
+        case EVT_MODE_CLR_ZONE:
+        case EVT_MODE_CLR_NODE:
+        case EVT_LOCAL_MODE_SET:
+        case EVT_OFF_RX:
+            return LOGIC_MB_LANE_HIGH;
+        default:
+            return LOGIC_MB_LANE_NORMAL;
+    }
+}
+
+bool logic_mb_is_coalesced(logic_evt_type_t type)
+{
+    return type == EVT_STATE_RSP || type == EVT_TRIGGER_RX || type == EVT_STATE_REQ_RX ||
+           type == EVT_NETDATA_STATE;
+}
+
+const char *logic_mb_lane_name(logic_mb_lane_t lane)
+{
+    switch (lane) {
+        case LOGIC_MB_LANE_HIGH: return "high";
+        case LOGIC_MB_LANE_NORMAL: return "normal";
+        default: return "?";
+    }
+}
+
+static bool same_key(const logic_evt_t *a, const logic_evt_t *b)
+{
+    return a->type == b->type &&
+           a->zone == b->zone &&
+           a->epoch == b->epoch &&
+           memcmp(a->addr.mFields.m8, b->addr.mFields.m8, 16) == 0;
+}
+
+static bool seq_before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static void note_depth(logic_mb_lane_stats_t *st, uint8_t depth)
+{
+    st->depth = depth;
+    if (depth > st->depth_max) {
+        st->depth_max = depth;
+    }
+}
+
+static bool ring_push(logic_mb_entry_t *ring, uint8_t cap, uint8_t head, uint8_t *count,
+                      const logic_evt_t *e, uint32_t seq, int64_t now_us)
+{
+    if (*count >= cap) {
+        return false;
+    }
+    logic_mb_entry_t *slot = &ring[(head + *count) % cap];
+    slot->evt = *e;
+    slot->seq = seq;
+    slot->t_us = now_us;
+    (*count)++;
+    return true;
+}
+
+bool logic_mb_post(logic_mailbox_t *mb, const logic_evt_t *e, int64_t now_us)
+{
+    logic_mb_lane_t lane = logic_mb_lane_of(e->type);
+    logic_mb_lane_stats_t *st = &mb->stats[lane];
+    st->posted++;
+
+    if (lane == LOGIC_MB_LANE_HIGH) {
+        if (!ring_push(mb->high, LOGIC_MB_HIGH_SLOTS, mb->high_head, &mb->high_count,
+                       e, mb->next_seq, now_us)) {
+            st->dropped++;
+            return false;
+        }
+        mb->next_seq++;
+        note_depth(st, mb->high_count);
+        return true;
+    }
+
+    if (logic_mb_is_coalesced(e->type)) {
+        for (uint8_t i = 0; i < mb->state_count; i++) {
+            if (same_key(&mb->state[i].evt, e)) {
+                // место в очереди (seq) и время ожидания сохраняем, значение — новое
+                int64_t rx_us = mb->state[i].evt.rx_us;
+                mb->state[i].evt = *e;
+                if (rx_us) {
+                    mb->state[i].evt.rx_us = rx_us;
+                }
+                st->merged++;
+                return true;
+            }
+        }
+        if (mb->state_count >= LOGIC_MB_STATE_SLOTS) {
+            st->dropped++;
+            return false;
+        }
+        logic_mb_entry_t *s = &mb->state[mb->state_count++];
+        s->evt = *e;
+        s->seq = mb->next_seq++;
+        s->t_us = now_us;
+    } else {
+        if (!ring_push(mb->fifo, LOGIC_MB_FIFO_SLOTS, mb->fifo_head, &mb->fifo_count,
+                       e, mb->next_seq, now_us)) {
+            st->dropped++;
+            return false;
+        }
+        mb->next_seq++;
+    }
+    note_depth(st, (uint8_t)(mb->state_count + mb->fifo_count));
+    return true;
+}
+
+static void note_pop(logic_mb_lane_stats_t *st, const logic_mb_entry_t *entry, logic_evt_t *out,
+                     int64_t now_us)
+{
+    out->enq_us = entry->t_us;
+    int64_t wait = now_us - entry->t_us;
+    uint32_t wait_us = (wait > 0) ? (uint32_t)(wait > UINT32_MAX ? UINT32_MAX : wait) : 0;
+    st->popped++;
+    st->wait_sum_us += wait_us;
+    if (wait_us > st->wait_max_us) {
+        st->wait_max_us = wait_us;
+    }
+}
+
+// Самое раннее событие NORMAL (только зона zone и до seq before, если limit).
+static bool normal_pop(logic_mailbox_t *mb, logic_evt_t *out, int64_t now_us,
+                       bool limit, uint8_t zone, uint32_t before)
+{
+    int oldest = -1;
+    for (uint8_t i = 0; i < mb->state_count; i++) {
+        const logic_mb_entry_t *s = &mb->state[i];
+        if (limit && (s->evt.zone != zone || !seq_before(s->seq, before))) {
+            continue;
+        }
+        if (oldest < 0 || seq_before(s->seq, mb->state[oldest].seq)) {
+            oldest = i;
+        }
+    }
+
+    // FIFO: первая подходящая запись (порядок в кольце = порядок seq)
+    int fifo_idx = -1;
+    for (uint8_t k = 0; k < mb->fifo_count; k++) {
+        const logic_mb_entry_t *f = &mb->fifo[(mb->fifo_head + k) % LOGIC_MB_FIFO_SLOTS];
+        if (limit && (f->evt.zone != zone || !seq_before(f->seq, before))) {
+            continue;
+        }
+        fifo_idx = k;
+        break;
+    }
+
+    logic_mb_lane_stats_t *st = &mb->stats[LOGIC_MB_LANE_NORMAL];
+    const logic_mb_entry_t *f = (fifo_idx >= 0)
+        ? &mb->fifo[(mb->fifo_head + fifo_idx) % LOGIC_MB_FIFO_SLOTS] : NULL;
+
+    if (f && (oldest < 0 || seq_before(f->seq, mb->state[oldest].seq))) {
+        *out = f->evt;
+        note_pop(st, f, out, now_us);
+        // удалить k-й элемент кольца, сдвинув более ранние на одну позицию
+        for (int k = fifo_idx; k > 0; k--) {
+            mb->fifo[(mb->fifo_head + k) % LOGIC_MB_FIFO_SLOTS] =
+                mb->fifo[(mb->fifo_head + k - 1) % LOGIC_MB_FIFO_SLOTS];
+        }
+        mb->fifo_head = (uint8_t)((mb->fifo_head + 1) % LOGIC_MB_FIFO_SLOTS);
+        mb->fifo_count--;
+    } else if (oldest >= 0) {
+        *out = mb->state[oldest].evt;
+        note_pop(st, &mb->state[oldest], out, now_us);
+        mb->state[oldest] = mb->state[--mb->state_count];
+    } else {
+        return false;
+    }
+    st->depth = (uint8_t)(mb->state_count + mb->fifo_count);
+    return true;
+}
+
+bool logic_mb_pop(logic_mailbox_t *mb, logic_evt_t *out, int64_t now_us)
+{
+    if (mb->high_count) {
+        const logic_mb_entry_t *h = &mb->high[mb->high_head];
+
+        // барьер: OFF не обгоняет trigger/state_rsp своей зоны, пришедшие раньше
+        if (h->evt.type == EVT_OFF_RX &&
+            normal_pop(mb, out, now_us, true, h->evt.zone, h->seq)) {
+            return true;
+        }
+
+        *out = h->evt;
+        note_pop(&mb->stats[LOGIC_MB_LANE_HIGH], h, out, now_us);
+        mb->high_head = (uint8_t)((mb->high_head + 1) % LOGIC_MB_HIGH_SLOTS);
+        mb->high_count--;
+        mb->stats[LOGIC_MB_LANE_HIGH].depth = mb->high_count;
+        return true;
+    }
+    return normal_pop(mb, out, now_us, false, 0, 0);
+}
+
+bool logic_mb_empty(const logic_mailbox_t *mb)
+{
+    return mb->high_count == 0 && mb->state_count == 0 && mb->fifo_count == 0;
+}
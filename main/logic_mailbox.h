@@ -0,0 +1,82 @@
+#pragma once
+
+// Почтовый ящик событий логики вместо очереди FreeRTOS, две полосы приоритета:
+//  - HIGH:   команды режима и OFF — строгий FIFO, всегда выбирается первой;
+//  - NORMAL: STATE_RSP/TRIGGER_RX — одно значение на ключ (type, zone, epoch, addr),
+//            новое перезаписывает старое на месте; прочее (LOCAL_TRIGGER, ...) — FIFO.
+// Внутри NORMAL выдача в порядке поступления (по seq). OFF_RX не обгоняет более
+// ранние события NORMAL своей зоны (иначе OFF придёт раньше trigger своего epoch).
+// Блокировок нет — их делает вызывающий.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic_fsm.h"   // logic_evt_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOGIC_MB_HIGH_SLOTS  8
+#define LOGIC_MB_STATE_SLOTS 16
+#define LOGIC_MB_FIFO_SLOTS  8
+
+typedef enum {
+    LOGIC_MB_LANE_HIGH = 0,
+    LOGIC_MB_LANE_NORMAL,
+    LOGIC_MB_LANE_COUNT,
+} logic_mb_lane_t;
+
+typedef struct {
+    logic_evt_t evt;
+    uint32_t seq;
+    int64_t t_us;       // момент постановки (для слитых — первой)
+} logic_mb_entry_t;
+
+typedef struct {
+    uint32_t posted;
+    uint32_t merged;
+    uint32_t dropped;
+    uint32_t popped;
+    uint8_t depth;
+    uint8_t depth_max;
+    uint32_t wait_max_us;
+    uint64_t wait_sum_us;
+} logic_mb_lane_stats_t;
+
+typedef struct {
+    logic_mb_entry_t high[LOGIC_MB_HIGH_SLOTS];
+    uint8_t high_head;
+    uint8_t high_count;
+
+    logic_mb_entry_t state[LOGIC_MB_STATE_SLOTS];
+    uint8_t state_count;
+
+    logic_mb_entry_t fifo[LOGIC_MB_FIFO_SLOTS];
+    uint8_t fifo_head;
+    uint8_t fifo_count;
+
+    uint32_t next_seq;
+
+    logic_mb_lane_stats_t stats[LOGIC_MB_LANE_COUNT];
+} logic_mailbox_t;
+
+void logic_mb_init(logic_mailbox_t *mb);
+
+logic_mb_lane_t logic_mb_lane_of(logic_evt_type_t type);
+bool logic_mb_is_coalesced(logic_evt_type_t type);
+
+// false = событие отброшено (полоса полна)
+bool logic_mb_post(logic_mailbox_t *mb, const logic_evt_t *e, int64_t now_us);
+
+// следующее событие (HIGH раньше NORMAL); false если пусто.
+// out->enq_us — момент постановки (у слитых — первой, как и rx_us)
+bool logic_mb_pop(logic_mailbox_t *mb, logic_evt_t *out, int64_t now_us);
+
+bool logic_mb_empty(const logic_mailbox_t *mb);
+
+const char *logic_mb_lane_name(logic_mb_lane_t lane);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,218 @@
+#include "logic_timer.h"
+
+#include <string.h>
+
+
+#define TW_MASK ((uint64_t)(LOGIC_TW_SLOTS - 1))
+
+static uint64_t us_to_tick_ceil(int64_t us)
+{
+    if (us <= 0) {
+        return 0;
+    }
+    return ((uint64_t)us + LOGIC_TW_TICK_US - 1) / LOGIC_TW_TICK_US;
+}
+
+static void list_push(logic_timer_t **head, logic_timer_t *t)
+{
+    t->next = *head;
+    if (t->next) {
+        t->next->pprev = &t->next;
+    }
+    *head = t;
+    t->pprev = head;
+}
+
+static void list_unlink(logic_timer_t *t)
+{
+    *t->pprev = t->next;
+    if (t->next) {
+        t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+// слот, в который таймер попадает относительно now_tick (или expired)
+static void place(logic_tw_t *tw, logic_timer_t *t)
+{
+    uint64_t te = t->expires_tick;
+    if (te <= tw->now_tick) {
+        list_push(&tw->expired, t);
+        t->level = LOGIC_TW_LEVELS;
+        return;
+    }
+
+    uint64_t delta = te - tw->now_tick;
+    int level = 0;
+    while (level < LOGIC_TW_LEVELS - 1 &&
+           delta >= ((uint64_t)1 << (LOGIC_TW_BITS * (level + 1)))) {
+        level++;
+    }
+    // дальше последнего уровня: паркуем на максимальном расстоянии, при каскаде
+    // таймер будет размещён заново
+    uint64_t max_delta = ((uint64_t)1 << (LOGIC_TW_BITS * LOGIC_TW_LEVELS)) - 1;
+    if (delta > max_delta) {
+        te = tw->now_tick + max_delta;
+    }
+
+    unsigned slot = (unsigned)((te >> (LOGIC_TW_BITS * level)) & TW_MASK);
+    list_push(&tw->slots[level][slot], t);
+    tw->occupied[level] |= (uint64_t)1 << slot;
+    t->level = (uint8_t)level;
+    t->slot = (uint8_t)slot;
+}
+
+void logic_tw_init(logic_tw_t *tw, int64_t now_us)
+{
+    memset(tw, 0, sizeof(*tw));
+    tw->now_tick = (uint64_t)(now_us > 0 ? now_us : 0) / LOGIC_TW_TICK_US;
+}
+
+void logic_timer_init(logic_timer_t *t, uint8_t kind, uint8_t zone)
+{
+    memset(t, 0, sizeof(*t));
+    t->kind = kind;
+    t->zone = zone;
+}
+
+void logic_tw_cancel(logic_tw_t *tw, logic_timer_t *t)
+{
+    if (!t->armed) {
+        return;
+    }
+    list_unlink(t);
+    // слот опустел — снять бит занятости
+    if (t->level < LOGIC_TW_LEVELS && !tw->slots[t->level][t->slot]) {
+        tw->occupied[t->level] &= ~((uint64_t)1 << t->slot);
+    }
+    t->armed = false;
+    tw->armed--;
+}
+
+void logic_tw_add(logic_tw_t *tw, logic_timer_t *t, int64_t expires_us)
+{
+    logic_tw_cancel(tw, t);
+    t->expires_us = expires_us;
+    t->expires_tick = us_to_tick_ceil(expires_us);
+    t->armed = true;
+    tw->armed++;
+    place(tw, t);
+}
+
+// первый занятый слот уровня, начиная с текущей позиции (по кругу)
+static bool next_slot(uint64_t occupied, unsigned from, unsigned *slot)
+{
+    if (!occupied) {
+        return false;
+    }
+    uint64_t rot = (from == 0) ? occupied
+                               : ((occupied >> from) | (occupied << (LOGIC_TW_SLOTS - from)));
+    *slot = (from + (unsigned)__builtin_ctzll(rot)) & (unsigned)TW_MASK;
+    return true;
+}
+
+// тик, на котором слот (level, slot) станет текущим (срок или каскад)
+static uint64_t slot_tick(uint64_t now_tick, int level, unsigned slot)
+{
+    unsigned shift = (unsigned)(LOGIC_TW_BITS * level);
+    uint64_t base = now_tick >> shift;
+    unsigned cur = (unsigned)(base & TW_MASK);
+    uint64_t idx = base - cur + slot;
+    if (slot <= cur) {
+        idx += LOGIC_TW_SLOTS;
+    }
+    return idx << shift;
+}
+
+static bool next_event_tick(const logic_tw_t *tw, uint64_t *tick)
+{
+    bool any = false;
+    *tick = 0;
+    for (int l = 0; l < LOGIC_TW_LEVELS; l++) {
+        unsigned cur = (unsigned)((tw->now_tick >> (LOGIC_TW_BITS * l)) & TW_MASK);
+        unsigned slot;
+        // текущий слот уровня уже обработан (или его очередь — на следующем обороте)
+        unsigned from = (cur + 1) & (unsigned)TW_MASK;
+        if (!next_slot(tw->occupied[l], from, &slot)) {
+            continue;
+        }
+        uint64_t t = slot_tick(tw->now_tick, l, slot);
+        if (!any || t < *tick) {
+            *tick = t;
+            any = true;
+        }
+    }
+    return any;
+}
+
+int64_t logic_tw_next_expiry_us(const logic_tw_t *tw)
+{
+    if (tw->expired) {
+        return (int64_t)(tw->now_tick * LOGIC_TW_TICK_US);
+    }
+    uint64_t tick;
+    if (!next_event_tick(tw, &tick)) {
+        return 0;
+    }
+    return (int64_t)(tick * LOGIC_TW_TICK_US);
+}
+
+// перейти на тик T: каскад старших уровней (с верхнего), затем слот уровня 0
+static void step_to(logic_tw_t *tw, uint64_t tick)
+{
+    tw->now_tick = tick;
+
+    for (int l = LOGIC_TW_LEVELS - 1; l >= 1; l--) {
+        unsigned shift = (unsigned)(LOGIC_TW_BITS * l);
+        if (tick & (((uint64_t)1 << shift) - 1)) {
+            continue;
+        }
+        unsigned slot = (unsigned)((tick >> shift) & TW_MASK);
+        logic_timer_t *list = tw->slots[l][slot];
+        tw->slots[l][slot] = NULL;
+        tw->occupied[l] &= ~((uint64_t)1 << slot);
+        while (list) {
+            logic_timer_t *t = list;
+            list = t->next;
+            t->next = NULL;
+            place(tw, t);
+        }
+    }
+
+    unsigned slot0 = (unsigned)(tick & TW_MASK);
+    logic_timer_t *list = tw->slots[0][slot0];
+    tw->slots[0][slot0] = NULL;
+    tw->occupied[0] &= ~((uint64_t)1 << slot0);
+    while (list) {
+        logic_timer_t *t = list;
+        list = t->next;
+        t->next = NULL;
+        place(tw, t);   // te <= now_tick -> expired
+    }
+}
+
+logic_timer_t *logic_tw_pop_expired(logic_tw_t *tw, int64_t now_us)
+{
+    uint64_t target = (uint64_t)(now_us > 0 ? now_us : 0) / LOGIC_TW_TICK_US;
+
+    while (!tw->expired) {
+        uint64_t tick;
+        if (!next_event_tick(tw, &tick) || tick > target) {
+            break;
+        }
+        step_to(tw, tick);
+    }
+    if (!tw->expired && target > tw->now_tick) {
+        tw->now_tick = target;
+    }
+
+    logic_timer_t *t = tw->expired;
+    if (!t) {
+        return NULL;
+    }
+    list_unlink(t);
+    t->armed = false;
+    tw->armed--;
+    return t;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Иерархическое колесо таймеров логики (без FreeRTOS, время — us как у esp_timer).
+// Таймеры встроены в структуры зон (intrusive): add/cancel O(1), next_expiry —
+// по битовым маскам занятых слотов. Истёкшие таймеры забираются pop_expired()
+// и превращаются вызывающим в события (EVT_TIMER).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOGIC_TW_TICK_US   (10 * 1000)   // = тик FreeRTOS (CONFIG_FREERTOS_HZ=100)
+#define LOGIC_TW_BITS      6
+#define LOGIC_TW_SLOTS     (1 << LOGIC_TW_BITS)
+#define LOGIC_TW_LEVELS    4             // 64^4 тиков по 10 мс ~ 46 ч
+
+typedef struct logic_timer {
+    struct logic_timer *next;
+    struct logic_timer **pprev;   // адрес указателя, который ссылается на нас
+    int64_t expires_us;
+    uint64_t expires_tick;
+    uint8_t kind;                 // что за таймер (для события)
+    uint8_t zone;                 // zone_id, если таймер зоны
+    uint8_t level;                // где лежит: уровень/слот, LOGIC_TW_LEVELS = expired
+    uint8_t slot;
+    bool armed;
+} logic_timer_t;
+
+typedef struct {
+    logic_timer_t *slots[LOGIC_TW_LEVELS][LOGIC_TW_SLOTS];
+    uint64_t occupied[LOGIC_TW_LEVELS];   // бит i = slots[l][i] не пуст
+    logic_timer_t *expired;               // готовые к выдаче
+    uint64_t now_tick;
+    uint32_t armed;
+} logic_tw_t;
+
+void logic_tw_init(logic_tw_t *tw, int64_t now_us);
+
+void logic_timer_init(logic_timer_t *t, uint8_t kind, uint8_t zone);
+
+// (пере)взвести на момент expires_us (срабатывает при now >= expires_us)
+void logic_tw_add(logic_tw_t *tw, logic_timer_t *t, int64_t expires_us);
+void logic_tw_cancel(logic_tw_t *tw, logic_timer_t *t);
+
+// ближайший момент, когда колесу есть что делать (0 = таймеров нет);
+// для дальних уровней — граница каскада, не позже самого срока
+int64_t logic_tw_next_expiry_us(const logic_tw_t *tw);
+
+// продвинуть колесо до now_us и выдать один истёкший таймер (он снимается)
+logic_timer_t *logic_tw_pop_expired(logic_tw_t *tw, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
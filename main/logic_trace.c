@@ -0,0 +1,112 @@
+#include "logic_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+void logic_trace_init(logic_trace_t *t)
+{
+    memset(t, 0, sizeof(*t));
+}
+
+static void put(logic_trace_t *t, uint32_t t_ms, const logic_evt_t *event, uint8_t zone,
+                uint8_t fsm, uint8_t act)
+{
+    uint32_t h = t->head;
+    logic_trace_rec_t *r = &t->ring[h & (LOGIC_TRACE_LEN - 1)];
+    r->t_ms = t_ms;
+    r->epoch = event->epoch;
+    r->u32 = event->u32;
+    r->type = (uint8_t)event->type;
+    r->zone = zone;
+    r->fsm = fsm;
+    r->act = act;
+    __atomic_store_n(&t->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void logic_trace_step(logic_trace_t *t, const logic_state_t *state, const logic_evt_t *event,
+                      const fsm_actions_t *actions, int64_t now)
+{
+    uint32_t t_ms = (uint32_t)(now / 1000);
+    uint8_t node_act = 0;
+    if (actions->update_led) node_act |= LOGIC_TRACE_LED;
+    if (actions->flush_nvs_now) node_act |= LOGIC_TRACE_NVS_FLUSH;
+    if (actions->save_nvs) node_act |= LOGIC_TRACE_NVS_SAVE;
+
+    bool written = false;
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        const logic_zone_t *z = &state->zones[i];
+        const fsm_zone_actions_t *za = &actions->zone[i];
+
+        uint8_t act = 0;
+        // EVT_TICK выставляет реле на каждом пробуждении — пишем только смену
+        if (za->set_relay && za->relay_on != z->zone.relay_on) {
+            act |= za->relay_on ? LOGIC_TRACE_RELAY_ON : LOGIC_TRACE_RELAY_OFF;
+        }
+        if (za->send_state_req) act |= LOGIC_TRACE_STATE_REQ;
+        if (za->send_trigger) act |= LOGIC_TRACE_TRIGGER;
+        if (za->send_off) act |= LOGIC_TRACE_OFF;
+        if (!act && !za->log_transition) {
+            continue;
+        }
+        uint8_t fsm = za->log_transition
+                          ? (uint8_t)((za->from_state << 4) | za->to_state)
+                          : (uint8_t)((z->fsm << 4) | z->fsm);
+        // действия узла — в первую запись шага
+        put(t, t_ms, event, z->zone_id, fsm, (uint8_t)(act | (written ? 0 : node_act)));
+        written = true;
+    }
+    if (written || (event->type == EVT_TICK && !node_act)) {
+        return;
+    }
+
+    // событие без эффекта: состояние его зоны (узловых — основной)
+    const logic_zone_t *z = &state->zones[0];
+    for (uint8_t i = 0; i < state->zone_count; i++) {
+        if (state->zones[i].zone_id == event->zone) {
+            z = &state->zones[i];
+            break;
+        }
+    }
+    put(t, t_ms, event, z->zone_id, (uint8_t)((z->fsm << 4) | z->fsm), node_act);
+}
+
+bool logic_trace_get(const logic_trace_t *t, uint32_t seq, logic_trace_rec_t *out)
+{
+    uint32_t head = logic_trace_head(t);
+    if (head - seq - 1 >= LOGIC_TRACE_LEN) {
+        return false;
+    }
+    *out = t->ring[seq & (LOGIC_TRACE_LEN - 1)];
+    // писатель мог обогнать нас на круг за время копирования. Слот seq + LOGIC_TRACE_LEN
+    // (head - seq == LOGIC_TRACE_LEN) он, возможно, как раз пишет: head растёт только
+    // после записи, так что и эта запись уже не годится
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    head = logic_trace_head(t);
+    return head - seq < LOGIC_TRACE_LEN;
+}
+
+int logic_trace_format(const logic_trace_rec_t *r, char *buf, size_t len)
+{
+    static const char *const k_act[] = {
+        "relay=1", "relay=0", "state_req", "trigger", "off", "nvs", "nvs_flush", "led",
+    };
+
+    const char *ev = (r->type < EVT_COUNT) ? logic_fsm_event_name((logic_evt_type_t)r->type) : "?";
+    fsm_state_t from = (fsm_state_t)(r->fsm >> 4);
+    fsm_state_t to = (fsm_state_t)(r->fsm & 0x0F);
+
+    int n = snprintf(buf, len, "%lu.%03lu %s z=%u epoch=%lu u32=%lu %s",
+                     (unsigned long)(r->t_ms / 1000), (unsigned long)(r->t_ms % 1000),
+                     ev, (unsigned)r->zone, (unsigned long)r->epoch, (unsigned long)r->u32,
+                     logic_fsm_state_name(from));
+    if (from != to && n >= 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - n, "->%s", logic_fsm_state_name(to));
+    }
+    for (unsigned b = 0; b < sizeof(k_act) / sizeof(k_act[0]); b++) {
+        if ((r->act & (1u << b)) && n >= 0 && (size_t)n < len) {
+            n += snprintf(buf + n, len - n, " %s", k_act[b]);
+        }
+    }
+    return n;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// Двоичное кольцо трассировки logic_task: каждое обработанное событие —
+// запись с временем, переходом FSM и выполненными действиями.
+// Пишет только logic_task (несколько сохранений и один release-инкремент head),
+// читатель (CLI) без блокировок: запись, перезаписанная во время копирования,
+// отбрасывается по head. Декодирование в текст — только по запросу.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"      // LOGIC_TRACE_LEN
+#include "logic_fsm.h"   // logic_evt_t, fsm_actions_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+_Static_assert((LOGIC_TRACE_LEN & (LOGIC_TRACE_LEN - 1)) == 0, "LOGIC_TRACE_LEN must be a power of two");
+
+// действия зоны (logic_trace_rec_t.act)
+#define LOGIC_TRACE_RELAY_ON   (1u << 0)   // реле переключено во вкл
+#define LOGIC_TRACE_RELAY_OFF  (1u << 1)   // реле переключено в выкл
+#define LOGIC_TRACE_STATE_REQ  (1u << 2)
+#define LOGIC_TRACE_TRIGGER    (1u << 3)
+#define LOGIC_TRACE_OFF        (1u << 4)
+#define LOGIC_TRACE_NVS_SAVE   (1u << 5)   // отложенная запись NVS
+#define LOGIC_TRACE_NVS_FLUSH  (1u << 6)
+#define LOGIC_TRACE_LED        (1u << 7)
+
+typedef struct {
+    uint32_t t_ms;      // время logic_task (мс, переполнение ~49 суток)
+    uint32_t epoch;
+    uint32_t u32;       // поле события (rem_ms, mode, kind таймера, ...)
+    uint8_t type;       // logic_evt_type_t
+    uint8_t zone;       // zone_id записи
+    uint8_t fsm;        // from << 4 | to (fsm_state_t), без перехода from == to
+    uint8_t act;        // LOGIC_TRACE_*
+} logic_trace_rec_t;
+
+_Static_assert(sizeof(logic_trace_rec_t) == 16, "logic_trace_rec_t must stay 16 bytes");
+
+typedef struct {
+    logic_trace_rec_t ring[LOGIC_TRACE_LEN];
+    uint32_t head;      // всего записано; последняя запись — head - 1
+} logic_trace_t;
+
+void logic_trace_init(logic_trace_t *t);
+
+// записать шаг FSM; вызывать после logic_fsm_step и ДО logic_fsm_apply_actions
+// (смена реле определяется по текущему relay_on зоны).
+// По записи на зону с переходом или действием, иначе одна запись события;
+// EVT_TICK без переходов и действий не пишется.
+void logic_trace_step(logic_trace_t *t, const logic_state_t *state, const logic_evt_t *event,
+                      const fsm_actions_t *actions, int64_t now);
+
+static inline uint32_t logic_trace_head(const logic_trace_t *t)
+{
+    return __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+}
+
+// копия записи с номером seq (0..head-1); false — уже перезаписана
+bool logic_trace_get(const logic_trace_t *t, uint32_t seq, logic_trace_rec_t *out);
+
+// "12345.678 TRIGGER_RX z=1 epoch=5 u32=10000 AutoIdle->AutoActive relay=1 trigger nvs"
+int logic_trace_format(const logic_trace_rec_t *r, char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,238 @@
+#include "netdata_if.h"
+#include "coap_if.h"
+#include "coap_bin.h"
+#include "logic.h"
+#include "config.h"
+
+#include "esp_openthread_lock.h"
+#include "esp_log.h"
+
+#include <openthread/netdata.h>
+#include <openthread/server.h>
+#include <openthread/thread.h>
+
+#include <string.h>
+
+
+static const char *TAG = "netdata_if";
+static otInstance *s_ot = NULL;
+
+static uint8_t s_zone_ids[LOGIC_MAX_ZONES];
+static uint8_t s_zone_count;
+
+// публикации, не сделанные из-за NETDATA_BUDGET_BYTES
+static uint32_t s_budget_skips;
+
+// service TLV (2 + 1 S_id + 4 enterprise + 1 + service data) + server TLV (2 + 2 RLOC16)
+#define ND_ENTRY_OVERHEAD 12
+
+// лучшая запись зоны в текущей Network Data
+typedef struct {
+    bool found;
+    uint32_t epoch;
+    uint32_t rem_ms;
+    bool active;
+    otIp6Address owner;
+} nd_best_t;
+
+static void svc_data(uint8_t *out, uint8_t zone_id)
+{
+    out[0] = NETDATA_SVC_TAG;
+    out[1] = zone_id;
+}
+
+static int zone_index(uint8_t zone_id)
+{
+    for (uint8_t i = 0; i < s_zone_count; i++) {
+        if (s_zone_ids[i] == zone_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool decode_server_data(const otServerConfig *srv, nd_best_t *rec)
+{
+    coap_bin_msg_t bm;
+    if (!coap_bin_decode(srv->mServerData, srv->mServerDataLength, &bm) ||
+        bm.type != COAP_BIN_STATE_RSP) {
+        return false;
+    }
+    rec->epoch = bm.epoch;
+    rec->rem_ms = bm.rem_ms;
+    rec->active = (bm.flags & COAP_BIN_F_ACTIVE) != 0;
+    memset(&rec->owner, 0, sizeof(rec->owner));
+    if (bm.flags & COAP_BIN_F_OWNER_FULL) {
+        memcpy(rec->owner.mFields.m8, bm.owner, 16);
+    } else if (bm.flags & COAP_BIN_F_OWNER_IID) {
+        const otMeshLocalPrefix *ml = otThreadGetMeshLocalPrefix(s_ot);
+        if (ml) {
+            memcpy(rec->owner.mFields.m8, ml->m8, 8);
+        }
+        memcpy(&rec->owner.mFields.m8[8], &bm.owner[8], 8);
+    }
+    return true;
+}
+
+// вызывается в контексте OpenThread (lock уже взят)
+static void scan_netdata(void)
+{
+    nd_best_t best[LOGIC_MAX_ZONES];
+    memset(best, 0, sizeof(best));
+
+    otNetworkDataIterator it = OT_NETWORK_DATA_ITERATOR_INIT;
+    otServiceConfig cfg;
+    while (otNetDataGetNextService(s_ot, &it, &cfg) == OT_ERROR_NONE) {
+        if (cfg.mEnterpriseNumber != NETDATA_ENTERPRISE_NUMBER ||
+            cfg.mServiceDataLength != 2 || cfg.mServiceData[0] != NETDATA_SVC_TAG) {
+            continue;
+        }
+        int idx = zone_index(cfg.mServiceData[1]);
+        if (idx < 0) {
+            continue;
+        }
+        nd_best_t rec;
+        if (!decode_server_data(&cfg.mServerConfig, &rec)) {
+            ESP_LOGW(TAG, "bad record zone=%u rloc16=0x%04x", (unsigned)cfg.mServiceData[1],
+                     (unsigned)cfg.mServerConfig.mRloc16);
+            continue;
+        }
+        // записи нескольких owner'ов (смена owner до снятия старой записи) — берём новейшую
+        if (!best[idx].found || rec.epoch > best[idx].epoch) {
+            rec.found = true;
+            best[idx] = rec;
+        }
+    }
+
+    for (uint8_t i = 0; i < s_zone_count; i++) {
+        if (best[i].found) {
+            logic_post_netdata_state(s_zone_ids[i], best[i].epoch, &best[i].owner,
+                                     best[i].rem_ms, best[i].active);
+        }
+    }
+}
+
+void netdata_if_state_changed(otChangedFlags flags)
+{
+    if (s_ot && (flags & OT_CHANGED_THREAD_NETDATA)) {
+        scan_netdata();
+    }
+}
+
+// своя запись зоны уже в Network Data этого узла (замена почти не меняет размер)
+static bool own_record(const uint8_t *sd, uint8_t sd_len)
+{
+    otNetworkDataIterator it = OT_NETWORK_DATA_ITERATOR_INIT;
+    otServiceConfig cfg;
+    while (otServerGetNextService(s_ot, &it, &cfg) == OT_ERROR_NONE) {
+        if (cfg.mEnterpriseNumber == NETDATA_ENTERPRISE_NUMBER &&
+            cfg.mServiceDataLength == sd_len && memcmp(cfg.mServiceData, sd, sd_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void netdata_if_register(otInstance *ot)
+{
+    s_ot = ot;
+    s_zone_count = logic_get_zone_ids(s_zone_ids, LOGIC_MAX_ZONES);
+}
+
+bool netdata_if_publish(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                        uint32_t rem_ms, bool active)
+{
+    if (!s_ot || !coap_if_thread_ready()) {
+        return false;
+    }
+
+    otServiceConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.mEnterpriseNumber = NETDATA_ENTERPRISE_NUMBER;
+    svc_data(cfg.mServiceData, zone_id);
+    cfg.mServiceDataLength = 2;
+    cfg.mServerConfig.mStable = false;
+
+    coap_bin_msg_t bm = {
+        .type = COAP_BIN_STATE_RSP,
+        .flags = active ? COAP_BIN_F_ACTIVE : 0,
+        .epoch = epoch,
+        .rem_ms = rem_ms,
+    };
+
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    static const uint8_t k_zero[16] = {0};
+    if (memcmp(owner->mFields.m8, k_zero, 16) != 0) {
+        const otMeshLocalPrefix *ml = otThreadGetMeshLocalPrefix(s_ot);
+        bool same_prefix = ml && memcmp(owner->mFields.m8, ml->m8, 8) == 0;
+        bm.flags |= same_prefix ? COAP_BIN_F_OWNER_IID : COAP_BIN_F_OWNER_FULL;
+        memcpy(bm.owner, owner->mFields.m8, 16);
+    }
+    size_t n = coap_bin_encode(&bm, cfg.mServerConfig.mServerData,
+                               sizeof(cfg.mServerConfig.mServerData));
+    cfg.mServerConfig.mServerDataLength = (uint8_t)n;
+
+    // общий на всю сеть лимит: новая запись не должна вытеснять префиксы и маршруты
+    unsigned nd_len = otNetDataGetLength(s_ot);
+    unsigned grow = ND_ENTRY_OVERHEAD + cfg.mServiceDataLength + (unsigned)n;
+    if (!own_record(cfg.mServiceData, cfg.mServiceDataLength) &&
+        nd_len + grow > NETDATA_BUDGET_BYTES) {
+        esp_openthread_lock_release();
+        s_budget_skips++;
+        ESP_LOGW(TAG, "publish zone=%u skipped: netdata %u + %u > budget %u (skips=%lu)",
+                 (unsigned)zone_id, nd_len, grow, (unsigned)NETDATA_BUDGET_BYTES,
+                 (unsigned long)s_budget_skips);
+        return false;
+    }
+
+    // запись заменяется целиком: старую server data той же зоны убираем
+    (void)otServerRemoveService(s_ot, NETDATA_ENTERPRISE_NUMBER, cfg.mServiceData,
+                                cfg.mServiceDataLength);
+    otError e = otServerAddService(s_ot, &cfg);
+    if (e == OT_ERROR_NONE) {
+        e = otServerRegister(s_ot);
+    }
+    esp_openthread_lock_release();
+
+    if (e != OT_ERROR_NONE) {
+        ESP_LOGW(TAG, "publish zone=%u epoch=%lu err=%d", (unsigned)zone_id,
+                 (unsigned long)epoch, (int)e);
+        return false;
+    }
+    ESP_LOGI(TAG, "publish zone=%u epoch=%lu active=%u rem_ms=%lu len=%u", (unsigned)zone_id,
+             (unsigned long)epoch, active ? 1u : 0u, (unsigned long)rem_ms, (unsigned)n);
+    return true;
+}
+
+void netdata_if_get_stats(uint32_t *budget_skips, uint8_t *len, uint8_t *max_len)
+{
+    if (budget_skips) *budget_skips = s_budget_skips;
+    if (len) *len = s_ot ? otNetDataGetLength(s_ot) : 0;
+    if (max_len) *max_len = s_ot ? otNetDataGetMaxLength(s_ot) : 0;
+}
+
+bool netdata_if_withdraw(uint8_t zone_id)
+{
+    if (!s_ot || !coap_if_thread_ready()) {
+        return false;
+    }
+
+    uint8_t sd[2];
+    svc_data(sd, zone_id);
+
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    otError e = otServerRemoveService(s_ot, NETDATA_ENTERPRISE_NUMBER, sd, sizeof(sd));
+    if (e == OT_ERROR_NONE) {
+        e = otServerRegister(s_ot);
+    } else if (e == OT_ERROR_NOT_FOUND) {
+        e = OT_ERROR_NONE;   // уже нет — снимать нечего
+    }
+    esp_openthread_lock_release();
+
+    if (e != OT_ERROR_NONE) {
+        ESP_LOGW(TAG, "withdraw zone=%u err=%d", (unsigned)zone_id, (int)e);
+        return false;
+    }
+    ESP_LOGI(TAG, "withdraw zone=%u", (unsigned)zone_id);
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// Состояние зон в Thread Network Data: service entry
+//   enterprise NETDATA_ENTERPRISE_NUMBER, service data {NETDATA_SVC_TAG, zone_id},
+//   server data — двоичный state_rsp (coap_bin.h, owner — IID mesh-local)
+// Публикует owner зоны (logic_fsm.c решает, когда и что, с учётом NETDATA_*), читают все:
+// при изменении Network Data по каждой своей зоне в логику уходит запись с наибольшим epoch
+// (EVT_NETDATA_STATE). Записи не stable: спящим детям они не рассылаются и не
+// раздувают их копию Network Data.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <openthread/instance.h>
+#include <openthread/ip6.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// после coap_if_register (нужен список зон)
+void netdata_if_register(otInstance *ot);
+
+// из общего state-changed callback (ot_app.c, контекст OpenThread): разбор Network Data
+// при OT_CHANGED_THREAD_NETDATA
+void netdata_if_state_changed(otChangedFlags flags);
+
+// Вызовы берут lock OpenThread сами, мимо outbox coap_if: логике нужен результат (повтор
+// через NETDATA_MIN_INTERVAL_MS), запись уходит лидеру, а не в зону, так что порядок
+// относительно trigger/off не важен, и бывает не чаще раза в интервал на зону.
+// добавить/заменить свою запись зоны и отдать Network Data лидеру (otServerRegister);
+// false — Thread не готов, новая запись не влезает в NETDATA_BUDGET_BYTES или OpenThread
+// отказал (нет места и т.п.), повтор — позже
+bool netdata_if_publish(uint8_t zone_id, uint32_t epoch, const otIp6Address *owner,
+                        uint32_t rem_ms, bool active);
+// убрать свою запись зоны
+bool netdata_if_withdraw(uint8_t zone_id);
+
+// CLI (контекст OpenThread): пропуски по NETDATA_BUDGET_BYTES, текущий и наибольший
+// размер Network Data в байтах
+void netdata_if_get_stats(uint32_t *budget_skips, uint8_t *len, uint8_t *max_len);
+
+#ifdef __cplusplus
+}
+#endif
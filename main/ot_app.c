@@ -1,5 +1,6 @@
 #include "ot_app.h"
 #include "coap_if.h"
+#include "netdata_if.h"
 #include "logic.h"
 #include "logic_cli.h"
 #include "config.h"
@@ -83,6 +84,14 @@ static void ensure_active_dataset(otInstance *ot)
     ESP_LOGI(TAG, "Active Dataset written to NVS");
 }
 
+// единственный otSetStateChangedCallback: роль (coap_if) и Network Data (netdata_if)
+static void on_ot_state_changed(otChangedFlags flags, void *ctx)
+{
+    (void)ctx;
+    coap_if_state_changed(flags);
+    netdata_if_state_changed(flags);
+}
+
 static void ot_task_worker(void *ctx)
 {
     esp_openthread_platform_config_t cfg = {
@@ -128,8 +137,19 @@ static void ot_task_worker(void *ctx)
 
     // стартуем логику и CoAP
     coap_if_register(ot);
+    netdata_if_register(ot);
     logic_start();
 
+    // после logic_start: обработчики постят события в очередь логики
+    // attach мог случиться до подписки — сверяем роль и ML-EID сразу
+    esp_openthread_lock_acquire(portMAX_DELAY);
+    e = otSetStateChangedCallback(ot, on_ot_state_changed, NULL);
+    coap_if_state_changed(OT_CHANGED_THREAD_ROLE | OT_CHANGED_THREAD_ML_ADDR);
+    esp_openthread_lock_release();
+    if (e != OT_ERROR_NONE) {
+        ESP_LOGE(TAG, "otSetStateChangedCallback -> %d", e);
+    }
+
     esp_openthread_launch_mainloop();
 
     esp_openthread_netif_glue_deinit();
@@ -25,6 +25,9 @@
 #include <openthread/ip6.h>
 #include "logic_api.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 
 void logic_cli_print_state(void);
 
@@ -36,26 +39,128 @@ void logic_cli_print_state(void);
 //     logic_cli_print_state();
 // }
 
+// logic trace [n] — последние n записей кольца трассировки (по умолчанию 32, 0 = все)
+static otError esp_ot_process_logic_trace(uint8_t aArgsLength, char *aArgs[])
+{
+    uint32_t n = 32;
+    if (aArgsLength >= 1) {
+        char *end = NULL;
+        unsigned long v = strtoul(aArgs[0], &end, 10);
+        if (end == aArgs[0] || *end != '\0') {
+            return OT_ERROR_INVALID_ARGS;
+        }
+        n = (uint32_t)v;
+    }
+    logic_cli_print_trace(n);
+    return OT_ERROR_NONE;
+}
+
 static otError esp_ot_process_logic_state(void *aContext, uint8_t aArgsLength, char *aArgs[])
 {
     (void)aContext;
-    (void)aArgsLength;
-    (void)aArgs;
 
-    uint32_t epoch = 0;
-    otIp6Address owner;
-    uint32_t rem_ms = 0;
-    bool active = false;
+    if (aArgsLength >= 1 && strcmp(aArgs[0], "trace") == 0) {
+        return esp_ot_process_logic_trace(aArgsLength - 1, aArgs + 1);
+    }
+    // logic lat [reset] — гистограммы задержек CoAP RX -> реле
+    if (aArgsLength >= 1 && strcmp(aArgs[0], "lat") == 0) {
+        bool reset = (aArgsLength >= 2 && strcmp(aArgs[1], "reset") == 0);
+        logic_cli_print_latency(reset);
+        return OT_ERROR_NONE;
+    }
+    // logic mcast [<type> <hops>] — счётчики multicast по типам / hop limit типа (0 = стек)
+    if (aArgsLength >= 1 && strcmp(aArgs[0], "mcast") == 0) {
+        if (aArgsLength >= 3) {
+            char *end = NULL;
+            unsigned long hops = strtoul(aArgs[2], &end, 10);
+            if (end == aArgs[2] || *end != '\0' || hops > 255 ||
+                !coap_if_set_mcast_hops(aArgs[1], (uint8_t)hops)) {
+                return OT_ERROR_INVALID_ARGS;
+            }
+        }
+        coap_if_cli_print_mcast();
+        return OT_ERROR_NONE;
+    }
+    // logic txbench [n] — кодирование текстового state_rsp: snprintf против Rust
+    if (aArgsLength >= 1 && strcmp(aArgs[0], "txbench") == 0) {
+        unsigned long n = 1000;
+        if (aArgsLength >= 2) {
+            char *end = NULL;
+            n = strtoul(aArgs[1], &end, 10);
+            if (end == aArgs[1] || *end != '\0' || n == 0) {
+                return OT_ERROR_INVALID_ARGS;
+            }
+        }
+        coap_if_cli_bench_tx((uint32_t)n);
+        return OT_ERROR_NONE;
+    }
 
-    logic_build_state(&epoch, &owner, &rem_ms, &active);
+    uint8_t zone_ids[8];
+    uint8_t zone_count = logic_get_zone_ids(zone_ids, sizeof(zone_ids));
 
-    otCliOutputFormat("epoch=%lu active=%u rem_ms=%lu owner=", (unsigned long)epoch, active ? 1 : 0, (unsigned long)rem_ms);
-    {
-    char ip6buf[OT_IP6_ADDRESS_STRING_SIZE];
-    otIp6AddressToString(&owner, ip6buf, sizeof(ip6buf));
-    otCliOutputFormat("%s", ip6buf);
-}
-otCliOutputFormat("\r\n");
+    for (uint8_t i = 0; i < zone_count; i++) {
+        uint32_t epoch = 0;
+        otIp6Address owner;
+        uint32_t rem_ms = 0;
+        bool active = false;
+
+        logic_build_zone_state(zone_ids[i], &epoch, &owner, &rem_ms, &active);
+
+        char ip6buf[OT_IP6_ADDRESS_STRING_SIZE];
+        otIp6AddressToString(&owner, ip6buf, sizeof(ip6buf));
+        otCliOutputFormat("zone=%u epoch=%lu active=%u rem_ms=%lu owner=%s\r\n",
+                          (unsigned)zone_ids[i], (unsigned long)epoch, active ? 1 : 0,
+                          (unsigned long)rem_ms, ip6buf);
+    }
+
+    uint32_t wake_x100 = 0;
+    uint32_t wake_total = 0;
+    logic_get_wakeup_stats(&wake_x100, &wake_total);
+    uint32_t in_x100 = 0;
+    uint32_t in_total = 0;
+    logic_get_input_wakeup_stats(&in_x100, &in_total);
+    otCliOutputFormat("wakeups/s=%lu.%02lu wakeups=%lu input wakeups/s=%lu.%02lu input=%lu\r\n",
+                      (unsigned long)(wake_x100 / 100), (unsigned long)(wake_x100 % 100),
+                      (unsigned long)wake_total,
+                      (unsigned long)(in_x100 / 100), (unsigned long)(in_x100 % 100),
+                      (unsigned long)in_total);
+
+    uint32_t dd_lookups = 0;
+    uint32_t dd_hits = 0;
+    uint32_t dd_evict = 0;
+    logic_get_dedup_stats(&dd_lookups, &dd_hits, &dd_evict);
+    uint32_t dd_pct_x10 = dd_lookups ? (uint32_t)((uint64_t)dd_hits * 1000 / dd_lookups) : 0;
+    otCliOutputFormat("dedup: lookups=%lu hits=%lu (%lu.%lu%%) evictions=%lu\r\n",
+                      (unsigned long)dd_lookups, (unsigned long)dd_hits,
+                      (unsigned long)(dd_pct_x10 / 10), (unsigned long)(dd_pct_x10 % 10),
+                      (unsigned long)dd_evict);
+
+    uint32_t sr_req = 0;
+    uint32_t sr_sent = 0;
+    uint32_t sr_supp = 0;
+    logic_get_state_rsp_stats(&sr_req, &sr_sent, &sr_supp);
+    otCliOutputFormat("state_rsp: requests=%lu sent=%lu suppressed=%lu\r\n",
+                      (unsigned long)sr_req, (unsigned long)sr_sent, (unsigned long)sr_supp);
+
+    uint32_t rx_foreign = 0;
+    uint32_t rx_group = 0;
+    uint32_t rx_all = 0;
+    coap_if_get_rx_stats(&rx_foreign, &rx_group, &rx_all);
+    uint32_t rx_total = rx_foreign + rx_group + rx_all;
+    uint32_t foreign_x10 = rx_total ? (uint32_t)((uint64_t)rx_foreign * 1000 / rx_total) : 0;
+    otCliOutputFormat("coap rx: zone_group=%lu all_nodes=%lu foreign=%lu (%lu.%lu%% of RX)\r\n",
+                      (unsigned long)rx_group, (unsigned long)rx_all, (unsigned long)rx_foreign,
+                      (unsigned long)(foreign_x10 / 10), (unsigned long)(foreign_x10 % 10));
+
+    uint32_t nd_skips = 0;
+    uint8_t nd_len = 0;
+    uint8_t nd_max = 0;
+    netdata_if_get_stats(&nd_skips, &nd_len, &nd_max);
+    otCliOutputFormat("netdata: len=%u max=%u budget_skipped=%lu\r\n",
+                      (unsigned)nd_len, (unsigned)nd_max, (unsigned long)nd_skips);
+
+    logic_cli_print_mailbox();
+    coap_if_cli_print_outbox();
 
     return OT_ERROR_NONE;
 }